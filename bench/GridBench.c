@@ -0,0 +1,140 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// A solid cylinder of current along z fills the middle of grids of growing size, one current element per node inside
+// it. For every size the grid solver deposits and solves it by FFT convolution, and the direct path sums Biot-Savart
+// over all elements at a sample of the nodes outside the cylinder, extrapolated to the whole grid. Reports both times,
+// the solve time per padded node and log2 of the padded node count, which stays flat when the solve is O(N log N),
+// and the largest difference between the two at the sampled nodes relative to the largest field among them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test/math/Vector.h"
+#include "test/math/MathFunctions.h"
+#include "test/physics/FieldSource.h"
+#include "test/tools/GridSolver.h"
+#include "test/tools/ThreadPool.h"
+#include "test/tools/TimeTools.h"
+
+#define BENCH_DIRECT_SAMPLES 2048
+#define BENCH_CURRENT_DENSITY 10.0
+#define BENCH_PERMEABILITY 0.25
+
+static void runSize(size_t size, ThreadPool* pool) {
+	const double center = (size - 1) / 2.0;
+	const double radius = size / 6.0;
+	const Vector l = { 0, 0, 1 };
+	FieldSourceSet* sources = fieldSourceSetNew();
+	Vector* samples = (Vector*) malloc(sizeof(Vector) * BENCH_DIRECT_SAMPLES);
+	size_t x, y, z, sampleCount = 0, outsideCount = 0;
+
+	double startTime = getTimeDetailed();
+	GridSolver* solver = gridSolverNew(vectorZero, 1, size, size, size, pool);
+	const double setupTime = getTimeDetailed() - startTime;
+	if (!solver || !samples) {
+		printf("%6lu: out of memory\n", (unsigned long) size);
+		free(samples);
+		fieldSourceSetFree(sources);
+		return;
+	}
+
+	// the element at position + l is where its current sits, so that lands on the node
+	for (z = size / 4; z < size - size / 4; ++z) {
+		for (y = 0; y < size; ++y) {
+			for (x = 0; x < size; ++x) {
+				if (hypot(x - center, y - center) <= radius) {
+					FieldSource source = { FIELD_SOURCE_ELEMENT };
+					source.element = (Conductor) { vectorCreate(x, y, z - 1.0), BENCH_CURRENT_DENSITY, BENCH_PERMEABILITY, l };
+					fieldSourceSetAdd(sources, &source);
+				}
+			}
+		}
+	}
+	for (z = 0; z < size; ++z) {
+		for (y = 0; y < size; ++y) {
+			for (x = 0; x < size; ++x) {
+				if (hypot(x - center, y - center) > radius + 2) {
+					++outsideCount;
+				}
+			}
+		}
+	}
+	const size_t sampleStep = max(outsideCount / BENCH_DIRECT_SAMPLES, (size_t) 1);
+	for (z = 0, outsideCount = 0; z < size; ++z) {
+		for (y = 0; y < size; ++y) {
+			for (x = 0; x < size && sampleCount < BENCH_DIRECT_SAMPLES; ++x) {
+				if (hypot(x - center, y - center) > radius + 2 && outsideCount++ % sampleStep == 0) {
+					samples[sampleCount++] = vectorCreate(x, y, z);
+				}
+			}
+		}
+	}
+
+	startTime = getTimeDetailed();
+	gridSolverDepositSources(solver, sources);
+	gridSolverSolve(solver);
+	const double solveTime = getTimeDetailed() - startTime;
+
+	Vector* direct = (Vector*) calloc(sampleCount, sizeof(Vector));
+	startTime = getTimeDetailed();
+	fieldSourceSetEvaluate(sources, samples, direct, sampleCount);
+	const double directTime = (getTimeDetailed() - startTime) * size * size * size / sampleCount;
+
+	double maxError = 0, maxField = 0;
+	size_t i;
+	for (i = 0; i < sampleCount; ++i) {
+		const Vector solved = gridSolverGetField(solver, (size_t) samples[i].x, (size_t) samples[i].y, (size_t) samples[i].z);
+		maxError = max(maxError, vectorGetLength(vectorSubstract(solved, direct[i])));
+		maxField = max(maxField, vectorGetLength(direct[i]));
+	}
+	const double paddedCount = (double) solver->padded[0] * solver->padded[1] * solver->padded[2];
+	printf("%6lu %8lu %8lu %10.1f %10.1f %12.2f %12.1f %12.2e\n",
+		(unsigned long) size,
+		(unsigned long) solver->padded[0],
+		(unsigned long) fieldSourceSetGetTotalCount(sources),
+		setupTime * 1000,
+		solveTime * 1000,
+		solveTime * 1.0e9 / (paddedCount * log2(paddedCount)),
+		directTime * 1000,
+		maxField > 0 ? maxError / maxField : 0
+	);
+
+	free(direct);
+	free(samples);
+	gridSolverFree(solver);
+	fieldSourceSetFree(sources);
+}
+
+int main(int argc, char** argv) {
+	static const size_t sizes[] = { 8, 16, 24, 32, 48, 64 };
+	const size_t threadCount = argc > 1 ? (size_t) atoi(argv[1]) : 0;
+	ThreadPool* pool = threadPoolNew(threadCount);
+	size_t i;
+	printf("%lu threads\n", (unsigned long) (pool ? threadPoolGetThreadCount(pool) : 1));
+	printf("%6s %8s %8s %10s %10s %12s %12s %12s\n", "size", "padded", "currents", "setup ms", "solve ms", "ns/(P lgP)", "direct ms", "max error");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+		runSize(sizes[i], pool);
+	}
+	threadPoolFree(pool);
+	return 0;
+}
@@ -0,0 +1,520 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Micro-benchmarks of the field and vector kernels, plus an accuracy check of every kernel against
+// a long double reference. With --accuracy only the check runs and the exit code reports whether
+// the configured error bounds hold.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+#else
+#define BENCH_UNIT "ns"
+#endif
+
+#include "test/math/Vector.h"
+#include "test/math/Elliptic.h"
+#include "test/physics/electromagnetism.h"
+#include "test/physics/FieldSource.h"
+#include "test/physics/FieldScene.h"
+#include "test/physics/SceneKernel.h"
+
+#define BENCH_SAMPLES 4096
+#define BENCH_MIN_TIME 0.05
+#define BENCH_DISTRIBUTIONS 4
+// default bounds, the build passes its configured ones on the command line
+#define BENCH_MAX_RELATIVE_ERROR 1.0e-11
+#define BENCH_MAX_ULPS 32768
+// wire steps of the loop reference, converged well before this for the near samples 0.5 off the wire
+#define BENCH_LOOP_STEPS 1024
+
+typedef long double Real;
+
+typedef struct RealVector {
+	Real x;
+	Real y;
+	Real z;
+} RealVector;
+
+typedef struct Distribution {
+	const char* name;
+	Vector positions[BENCH_SAMPLES];
+} Distribution;
+
+typedef struct AccuracyResult {
+	double maxRelativeError;
+	double maxUlps;
+} AccuracyResult;
+
+static Distribution _distributions[BENCH_DISTRIBUTIONS];
+static Vector _results[BENCH_SAMPLES];
+static volatile double _sink;
+static uint64_t _random = 0x9e3779b97f4a7c15ull;
+
+static const Conductor _element = { { 12, -12, -12 }, 6000, 0.25, { 4, 0.6, 0.6 } };
+static const FieldSegment _segment = { { -4, -6, 2 }, { 5, 7, -3 }, 3000, 0.25 };
+static const FieldLoop _loop = { { 2, -1, 3 }, { 1, 2, 2 }, 3, 500, 0.25 };
+static const FieldDipole _dipole = { { 0, 4, -2 }, { 0, 20000, 0 }, 0.25 };
+static const FieldCharge _charge = { { -3, 1, 6 }, { 2, 0, 1 }, 2000, 0.25 };
+
+// xorshift, so every run sees the same inputs
+static double randomUnit() {
+	_random ^= _random << 13;
+	_random ^= _random >> 7;
+	_random ^= _random << 17;
+	return (_random >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static Vector randomDirection() {
+	const double z = 2 * randomUnit() - 1;
+	const double angle = 2 * M_PI * randomUnit();
+	const double r = sqrt(1 - z * z);
+	return vectorCreate(r * cos(angle), r * sin(angle), z);
+}
+
+static void initDistributions() {
+	size_t i;
+	_distributions[0].name = "uniform";
+	_distributions[1].name = "near";
+	_distributions[2].name = "far";
+	_distributions[3].name = "axial";
+	for (i = 0; i < BENCH_SAMPLES; ++i) {
+		_distributions[0].positions[i] = vectorCreate(128 * randomUnit() - 64, 128 * randomUnit() - 64, 128 * randomUnit() - 64);
+		// a shell 0.5 to 2 around the sources, still clear of the wires
+		_distributions[1].positions[i] = vectorSum(_loop.center, vectorMultiply(randomDirection(), _loop.radius + (randomUnit() < 0.5 ? -1 : 1) * (0.5 + 1.5 * randomUnit())));
+		_distributions[2].positions[i] = vectorMultiply(randomDirection(), 1.0e3 + 9.0e3 * randomUnit());
+		_distributions[3].positions[i] = vectorSum(_loop.center, vectorMultiply(vectorNormalize(_loop.normal), 40 * randomUnit() - 20 + 1.0e-3 * randomUnit()));
+	}
+}
+
+static inline uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000ull + time.tv_nsec;
+#endif
+}
+
+static inline double readSeconds() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1.0e-9;
+}
+
+// --- benchmarks
+
+typedef void (*BenchBody)(const Vector* positions, size_t count);
+
+static FieldSourceKernel _benchKernel;
+static const void* _benchSource;
+static FieldScene* _benchScene;
+
+static void benchSourceKernel(const Vector* positions, size_t count) {
+	_benchKernel(_benchSource, 1, 1, positions, _results, count);
+}
+
+static void benchScene(const Vector* positions, size_t count) {
+	fieldSceneEvaluate(_benchScene, positions, _results, count);
+}
+
+static void benchFieldPoint(const Vector* positions, size_t count) {
+	double sum = 0;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		sum += calculateMagneticFieldPoint(_element.I, _element.permeability, _element.l, vectorSubstract(positions[i], _element.position)).x;
+	}
+	_sink = sum;
+}
+
+static void benchFieldPoints(const Vector* positions, size_t count) {
+	calculateMagneticFieldPoints(_element.I, _element.permeability, _element.l, _element.position, positions, _results, count);
+}
+
+static void benchCrossProduct(const Vector* positions, size_t count) {
+	double sum = 0;
+	size_t i;
+	for (i = 1; i < count; ++i) {
+		sum += vectorCrossProduct(positions[i - 1], positions[i]).y;
+	}
+	_sink = sum;
+}
+
+static void benchNormalize(const Vector* positions, size_t count) {
+	double sum = 0;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		sum += vectorNormalize(positions[i]).z;
+	}
+	_sink = sum;
+}
+
+static void benchRotate(const Vector* positions, size_t count) {
+	static const Vector rotation = { 0.1, -0.04, 0.2 };
+	double sum = 0;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		sum += vectorRotate(positions[i], rotation).x;
+	}
+	_sink = sum;
+}
+
+static void benchElliptic(const Vector* positions, size_t count) {
+	double m[BENCH_SAMPLES], K[BENCH_SAMPLES], E[BENCH_SAMPLES];
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		m[i] = fabs(positions[i].x) / (1 + fabs(positions[i].x));
+	}
+	ellipticIntegralsKE(m, K, E, count);
+	_sink = K[0] + E[count - 1];
+}
+
+// repeats the body until the timing is stable enough and returns the best ticks per evaluation
+static double measure(BenchBody body, const Vector* positions) {
+	double best = 1.0e300;
+	const double startTime = readSeconds();
+	do {
+		const uint64_t start = readTicks();
+		body(positions, BENCH_SAMPLES);
+		const double ticks = (double) (readTicks() - start) / BENCH_SAMPLES;
+		best = ticks < best ? ticks : best;
+	} while (readSeconds() - startTime < BENCH_MIN_TIME);
+	return best;
+}
+
+static void runBenchmark(const char* name, BenchBody body) {
+	size_t i;
+	printf("%-28s", name);
+	for (i = 0; i < BENCH_DISTRIBUTIONS; ++i) {
+		printf(" %10.1f", measure(body, _distributions[i].positions));
+	}
+	printf("\n");
+}
+
+static void runBenchmarks() {
+	const void* sources[FIELD_SOURCE_TYPE_COUNT] = { &_element, &_segment, &_loop, &_dipole, &_charge };
+	char name[64];
+	size_t i;
+	printf("%s per evaluation\n%-28s", BENCH_UNIT, "kernel");
+	for (i = 0; i < BENCH_DISTRIBUTIONS; ++i) {
+		printf(" %10s", _distributions[i].name);
+	}
+	printf("\n");
+	runBenchmark("calculateMagneticFieldPoint", benchFieldPoint);
+	runBenchmark("calculateMagneticFieldPoints", benchFieldPoints);
+	for (i = 0; i < FIELD_SOURCE_TYPE_COUNT; ++i) {
+		_benchKernel = fieldSourceGetKernel((FieldSourceType) i);
+		_benchSource = sources[i];
+		snprintf(name, sizeof(name), "source %s", fieldSourceGetTypeName((FieldSourceType) i));
+		runBenchmark(name, benchSourceKernel);
+	}
+
+	// the default scene through the generic kernels and through the one generated for it at build time
+	_benchScene = fieldSceneNew();
+	fieldSceneAddDefaultSources(_benchScene);
+	runBenchmark("scene generic", benchScene);
+	fieldSceneSetSpecialization(_benchScene, sceneKernelGetSpecialization());
+	if (fieldSceneGetSpecialization(_benchScene)) {
+		snprintf(name, sizeof(name), "scene %s specialized", fieldSceneGetSpecialization(_benchScene));
+		runBenchmark(name, benchScene);
+	}
+	fieldSceneFree(_benchScene);
+
+	runBenchmark("vectorCrossProduct", benchCrossProduct);
+	runBenchmark("vectorNormalize", benchNormalize);
+	runBenchmark("vectorRotate", benchRotate);
+	runBenchmark("ellipticIntegralsKE", benchElliptic);
+}
+
+// --- long double references
+
+static inline RealVector realVector(Vector a) {
+	RealVector result = { a.x, a.y, a.z };
+	return result;
+}
+
+static inline RealVector realCross(RealVector a, RealVector b) {
+	RealVector result = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	return result;
+}
+
+static inline Real realDot(RealVector a, RealVector b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline RealVector realScale(RealVector a, Real b) {
+	RealVector result = { a.x * b, a.y * b, a.z * b };
+	return result;
+}
+
+static inline RealVector realSubstract(RealVector a, RealVector b) {
+	RealVector result = { a.x - b.x, a.y - b.y, a.z - b.z };
+	return result;
+}
+
+static inline Real realLength(RealVector a) {
+	return sqrtl(realDot(a, a));
+}
+
+static RealVector referenceElement(const Conductor* c, Vector position) {
+	const RealVector l = realVector(c->l);
+	const RealVector r = realSubstract(realVector(position), realSubstract(realVector(c->position), realScale(l, -1)));
+	const Real rLen = realLength(r);
+	return realScale(realCross(l, r), (Real) c->permeability / (4 * M_PI) * c->I / (rLen * rLen * rLen));
+}
+
+static RealVector referenceSegment(const FieldSegment* s, Vector position) {
+	const RealVector r1 = realSubstract(realVector(position), realVector(s->start));
+	const RealVector r2 = realSubstract(realVector(position), realVector(s->end));
+	const Real r1Len = realLength(r1);
+	const Real r2Len = realLength(r2);
+	return realScale(realCross(r1, r2), (Real) s->permeability / (4 * M_PI) * s->I * (r1Len + r2Len) / (r1Len * r2Len * (r1Len * r2Len + realDot(r1, r2))));
+}
+
+// K and D = K - E, the latter straight from the AGM sum since subtracting loses it near m = 0
+static void referenceElliptic(Real m, Real* K, Real* D) {
+	Real a = 1, b = sqrtl(1 - m), sum = m / 2, power = 0.5L;
+	int i;
+	for (i = 0; i < 32; ++i) {
+		const Real c = (a - b) / 2;
+		const Real nextA = (a + b) / 2;
+		b = sqrtl(a * b);
+		a = nextA;
+		power *= 2;
+		sum += power * c * c;
+		if (fabsl(c) < 1.0e-19L) {
+			break;
+		}
+	}
+	*K = (Real) M_PI / 2 / a;
+	*D = *K * sum;
+}
+
+// Biot-Savart summed around the wire instead of the elliptic closed form the kernel uses, so the two share
+// nothing; the integrand is smooth and periodic, for which the trapezoidal rule converges geometrically
+static RealVector referenceLoop(const FieldLoop* loop, Vector position) {
+	const RealVector normal = realScale(realVector(loop->normal), 1 / realLength(realVector(loop->normal)));
+	const RealVector helper = fabsl(normal.x) < 0.5L ? (RealVector) { 1, 0, 0 } : (RealVector) { 0, 1, 0 };
+	const RealVector u = realScale(realCross(normal, helper), 1 / realLength(realCross(normal, helper)));
+	const RealVector v = realCross(normal, u);
+	const RealVector d = realSubstract(realVector(position), realVector(loop->center));
+	const Real a = loop->radius;
+	static Real cosines[BENCH_LOOP_STEPS], sines[BENCH_LOOP_STEPS];
+	RealVector result = { 0, 0, 0 };
+	int i;
+	if (sines[1] == 0) {
+		for (i = 0; i < BENCH_LOOP_STEPS; ++i) {
+			cosines[i] = cosl(2 * (Real) M_PI * i / BENCH_LOOP_STEPS);
+			sines[i] = sinl(2 * (Real) M_PI * i / BENCH_LOOP_STEPS);
+		}
+	}
+	for (i = 0; i < BENCH_LOOP_STEPS; ++i) {
+		const Real c = cosines[i], s = sines[i];
+		const RealVector wire = { a * (c * u.x + s * v.x), a * (c * u.y + s * v.y), a * (c * u.z + s * v.z) };
+		const RealVector tangent = { a * (c * v.x - s * u.x), a * (c * v.y - s * u.y), a * (c * v.z - s * u.z) };
+		const RealVector r = realSubstract(d, wire);
+		const Real rLen = realLength(r);
+		const RealVector b = realScale(realCross(tangent, r), 1 / (rLen * rLen * rLen));
+		result.x += b.x;
+		result.y += b.y;
+		result.z += b.z;
+	}
+	return realScale(result, (Real) loop->permeability / (4 * M_PI) * loop->I * 2 * (Real) M_PI / BENCH_LOOP_STEPS);
+}
+
+static RealVector referenceDipole(const FieldDipole* d, Vector position) {
+	const RealVector r = realSubstract(realVector(position), realVector(d->position));
+	const RealVector m = realVector(d->moment);
+	const Real rLen = realLength(r);
+	const Real rInv3 = 1 / (rLen * rLen * rLen);
+	const Real k = 3 * realDot(m, r) / (rLen * rLen);
+	return realScale(realSubstract(realScale(r, k), m), (Real) d->permeability / (4 * M_PI) * rInv3);
+}
+
+static RealVector referenceCharge(const FieldCharge* c, Vector position) {
+	const RealVector r = realSubstract(realVector(position), realVector(c->position));
+	const Real rLen = realLength(r);
+	return realScale(realCross(realVector(c->velocity), r), (Real) c->permeability / (4 * M_PI) * c->q / (rLen * rLen * rLen));
+}
+
+static RealVector referenceRotate(Vector a, Vector rotation) {
+	const RealVector n = realScale(realVector(a), 1 / realLength(realVector(a)));
+	const Real length = realLength(realVector(a));
+	const Real signY = n.y > 0 ? 1 : (n.y < 0 ? -1 : 0);
+	const Real signZ = n.z > 0 ? 1 : (n.z < 0 ? -1 : 0);
+	const Real rx = (n.z > 0 ? asinl(n.y) : signY * (Real) M_PI - asinl(n.y)) + rotation.x;
+	const Real ry = (n.x > 0 ? asinl(n.z) : signZ * (Real) M_PI - asinl(n.z)) + rotation.y;
+	const RealVector result = { cosl(ry) * length, sinl(rx) * length, sinl(ry) * length };
+	return result;
+}
+
+// --- accuracy
+
+// errors are measured against the magnitude of the reference, so tiny components of a large vector don't dominate
+static void accumulateError(AccuracyResult* result, Vector value, RealVector reference) {
+	const Real length = realLength(reference);
+	if (!(length > 0)) {
+		return;
+	}
+	const double ulp = nextafter((double) length, INFINITY) - (double) length;
+	const Real error = realLength(realSubstract(realVector(value), reference));
+	const double relative = (double) (error / length);
+	const double ulps = (double) (error / ulp);
+	if (relative > result->maxRelativeError || relative != relative) {
+		result->maxRelativeError = relative;
+	}
+	if (ulps > result->maxUlps || ulps != ulps) {
+		result->maxUlps = ulps;
+	}
+}
+
+static int reportAccuracy(const char* name, AccuracyResult result, double maxRelativeError, double maxUlps) {
+	const int passed = result.maxRelativeError <= maxRelativeError && result.maxUlps <= maxUlps;
+	printf("%-28s %12.3e %12.1f  %s\n", name, result.maxRelativeError, result.maxUlps, passed ? "ok" : "FAILED");
+	return passed;
+}
+
+static int checkSource(const FieldSource* source, RealVector (*reference)(const FieldSource*, Vector), double maxRelativeError, double maxUlps) {
+	AccuracyResult result = { 0, 0 };
+	size_t i, j;
+	for (i = 0; i < BENCH_DISTRIBUTIONS; ++i) {
+		const Vector* positions = _distributions[i].positions;
+		memset(_results, 0, sizeof(_results));
+		fieldSourceEvaluate(source, 1, positions, _results, BENCH_SAMPLES);
+		for (j = 0; j < BENCH_SAMPLES; ++j) {
+			accumulateError(&result, _results[j], reference(source, positions[j]));
+		}
+	}
+	char name[64];
+	snprintf(name, sizeof(name), "source %s", fieldSourceGetTypeName(source->type));
+	return reportAccuracy(name, result, maxRelativeError, maxUlps);
+}
+
+static RealVector referenceSource(const FieldSource* source, Vector position) {
+	switch (source->type) {
+		case FIELD_SOURCE_ELEMENT:
+			return referenceElement(&source->element, position);
+		case FIELD_SOURCE_SEGMENT:
+			return referenceSegment(&source->segment, position);
+		case FIELD_SOURCE_LOOP:
+			return referenceLoop(&source->loop, position);
+		case FIELD_SOURCE_DIPOLE:
+			return referenceDipole(&source->dipole, position);
+		default:
+			return referenceCharge(&source->charge, position);
+	}
+}
+
+static int runAccuracy(double maxRelativeError, double maxUlps) {
+	FieldSource sources[FIELD_SOURCE_TYPE_COUNT];
+	AccuracyResult result;
+	int passed = 1;
+	size_t i, j;
+	sources[0].type = FIELD_SOURCE_ELEMENT;
+	sources[0].element = _element;
+	sources[1].type = FIELD_SOURCE_SEGMENT;
+	sources[1].segment = _segment;
+	sources[2].type = FIELD_SOURCE_LOOP;
+	sources[2].loop = _loop;
+	sources[3].type = FIELD_SOURCE_DIPOLE;
+	sources[3].dipole = _dipole;
+	sources[4].type = FIELD_SOURCE_CHARGE;
+	sources[4].charge = _charge;
+
+	printf("%-28s %12s %12s\n", "kernel", "rel. error", "ulps");
+	result = (AccuracyResult) { 0, 0 };
+	for (i = 0; i < BENCH_DISTRIBUTIONS; ++i) {
+		for (j = 0; j < BENCH_SAMPLES; ++j) {
+			const Vector position = _distributions[i].positions[j];
+			accumulateError(&result, calculateMagneticFieldPoint(_element.I, _element.permeability, _element.l, vectorSubstract(position, _element.position)), referenceElement(&_element, position));
+		}
+	}
+	passed &= reportAccuracy("calculateMagneticFieldPoint", result, maxRelativeError, maxUlps);
+	for (i = 0; i < FIELD_SOURCE_TYPE_COUNT; ++i) {
+		passed &= checkSource(sources + i, referenceSource, maxRelativeError, maxUlps);
+	}
+
+	AccuracyResult cross = { 0, 0 }, normalize = { 0, 0 }, rotate = { 0, 0 }, lerp = { 0, 0 }, elliptic = { 0, 0 };
+	static const Vector rotation = { 0.1, -0.04, 0.2 };
+	for (i = 0; i < BENCH_DISTRIBUTIONS; ++i) {
+		const Vector* positions = _distributions[i].positions;
+		for (j = 1; j < BENCH_SAMPLES; ++j) {
+			const RealVector a = realVector(positions[j - 1]);
+			const RealVector b = realVector(positions[j]);
+			accumulateError(&cross, vectorCrossProduct(positions[j - 1], positions[j]), realCross(a, b));
+			accumulateError(&normalize, vectorNormalize(positions[j]), realScale(b, 1 / realLength(b)));
+			accumulateError(&rotate, vectorRotate(positions[j], rotation), referenceRotate(positions[j], rotation));
+			const RealVector lerped = realSubstract(a, realScale(realSubstract(a, b), 0.25L));
+			accumulateError(&lerp, vectorLerp(positions[j - 1], positions[j], 0.25), lerped);
+		}
+	}
+	passed &= reportAccuracy("vectorCrossProduct", cross, maxRelativeError, maxUlps);
+	passed &= reportAccuracy("vectorNormalize", normalize, maxRelativeError, maxUlps);
+	passed &= reportAccuracy("vectorRotate", rotate, maxRelativeError, maxUlps);
+	passed &= reportAccuracy("vectorLerp", lerp, maxRelativeError, maxUlps);
+
+	for (i = 0; i < BENCH_SAMPLES; ++i) {
+		double m, K, E;
+		Real referenceK, referenceD;
+		m = (double) (i + 1) / (BENCH_SAMPLES + 1);
+		m = 1 - m * m * m; // crowd the samples towards the logarithmic end
+		ellipticIntegralsKE(&m, &K, &E, 1);
+		referenceElliptic(m, &referenceK, &referenceD);
+		const RealVector reference = { referenceK, referenceK - referenceD, 0 };
+		accumulateError(&elliptic, vectorCreate(K, E, 0), reference);
+	}
+	passed &= reportAccuracy("ellipticIntegralsKE", elliptic, maxRelativeError, maxUlps);
+	return passed;
+}
+
+int main(int argc, char **argv) {
+	double maxRelativeError = BENCH_MAX_RELATIVE_ERROR;
+	double maxUlps = BENCH_MAX_ULPS;
+	int accuracyOnly = 0;
+	int i;
+	for (i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--accuracy")) {
+			accuracyOnly = 1;
+		} else if (!strcmp(argv[i], "--max-relative-error") && i + 1 < argc) {
+			maxRelativeError = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--max-ulps") && i + 1 < argc) {
+			maxUlps = atof(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [--accuracy] [--max-relative-error X] [--max-ulps N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	initDistributions();
+	if (!accuracyOnly) {
+		runBenchmarks();
+		printf("\n");
+	}
+	return runAccuracy(maxRelativeError, maxUlps) ? 0 : 1;
+}
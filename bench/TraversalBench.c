@@ -0,0 +1,217 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// A million field samples of a 100^3 block of cells, inserted in random order like a viewer flying
+// around fills its window, once as heap records behind an array of pointers in insertion order and
+// once inline in a Morton ordered array. Reports time and, where perf counters are available, cache
+// misses per point for a full traversal, a box query and a neighbour stencil run in storage order.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "test/math/Vector.h"
+#include "test/collections/DynamicArray.h"
+#include "test/collections/HashMap.h"
+#include "test/collections/MortonArray.h"
+#include "test/tools/TimeTools.h"
+
+#define BENCH_SIDE 100
+#define BENCH_POINTS (BENCH_SIDE * BENCH_SIDE * BENCH_SIDE)
+#define BENCH_BOX_FROM 38
+#define BENCH_BOX_TO 61 // a 24^3 box in the middle
+
+typedef struct BenchPoint {
+	Vector position;
+	Vector direction;
+} BenchPoint;
+
+typedef struct BenchResult {
+	double seconds;
+	long long cacheMisses; // -1 without perf counters
+	double checksum;
+} BenchResult;
+
+static DynamicArray* _heapPoints;
+static HashMap* _heapIndex;
+static MortonArray* _mortonPoints;
+static HashMap* _mortonIndex; // index + 1, so 0 stays free for missing cells
+static int _perfFd = -1;
+
+static inline uint64_t benchKey(int x, int y, int z) {
+	return ((uint64_t) x * BENCH_SIDE + (uint64_t) y) * BENCH_SIDE + (uint64_t) z;
+}
+
+static void openCacheMissCounter() {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	_perfFd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void startMeasure(BenchResult* result) {
+	if (_perfFd >= 0) {
+		ioctl(_perfFd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(_perfFd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	result->seconds = getTimeDetailed();
+}
+
+static void stopMeasure(BenchResult* result) {
+	long long misses = -1;
+	result->seconds = getTimeDetailed() - result->seconds;
+	if (_perfFd >= 0) {
+		ioctl(_perfFd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(_perfFd, &misses, sizeof(misses)) != sizeof(misses)) {
+			misses = -1;
+		}
+	}
+	result->cacheMisses = misses;
+}
+
+static void initPoints() {
+	int* order = (int*) malloc(sizeof(int) * BENCH_POINTS);
+	size_t i;
+	for (i = 0; i < BENCH_POINTS; ++i) {
+		order[i] = (int) i;
+	}
+	srand(42);
+	for (i = BENCH_POINTS - 1; i > 0; --i) {
+		const size_t j = ((size_t) rand() * ((size_t) RAND_MAX + 1) + (size_t) rand()) % (i + 1);
+		const int t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+
+	_heapPoints = arrayNew(BENCH_POINTS);
+	_heapIndex = mapNew(BENCH_POINTS);
+	_mortonPoints = mortonArrayNew(MEMORY_TAG_FIELD_POINTS, sizeof(BenchPoint), BENCH_POINTS);
+	_mortonIndex = mapNew(BENCH_POINTS);
+	for (i = 0; i < BENCH_POINTS; ++i) {
+		const int x = order[i] / (BENCH_SIDE * BENCH_SIDE), y = order[i] / BENCH_SIDE % BENCH_SIDE, z = order[i] % BENCH_SIDE;
+		const BenchPoint point = { { x, y, z }, { 1.0 / (1 + x), 1.0 / (1 + y), 1.0 / (1 + z) } };
+		BenchPoint* heapPoint = (BenchPoint*) malloc(sizeof(BenchPoint));
+		*heapPoint = point;
+		arrayAppend(_heapPoints, heapPoint);
+		mapPut(_heapIndex, benchKey(x, y, z), heapPoint);
+		*(BenchPoint*) mortonArrayAppend(_mortonPoints, x, y, z) = point;
+	}
+	mortonArraySort(_mortonPoints);
+	for (i = 0; i < BENCH_POINTS; ++i) {
+		const BenchPoint* point = (const BenchPoint*) mortonArrayGetAt(_mortonPoints, i);
+		mapPut(_mortonIndex, benchKey((int) point->position.x, (int) point->position.y, (int) point->position.z), (void*) (i + 1));
+	}
+	free(order);
+}
+
+static inline int isInBox(const BenchPoint* point) {
+	return point->position.x >= BENCH_BOX_FROM && point->position.x <= BENCH_BOX_TO &&
+		point->position.y >= BENCH_BOX_FROM && point->position.y <= BENCH_BOX_TO &&
+		point->position.z >= BENCH_BOX_FROM && point->position.z <= BENCH_BOX_TO;
+}
+
+static inline const BenchPoint* getHeapNeighbour(const BenchPoint* point, int dx, int dy, int dz) {
+	return (const BenchPoint*) mapGet(_heapIndex, benchKey((int) point->position.x + dx, (int) point->position.y + dy, (int) point->position.z + dz));
+}
+
+static inline const BenchPoint* getMortonNeighbour(const BenchPoint* point, int dx, int dy, int dz) {
+	const size_t index = (size_t) mapGet(_mortonIndex, benchKey((int) point->position.x + dx, (int) point->position.y + dy, (int) point->position.z + dz));
+	return index ? (const BenchPoint*) mortonArrayGetAt(_mortonPoints, index - 1) : NULL;
+}
+
+static BenchResult traverseHeap(int workload) {
+	BenchResult result = { 0, 0, 0 };
+	size_t i;
+	startMeasure(&result);
+	for (i = 0; i < BENCH_POINTS; ++i) {
+		const BenchPoint* point = (const BenchPoint*) arrayGetAt(_heapPoints, i);
+		if (workload == 0 || (workload == 1 && isInBox(point))) {
+			result.checksum += point->direction.x + point->direction.y + point->direction.z;
+		} else if (workload == 2 && point->position.x + 1 < BENCH_SIDE && point->position.y + 1 < BENCH_SIDE && point->position.z + 1 < BENCH_SIDE) {
+			result.checksum += getHeapNeighbour(point, 1, 0, 0)->direction.x + getHeapNeighbour(point, 0, 1, 0)->direction.y +
+				getHeapNeighbour(point, 0, 0, 1)->direction.z - 3 * point->direction.x;
+		}
+	}
+	stopMeasure(&result);
+	return result;
+}
+
+static BenchResult traverseMorton(int workload) {
+	BenchResult result = { 0, 0, 0 };
+	const uint64_t minCode = mortonEncode(BENCH_BOX_FROM, BENCH_BOX_FROM, BENCH_BOX_FROM);
+	const uint64_t maxCode = mortonEncode(BENCH_BOX_TO, BENCH_BOX_TO, BENCH_BOX_TO);
+	size_t i;
+	startMeasure(&result);
+	if (workload == 1) {
+		for (i = mortonArrayNextInBox(_mortonPoints, 0, minCode, maxCode); i < BENCH_POINTS; i = mortonArrayNextInBox(_mortonPoints, i + 1, minCode, maxCode)) {
+			const BenchPoint* point = (const BenchPoint*) mortonArrayGetAt(_mortonPoints, i);
+			result.checksum += point->direction.x + point->direction.y + point->direction.z;
+		}
+	} else {
+		for (i = 0; i < BENCH_POINTS; ++i) {
+			const BenchPoint* point = (const BenchPoint*) mortonArrayGetAt(_mortonPoints, i);
+			if (workload == 0) {
+				result.checksum += point->direction.x + point->direction.y + point->direction.z;
+			} else if (point->position.x + 1 < BENCH_SIDE && point->position.y + 1 < BENCH_SIDE && point->position.z + 1 < BENCH_SIDE) {
+				result.checksum += getMortonNeighbour(point, 1, 0, 0)->direction.x + getMortonNeighbour(point, 0, 1, 0)->direction.y +
+					getMortonNeighbour(point, 0, 0, 1)->direction.z - 3 * point->direction.x;
+			}
+		}
+	}
+	stopMeasure(&result);
+	return result;
+}
+
+static void printResult(const char* name, const char* layout, BenchResult result) {
+	printf("%-12s %-18s %10.2f", name, layout, result.seconds * 1.0e9 / BENCH_POINTS);
+	if (result.cacheMisses >= 0) {
+		printf(" %14.3f", (double) result.cacheMisses / BENCH_POINTS);
+	} else {
+		printf(" %14s", "-");
+	}
+	printf("   (checksum %.6g)\n", result.checksum);
+}
+
+int main(void) {
+	static const char* workloads[] = { "traverse", "box query", "stencil" };
+	int workload;
+	initPoints();
+	openCacheMissCounter();
+	printf("%d points, per point of the whole set\n", BENCH_POINTS);
+	printf("%-12s %-18s %10s %14s\n", "workload", "layout", "ns", "cache misses");
+	for (workload = 0; workload < 3; ++workload) {
+		// the first run of each warms the caches and the allocator up
+		traverseHeap(workload);
+		printResult(workloads[workload], "insertion order", traverseHeap(workload));
+		traverseMorton(workload);
+		printResult(workloads[workload], "Morton order", traverseMorton(workload));
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Flight through the default scene while a worker computes the window of field samples around the
+// camera as a job per camera position. Reports how much of the planned work was cancelled because
+// the camera had moved on, and how much was computed for a window that was already stale, with
+// cooperative cancellation on and off.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "test/math/Vector.h"
+#include "test/physics/FieldScene.h"
+#include "test/tools/JobSystem.h"
+#include "test/tools/TimeTools.h"
+
+#define BENCH_CELL_STEP 2
+#define BENCH_WINDOW_RADIUS 24
+#define BENCH_WINDOW_SIDE (2 * BENCH_WINDOW_RADIUS / BENCH_CELL_STEP + 1)
+#define BENCH_WINDOW_CELLS (BENCH_WINDOW_SIDE * BENCH_WINDOW_SIDE * BENCH_WINDOW_SIDE)
+#define BENCH_CHUNK 64
+
+typedef struct WindowWork {
+	Job job;
+	Vector camera;
+	size_t next;
+	Vector results[BENCH_CHUNK];
+} WindowWork;
+
+static FieldScene* _scene;
+static Vector _offsets[BENCH_WINDOW_CELLS]; // nearest first, like the viewer orders its cells
+
+static int compareOffsets(const void* a, const void* b) {
+	const double lengthA = vectorGetLengthSq(*(const Vector*) a);
+	const double lengthB = vectorGetLengthSq(*(const Vector*) b);
+	return lengthA < lengthB ? -1 : lengthA > lengthB;
+}
+
+static void initOffsets() {
+	int x, y, z;
+	size_t i = 0;
+	for (x = -BENCH_WINDOW_RADIUS; x <= BENCH_WINDOW_RADIUS; x += BENCH_CELL_STEP) {
+		for (y = -BENCH_WINDOW_RADIUS; y <= BENCH_WINDOW_RADIUS; y += BENCH_CELL_STEP) {
+			for (z = -BENCH_WINDOW_RADIUS; z <= BENCH_WINDOW_RADIUS; z += BENCH_CELL_STEP) {
+				_offsets[i++] = vectorCreate(x, y, z);
+			}
+		}
+	}
+	qsort(_offsets, BENCH_WINDOW_CELLS, sizeof(Vector), compareOffsets);
+}
+
+static size_t computeWindowChunk(Job* job) {
+	WindowWork* work = (WindowWork*) job->arg;
+	Vector positions[BENCH_CHUNK];
+	size_t i, count = BENCH_WINDOW_CELLS - work->next < BENCH_CHUNK ? BENCH_WINDOW_CELLS - work->next : BENCH_CHUNK;
+	for (i = 0; i < count; ++i) {
+		positions[i] = vectorSum(work->camera, _offsets[work->next + i]);
+		work->results[i] = vectorZero;
+	}
+	fieldSceneEvaluate(_scene, positions, work->results, count);
+	work->next += count;
+	return count;
+}
+
+static void releaseWindow(Job* job, int cancelled) {
+	(void) cancelled;
+	free(job->arg);
+}
+
+// current loops along the flight path make the scene expensive enough that a window outlives a frame
+static void addLoops(int count) {
+	int i;
+	for (i = 0; i < count; ++i) {
+		FieldSource source = { .type = FIELD_SOURCE_LOOP };
+		const double angle = 2 * M_PI * i / count;
+		source.loop = (FieldLoop) { { -40 + 160.0 * i / count, 10 * cos(angle), 10 * sin(angle) }, { cos(angle), sin(angle), 1 }, 3, 2000, 0.25 };
+		fieldSceneAddSource(_scene, &source);
+	}
+}
+
+static JobSystemStats fly(int cancelStale, double seconds, double interval, unsigned long* windows) {
+	JobSystem* system = jobSystemNew(1);
+	jobSystemSetCancelStale(system, cancelStale);
+	Vector camera = { -60, 3, 1 };
+	const double startTime = getTimeDetailed();
+	*windows = 0;
+	while (getTimeDetailed() - startTime < seconds) {
+		WindowWork* work = (WindowWork*) calloc(1, sizeof(WindowWork));
+		work->camera = camera;
+		work->job = (Job) { computeWindowChunk, releaseWindow, work, BENCH_WINDOW_CELLS, 0, NULL, NULL };
+		jobSystemAdvance(system);
+		jobSystemSubmit(system, &work->job);
+		++*windows;
+		usleep((useconds_t) (interval * 1.0e6));
+		camera.x += BENCH_CELL_STEP;
+	}
+
+	// whatever the flight left queued is dropped, only the work done during the flight counts
+	jobSystemSetCancelStale(system, 1);
+	jobSystemAdvance(system);
+	jobSystemWait(system);
+	const JobSystemStats stats = jobSystemGetStats(system);
+	jobSystemFree(system);
+	return stats;
+}
+
+static void report(const char* name, JobSystemStats stats, unsigned long windows) {
+	const double planned = (double) stats.workDone + stats.workCancelled;
+	printf("%-16s windows: %6lu, computed: %10llu, cancelled: %5.1f%% of planned, stale: %5.1f%% of computed\n",
+		name,
+		windows,
+		stats.workDone,
+		planned > 0 ? 100.0 * stats.workCancelled / planned : 0.0,
+		stats.workDone ? 100.0 * stats.workStale / stats.workDone : 0.0
+	);
+}
+
+int main(int argc, char **argv) {
+	double seconds = 2;
+	double interval = 0.016;
+	int loops = 32;
+	unsigned long windows;
+	int i;
+	for (i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+			seconds = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--interval-ms") && i + 1 < argc) {
+			interval = atof(argv[++i]) / 1000;
+		} else if (!strcmp(argv[i], "--loops") && i + 1 < argc) {
+			loops = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [--seconds S] [--interval-ms MS] [--loops N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	_scene = fieldSceneNew();
+	fieldSceneAddDefaultSources(_scene);
+	addLoops(loops);
+	initOffsets();
+	printf("flight: %.1fs, camera moves one cell every %.1fms, window of %d cells computed in chunks of %d, %lu sources\n",
+		seconds, interval * 1000, BENCH_WINDOW_CELLS, BENCH_CHUNK, (unsigned long) fieldSceneGetSourceCount(_scene, FIELD_SOURCE_TYPE_COUNT));
+	JobSystemStats stats = fly(1, seconds, interval, &windows);
+	report("cancellation on", stats, windows);
+	stats = fly(0, seconds, interval, &windows);
+	report("cancellation off", stats, windows);
+	fieldSceneFree(_scene);
+	return 0;
+}
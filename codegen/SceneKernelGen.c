@@ -0,0 +1,167 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Turns a scene file into a header with a kernel specialized for exactly that scene. Every conductor
+// element is unrolled into one pass over the positions, with its origin, direction and
+// permeability / (4 pi) * I folded into exact hexadecimal literals; the other source types keep
+// their generic kernels over constant arrays. src/physics/SceneKernel.c includes the result.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "test/physics/FieldScene.h"
+
+static const char* const _typeConstants[FIELD_SOURCE_TYPE_COUNT] = {
+	"FIELD_SOURCE_ELEMENT", "FIELD_SOURCE_SEGMENT", "FIELD_SOURCE_LOOP", "FIELD_SOURCE_DIPOLE", "FIELD_SOURCE_CHARGE"
+};
+
+// a * b - c * d with the factors that are exactly 0 left out, so the compiler has nothing to multiply by zero
+static void writeCrossTerm(FILE* out, const char* component, double a, const char* b, double c, const char* d) {
+	fprintf(out, "\t\t\tb%s += (", component);
+	if (a != 0 && c != 0) {
+		fprintf(out, "%a * %s - %a * %s", a, b, c, d);
+	} else if (a != 0) {
+		fprintf(out, "%a * %s", a, b);
+	} else if (c != 0) {
+		fprintf(out, "-(%a * %s)", c, d);
+	} else {
+		fprintf(out, "0.0");
+	}
+	fprintf(out, ") * k;\n");
+}
+
+// "p - o", written as "p + |o|" for negative o, which is the same in IEEE arithmetic
+static void writeDifference(FILE* out, const char* name, const char* position, double origin) {
+	fprintf(out, "\t\t\tconst double %s = %s %c %a;\n", name, position, origin < 0 ? '+' : '-', fabs(origin));
+}
+
+static void writeSources(FILE* out, const FieldSourceSet* set) {
+	int type;
+	size_t i, j;
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		if (!set->counts[type]) {
+			continue;
+		}
+		const size_t valueCount = fieldSourceGetTypeSize((FieldSourceType) type) / sizeof(double);
+		// source structs are runs of doubles, so a flat array has their layout
+		fprintf(out, "static const double _scene%c%ss[%lu] = {\n", fieldSourceGetTypeName((FieldSourceType) type)[0] - 'a' + 'A',
+			fieldSourceGetTypeName((FieldSourceType) type) + 1, (unsigned long) (set->counts[type] * valueCount));
+		for (i = 0; i < set->counts[type]; ++i) {
+			const double* values = (const double*) set->sources[type] + valueCount * i;
+			fprintf(out, "\t");
+			for (j = 0; j < valueCount; ++j) {
+				fprintf(out, "%s%a", j ? ", " : "", values[j]);
+			}
+			fprintf(out, "%s\n", i + 1 < set->counts[type] ? "," : "");
+		}
+		fprintf(out, "};\n");
+	}
+	fprintf(out, "static const size_t _sceneCounts[FIELD_SOURCE_TYPE_COUNT] = { ");
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		fprintf(out, "%s%lu", type ? ", " : "", (unsigned long) set->counts[type]);
+	}
+	fprintf(out, " };\nstatic const void* const _sceneSources[FIELD_SOURCE_TYPE_COUNT] = { ");
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		const char* name = fieldSourceGetTypeName((FieldSourceType) type);
+		if (set->counts[type]) {
+			fprintf(out, "%s_scene%c%ss", type ? ", " : "", name[0] - 'a' + 'A', name + 1);
+		} else {
+			fprintf(out, "%sNULL", type ? ", " : "");
+		}
+	}
+	fprintf(out, " };\n\n");
+}
+
+static void writeKernel(FILE* out, const FieldSourceSet* set) {
+	const Conductor* elements = (const Conductor*) set->sources[FIELD_SOURCE_ELEMENT];
+	int type;
+	size_t i;
+	fprintf(out, "static void evaluateGeneratedScene(const Vector* positions, Vector* results, size_t count) {\n");
+	if (set->counts[FIELD_SOURCE_ELEMENT]) {
+		fprintf(out, "\tsize_t i;\n\tfor (i = 0; i < count; ++i) {\n");
+		fprintf(out, "\t\tconst double px = positions[i].x, py = positions[i].y, pz = positions[i].z;\n");
+		fprintf(out, "\t\tdouble bx = results[i].x, by = results[i].y, bz = results[i].z;\n");
+		for (i = 0; i < set->counts[FIELD_SOURCE_ELEMENT]; ++i) {
+			// the same expressions as calculateMagneticFieldPoints, in the same order
+			const Conductor* c = elements + i;
+			const double constant = c->permeability / (4 * M_PI) * (1 * c->I);
+			fprintf(out, "\t\t{\n");
+			writeDifference(out, "rx", "px", c->position.x + c->l.x);
+			writeDifference(out, "ry", "py", c->position.y + c->l.y);
+			writeDifference(out, "rz", "pz", c->position.z + c->l.z);
+			fprintf(out, "\t\t\tconst double rLenSq = rx * rx + ry * ry + rz * rz;\n");
+			fprintf(out, "\t\t\tconst double k = %a / (rLenSq * sqrt(rLenSq));\n", constant);
+			writeCrossTerm(out, "x", c->l.y, "rz", c->l.z, "ry");
+			writeCrossTerm(out, "y", c->l.z, "rx", c->l.x, "rz");
+			writeCrossTerm(out, "z", c->l.x, "ry", c->l.y, "rx");
+			fprintf(out, "\t\t}\n");
+		}
+		fprintf(out, "\t\tresults[i].x = bx;\n\t\tresults[i].y = by;\n\t\tresults[i].z = bz;\n\t}\n");
+	}
+	for (type = FIELD_SOURCE_ELEMENT + 1; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		if (set->counts[type]) {
+			fprintf(out, "\tfieldSourceGetKernel(%s)(_sceneSources[%s], _sceneCounts[%s], 1, positions, results, count);\n",
+				_typeConstants[type], _typeConstants[type], _typeConstants[type]);
+		}
+	}
+	fprintf(out, "}\n");
+}
+
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s SCENE_FILE OUTPUT_HEADER\n", argv[0]);
+		return 2;
+	}
+	FieldScene* scene = fieldSceneNew();
+	if (!scene || fieldSceneLoadFile(scene, argv[1]) < 0) {
+		return EXIT_FAILURE;
+	}
+	FieldSourceSet* set = fieldSceneCopySources(scene);
+	FILE* out = fopen(argv[2], "w");
+	if (!set || !out) {
+		fprintf(stderr, "error: Can't write %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	const char* name = strrchr(argv[1], '/');
+	name = name ? name + 1 : argv[1];
+	fprintf(out, "// generated from %s by %s, do not edit\n\n", name, "MagneticTest_scenegen");
+	fprintf(out, "#define SCENE_KERNEL_NAME \"%.*s\"\n\n", (int) strcspn(name, "."), name);
+	writeSources(out, set);
+	fprintf(out, "static int matchGeneratedScene(const FieldSourceSet* set) {\n");
+	fprintf(out, "\tint type;\n\tfor (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {\n");
+	fprintf(out, "\t\tif (set->counts[type] != _sceneCounts[type] ||\n");
+	fprintf(out, "\t\t\t(_sceneCounts[type] && memcmp(set->sources[type], _sceneSources[type], fieldSourceGetTypeSize((FieldSourceType) type) * _sceneCounts[type]))) {\n");
+	fprintf(out, "\t\t\treturn 0;\n\t\t}\n\t}\n\treturn 1;\n}\n\n");
+	writeKernel(out, set);
+
+	const int failed = ferror(out);
+	fclose(out);
+	fieldSourceSetFree(set);
+	fieldSceneFree(scene);
+	if (failed) {
+		fprintf(stderr, "error: Can't write %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_HASHMAP_H
+#define TEST_HASHMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct HashMapEntry {
+	uint64_t key;
+	void* value;
+	int used;
+} HashMapEntry;
+
+// open addressing with linear probing, keys are integers (e.g. packed cell coordinates)
+typedef struct HashMap {
+	HashMapEntry* rawArray;
+	size_t length;
+	size_t capacity;
+} HashMap;
+
+HashMap* mapNew(size_t initialCapacity);
+void mapFree(HashMap* map);
+void mapFreeWithContents(HashMap* map);
+size_t mapGetLength(const HashMap* map);
+void* mapGet(const HashMap* map, uint64_t key);
+int mapContains(const HashMap* map, uint64_t key);
+void mapPut(HashMap* map, uint64_t key, void* value);
+void* mapRemove(HashMap* map, uint64_t key);
+void mapRemoveAll(HashMap* map);
+
+#endif //TEST_HASHMAP_H
@@ -0,0 +1,68 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_MORTONARRAY_H
+#define TEST_MORTONARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test/tools/MemoryStats.h"
+
+// fixed size items stored inline and keyed by an integer cell, cells take 21 bits per axis like the cell keys elsewhere
+typedef struct MortonArray {
+	uint64_t* codes;
+	char* items;
+	size_t itemSize;
+	size_t length;
+	size_t sortedLength; // [0, sortedLength) is in Morton order, the rest in insertion order until the next sort
+	size_t capacity;
+	uint64_t* spareCodes;
+	char* spareItems;
+	MemoryTag tag;
+	unsigned long sorts;
+} MortonArray;
+
+uint64_t mortonEncode(int x, int y, int z);
+void mortonDecode(uint64_t code, int* x, int* y, int* z);
+int mortonContains(uint64_t code, uint64_t minCode, uint64_t maxCode);
+
+MortonArray* mortonArrayNew(MemoryTag tag, size_t itemSize, size_t initialCapacity);
+void mortonArrayFree(MortonArray* array);
+size_t mortonArrayGetLength(const MortonArray* array);
+void* mortonArrayGetAt(const MortonArray* array, size_t index);
+uint64_t mortonArrayGetCode(const MortonArray* array, size_t index);
+// returns storage for the new item, which is valid until the next append, sort or retain; NULL without memory
+void* mortonArrayAppend(MortonArray* array, int x, int y, int z);
+// merges the unsorted tail into the ordered part, cheap while the tail is short
+void mortonArraySort(MortonArray* array);
+// the tail has grown past an eighth of the array, so traversal has lost enough locality to be worth a sort
+int mortonArrayNeedsSort(const MortonArray* array);
+// keeps the items of cells inside any of the boxes from minCodes[i] to maxCodes[i], in their order; returns how many were removed
+size_t mortonArrayRetain(MortonArray* array, const uint64_t* minCodes, const uint64_t* maxCodes, size_t boxCount);
+// the first index from index on whose cell lies inside the box, or the length; the ordered part jumps over
+// runs of codes outside the box instead of testing them one by one:
+// for (i = mortonArrayNextInBox(array, 0, minCode, maxCode); i < length; i = mortonArrayNextInBox(array, i + 1, minCode, maxCode))
+size_t mortonArrayNextInBox(const MortonArray* array, size_t index, uint64_t minCode, uint64_t maxCode);
+// the index of the item of the cell, or the length when there is none; a binary search of the ordered part and a scan of the tail
+size_t mortonArrayFind(const MortonArray* array, int x, int y, int z);
+
+#endif //TEST_MORTONARRAY_H
@@ -0,0 +1,51 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_PRIORITYQUEUE_H
+#define TEST_PRIORITYQUEUE_H
+
+#include <stddef.h>
+
+typedef struct PriorityQueueEntry {
+	double priority;
+	void* elem;
+} PriorityQueueEntry;
+
+// binary min-heap, the element with the lowest priority is popped first
+typedef struct PriorityQueue {
+	PriorityQueueEntry* rawArray;
+	size_t length;
+	size_t capacity;
+} PriorityQueue;
+
+PriorityQueue* queueNew(size_t initialCapacity);
+void queueFree(PriorityQueue* queue);
+void queueFreeWithContents(PriorityQueue* queue);
+size_t queueGetLength(const PriorityQueue* queue);
+void queueResize(PriorityQueue* queue, size_t newCapacity);
+void queuePush(PriorityQueue* queue, void* elem, double priority);
+void* queuePeek(const PriorityQueue* queue);
+double queuePeekPriority(const PriorityQueue* queue);
+void* queuePop(PriorityQueue* queue);
+void queueRemoveAll(PriorityQueue* queue);
+void queueDestroyAll(PriorityQueue* queue);
+
+#endif //TEST_PRIORITYQUEUE_H
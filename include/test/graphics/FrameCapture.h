@@ -0,0 +1,78 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FRAMECAPTURE_H
+#define TEST_FRAMECAPTURE_H
+
+#include <pthread.h>
+#include <GL/glew.h>
+
+#include "test/tools/BoundedQueue.h"
+#include "test/tools/VideoWriter.h"
+
+#define FRAME_CAPTURE_SLOTS 4
+
+typedef enum FrameCaptureSlotState {
+	FRAME_CAPTURE_FREE,
+	FRAME_CAPTURE_READING, // the GPU is copying the frame into the slot
+	FRAME_CAPTURE_WRITING // the writer thread owns the slot
+} FrameCaptureSlotState;
+
+typedef struct FrameCaptureStats {
+	unsigned long captured;
+	unsigned long written;
+	unsigned long dropped; // no free slot when the frame was due, or still being read back when capture stopped
+	int failed; // the writer hit a write error and skips the rest
+	double lastCost; // time spent on the render thread per frame
+	double maxCost;
+} FrameCaptureStats;
+
+// ring of persistently mapped pixel pack buffers: the render thread only queues copies and fences,
+// a writer thread converts and streams every slot whose copy has finished
+typedef struct FrameCapture {
+	GLuint buffer;
+	unsigned char* mapping;
+	size_t frameSize;
+	int width;
+	int height;
+	int next; // slot the next frame is read into, slots are used in ring order
+	int oldest; // oldest slot still being read back
+	FrameCaptureSlotState states[FRAME_CAPTURE_SLOTS];
+	GLsync fences[FRAME_CAPTURE_SLOTS];
+	VideoWriter* writer;
+	BoundedQueue* queue;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	int discard; // the buffer may be gone with the context, the writer must not touch it
+	FrameCaptureStats stats;
+} FrameCapture;
+
+int frameCaptureIsSupported();
+// captures width x height pixels from the lower left corner into path, Y4M for a .y4m path and raw rgb24 otherwise
+FrameCapture* frameCaptureStart(const char* path, int width, int height, int fps);
+// call from the GL thread after drawing the frame to capture, never waits for the GPU or the disk
+void frameCaptureFrame(FrameCapture* capture);
+// finishes the file and returns the final counts; without a GL context, e.g. at exit once the window is gone,
+// frames not written yet are dropped
+FrameCaptureStats frameCaptureStop(FrameCapture* capture, int hasContext);
+FrameCaptureStats frameCaptureGetStats(FrameCapture* capture);
+
+#endif //TEST_FRAMECAPTURE_H
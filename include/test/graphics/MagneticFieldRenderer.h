@@ -22,10 +22,53 @@
 #ifndef TEST_MAGNETICFIELDRENDERER_H
 #define TEST_MAGNETICFIELDRENDERER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "test/graphics/RenderContext.h"
+#include "test/physics/Conductor.h"
+#include "test/physics/FieldSource.h"
+
+typedef struct MagneticFieldUpdateStats {
+	unsigned long ticks;
+	unsigned long overruns;
+	float lastDuration;
+	float maxOverrun;
+	size_t pendingCells;
+	unsigned long cacheHits;
+	unsigned long cacheMisses;
+	int daemonAttached;
+	unsigned long long computedCells;
+	unsigned long long cancelledCells; // planned, then dropped because the camera moved on
+	unsigned long long staleCells; // computed after the camera had moved on
+} MagneticFieldUpdateStats;
 
 int initMagneticField();
-void updateMagneticField(const RenderContext* context);
+// loads the sources from a scene file instead of the default ones
+int initMagneticFieldScene(const char* scenePath);
+int openMagneticFieldCache(const char* path, size_t maxBytes);
+void closeMagneticFieldCache();
+int attachMagneticFieldDaemon();
+void detachMagneticFieldDaemon();
+size_t addMagneticFieldSource(FieldSource source);
+int updateMagneticFieldSource(size_t index, FieldSource source);
+int removeMagneticFieldSource(FieldSourceType type, size_t index);
+int getMagneticFieldSource(FieldSourceType type, size_t index, FieldSource* result);
+size_t getMagneticFieldSourceCount(FieldSourceType type); // FIELD_SOURCE_TYPE_COUNT counts all of them
+FieldSourceSet* copyMagneticFieldSources();
+size_t addMagneticFieldConductor(Conductor conductor);
+int updateMagneticFieldConductor(size_t index, Conductor conductor);
+int removeMagneticFieldConductor(size_t index);
+int getMagneticFieldConductor(size_t index, Conductor* result);
+size_t getMagneticFieldConductorCount();
+size_t getMagneticFieldPointCount();
+unsigned long getMagneticFieldGeneration();
+uint64_t getMagneticFieldSceneHash();
+const char* getMagneticFieldKernelName();
+int updateMagneticField(const RenderContext* context);
+// cancels the running update at its next chunk if context makes its plan stale, safe from any thread
+void invalidateMagneticFieldUpdate(const RenderContext* context);
+MagneticFieldUpdateStats getMagneticFieldUpdateStats();
 void renderMagneticField(const RenderContext* context);
 
 #endif //TEST_MAGNETICFIELDRENDERER_H
@@ -25,11 +25,25 @@
 #include "test/math/Vector.h"
 #include "test/graphics/Camera.h"
 
+#define RENDER_MAX_VIEWPORTS 4
+
+typedef struct Viewport {
+	Camera camera;
+	Vector focus; // centre of what the viewport shows, the field is computed around it
+	double orthographicExtent; // half the visible height in world units, 0 for a perspective view
+	Vector origin; // lower left corner in window pixels
+	Vector size;
+} Viewport;
+
 typedef struct RenderContext {
 	float updateDelta;
 	float renderDelta;
+	float updateBudget;
 	Vector windowSize;
 	Camera camera;
+	// every view sharing the window, none means the camera alone fills it
+	Viewport viewports[RENDER_MAX_VIEWPORTS];
+	int viewportCount;
 } RenderContext;
 
 #endif //TEST_RENDERCONTEXT_H
@@ -0,0 +1,42 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_SLICERENDERER_H
+#define TEST_SLICERENDERER_H
+
+#include "test/graphics/Camera.h"
+#include "test/tools/FieldSlice.h"
+#include "test/tools/ThreadPool.h"
+
+int initSlice(ThreadPool* pool);
+// brings the slice image up to date within budget seconds, the rest of its tiles follow in the next calls
+void updateSlice(double budget);
+void renderSlice();
+// through the point distance ahead of the camera, facing it
+void placeSlice(Camera camera, double distance);
+// along the normal, and within the plane along its horizontal axis
+void moveSlice(double distance, double sideways);
+// yaw about the vertical axis and pitch about the horizontal axis of the plane, through its center
+void rotateSlice(double yaw, double pitch);
+int isSlicePending();
+FieldSliceStats getSliceStats();
+
+#endif //TEST_SLICERENDERER_H
@@ -0,0 +1,66 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_VERTEXSTREAM_H
+#define TEST_VERTEXSTREAM_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <GL/glew.h>
+
+#define VERTEX_STREAM_SLOTS 3
+
+typedef struct StreamVertex {
+	float x;
+	float y;
+	float z;
+	float r;
+	float g;
+	float b;
+} StreamVertex;
+
+typedef enum VertexStreamSlotState {
+	VERTEX_STREAM_FREE,
+	VERTEX_STREAM_WRITING,
+	VERTEX_STREAM_READY,
+	VERTEX_STREAM_DRAWING,
+	VERTEX_STREAM_RETIRED
+} VertexStreamSlotState;
+
+// triple-buffered persistently mapped vertex buffer: any thread fills a free slot, the GL thread draws the newest one and fences it
+typedef struct VertexStream {
+	GLuint buffer;
+	StreamVertex* mapping;
+	size_t slotCapacity;
+	VertexStreamSlotState states[VERTEX_STREAM_SLOTS];
+	size_t counts[VERTEX_STREAM_SLOTS];
+	GLsync fences[VERTEX_STREAM_SLOTS];
+	pthread_mutex_t mutex;
+} VertexStream;
+
+int vertexStreamIsSupported();
+VertexStream* vertexStreamNew(size_t slotCapacity);
+void vertexStreamFree(VertexStream* stream);
+StreamVertex* vertexStreamBeginWrite(VertexStream* stream, int* slot);
+void vertexStreamEndWrite(VertexStream* stream, int slot, size_t count);
+void vertexStreamDraw(VertexStream* stream, GLenum mode);
+
+#endif //TEST_VERTEXSTREAM_H
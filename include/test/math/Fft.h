@@ -0,0 +1,41 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FFT_H
+#define TEST_FFT_H
+
+#include <stddef.h>
+
+// precomputed twiddles and bit reversal for one power of two length
+typedef struct FftPlan {
+	size_t length;
+	double* twiddles; // cos and sin of -2 pi k / length for k < length / 2, interleaved
+	size_t* reversed;
+} FftPlan;
+
+size_t fftGetPaddedLength(size_t length); // the smallest power of two not below length
+FftPlan* fftPlanNew(size_t length);
+void fftPlanFree(FftPlan* plan);
+// transforms count complex sequences in place, unnormalized in both directions; data holds interleaved re, im pairs and
+// element k of sequence j sits at pair k * stride + j, so sequences next to each other are transformed together
+void fftTransform(const FftPlan* plan, double* data, size_t stride, size_t count, int inverse);
+
+#endif //TEST_FFT_H
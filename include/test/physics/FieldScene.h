@@ -0,0 +1,69 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FIELDSCENE_H
+#define TEST_FIELDSCENE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test/math/Vector.h"
+#include "test/physics/FieldSource.h"
+
+// a set of sources behind its own lock, every function is safe to call from any thread and scenes share no state
+typedef struct FieldScene FieldScene;
+
+// a kernel built for one fixed set of sources, used while the scene holds exactly that set
+typedef struct FieldSceneSpecialization {
+	const char* name;
+	int (*matches)(const FieldSourceSet* sources);
+	void (*evaluate)(const Vector* positions, Vector* results, size_t count);
+} FieldSceneSpecialization;
+
+FieldScene* fieldSceneNew();
+void fieldSceneFree(FieldScene* scene);
+// the four conductors the viewer starts with
+void fieldSceneAddDefaultSources(FieldScene* scene);
+// one source per line: the type name followed by every number of its struct in declaration order, '#' starts a comment;
+// returns the number of sources added or -1 after printing the offending line, in which case none of them is added
+int fieldSceneLoad(FieldScene* scene, FILE* file, const char* name);
+int fieldSceneLoadFile(FieldScene* scene, const char* path);
+void fieldSceneSetSpecialization(FieldScene* scene, const FieldSceneSpecialization* specialization);
+// name of the specialization in use, NULL while the generic kernels run
+const char* fieldSceneGetSpecialization(FieldScene* scene);
+size_t fieldSceneAddSource(FieldScene* scene, const FieldSource* source);
+// previous receives the replaced or removed source, it can be NULL
+int fieldSceneUpdateSource(FieldScene* scene, size_t index, const FieldSource* source, FieldSource* previous);
+int fieldSceneRemoveSource(FieldScene* scene, FieldSourceType type, size_t index, FieldSource* previous);
+int fieldSceneGetSource(FieldScene* scene, FieldSourceType type, size_t index, FieldSource* result);
+size_t fieldSceneGetSourceCount(FieldScene* scene, FieldSourceType type); // FIELD_SOURCE_TYPE_COUNT counts all of them
+FieldSourceSet* fieldSceneCopySources(FieldScene* scene);
+unsigned long fieldSceneGetGeneration(FieldScene* scene);
+uint64_t fieldSceneGetHash(FieldScene* scene, uint64_t seed);
+// the hash cached and shared cells of the scene are stored under, it covers the cell step too
+uint64_t fieldSceneGetChunkHash(FieldScene* scene);
+// adds the field of every source to results, concurrent evaluations of one scene don't block each other
+void fieldSceneEvaluate(FieldScene* scene, const Vector* positions, Vector* results, size_t count);
+// the field at every cell of the chunk, FIELD_CHUNK_CELLS results in the order of the cell index
+void fieldSceneEvaluateChunk(FieldScene* scene, uint64_t chunkKey, Vector* results);
+
+#endif //TEST_FIELDSCENE_H
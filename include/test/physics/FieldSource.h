@@ -0,0 +1,108 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FIELDSOURCE_H
+#define TEST_FIELDSOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test/math/Vector.h"
+#include "test/physics/Conductor.h"
+
+typedef enum FieldSourceType {
+	FIELD_SOURCE_ELEMENT,
+	FIELD_SOURCE_SEGMENT,
+	FIELD_SOURCE_LOOP,
+	FIELD_SOURCE_DIPOLE,
+	FIELD_SOURCE_CHARGE,
+	FIELD_SOURCE_TYPE_COUNT
+} FieldSourceType;
+
+// straight wire from start to end
+typedef struct FieldSegment {
+	Vector start;
+	Vector end;
+	double I;
+	double permeability;
+} FieldSegment;
+
+// circular loop, the current flows counterclockwise around normal, evaluated exactly with elliptic integrals
+typedef struct FieldLoop {
+	Vector center;
+	Vector normal;
+	double radius;
+	double I;
+	double permeability;
+} FieldLoop;
+
+typedef struct FieldDipole {
+	Vector position;
+	Vector moment;
+	double permeability;
+} FieldDipole;
+
+// point charge moving slowly enough for the Biot-Savart approximation
+typedef struct FieldCharge {
+	Vector position;
+	Vector velocity;
+	double q;
+	double permeability;
+} FieldCharge;
+
+typedef struct FieldSource {
+	FieldSourceType type;
+	union {
+		Conductor element;
+		FieldSegment segment;
+		FieldLoop loop;
+		FieldDipole dipole;
+		FieldCharge charge;
+	};
+} FieldSource;
+
+// accumulates scale times the field of every source into results
+typedef void (*FieldSourceKernel)(const void* sources, size_t sourceCount, double scale, const Vector* positions, Vector* results, size_t count);
+
+// sources are kept grouped by type in contiguous arrays, evaluation is one kernel call per type
+typedef struct FieldSourceSet {
+	void* sources[FIELD_SOURCE_TYPE_COUNT];
+	size_t counts[FIELD_SOURCE_TYPE_COUNT];
+	size_t capacities[FIELD_SOURCE_TYPE_COUNT];
+} FieldSourceSet;
+
+const char* fieldSourceGetTypeName(FieldSourceType type);
+size_t fieldSourceGetTypeSize(FieldSourceType type);
+FieldSourceKernel fieldSourceGetKernel(FieldSourceType type);
+void fieldSourceEvaluate(const FieldSource* source, double scale, const Vector* positions, Vector* results, size_t count);
+
+FieldSourceSet* fieldSourceSetNew();
+void fieldSourceSetFree(FieldSourceSet* set);
+FieldSourceSet* fieldSourceSetCopy(const FieldSourceSet* set);
+size_t fieldSourceSetGetCount(const FieldSourceSet* set, FieldSourceType type);
+size_t fieldSourceSetGetTotalCount(const FieldSourceSet* set);
+size_t fieldSourceSetAdd(FieldSourceSet* set, const FieldSource* source);
+int fieldSourceSetGet(const FieldSourceSet* set, FieldSourceType type, size_t index, FieldSource* result);
+int fieldSourceSetUpdate(FieldSourceSet* set, size_t index, const FieldSource* source);
+int fieldSourceSetRemove(FieldSourceSet* set, FieldSourceType type, size_t index);
+void fieldSourceSetEvaluate(const FieldSourceSet* set, const Vector* positions, Vector* results, size_t count);
+
+#endif //TEST_FIELDSOURCE_H
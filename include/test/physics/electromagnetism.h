@@ -23,6 +23,7 @@
 #define TEST_ELECTOMAGNETISM_H
 
 #include <math.h>
+#include <stddef.h>
 
 #include "test/math/Vector.h"
 
@@ -33,5 +34,6 @@ struct Vector calculateLorenzForce(double q, Vector E, Vector v, Vector B);
 struct Vector calculateCoulombForce(double q, Vector E);
 struct Vector calculateElecticFieldPoint(double q, Vector r);
 struct Vector calculateMagneticFieldPoint(double I, double permeability, Vector l, Vector r);
+void calculateMagneticFieldPoints(double I, double permeability, Vector l, Vector origin, const Vector* positions, Vector* results, size_t count);
 
 #endif //TEST_ELECTOMAGNETISM_H
@@ -0,0 +1,48 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_BOUNDEDQUEUE_H
+#define TEST_BOUNDEDQUEUE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// fixed capacity FIFO between threads, producers wait while it is full and consumers while it is empty
+typedef struct BoundedQueue {
+	void** items;
+	size_t capacity;
+	size_t head;
+	size_t count;
+	int closed;
+	pthread_mutex_t mutex;
+	pthread_cond_t notEmpty;
+	pthread_cond_t notFull;
+} BoundedQueue;
+
+BoundedQueue* boundedQueueNew(size_t capacity);
+void boundedQueueFree(BoundedQueue* queue);
+// returns 0 once the queue is closed
+int boundedQueuePush(BoundedQueue* queue, void* item);
+// returns 0 once the queue is closed and drained
+int boundedQueuePop(BoundedQueue* queue, void** item);
+void boundedQueueClose(BoundedQueue* queue);
+
+#endif //TEST_BOUNDEDQUEUE_H
@@ -0,0 +1,69 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FIELDCACHE_H
+#define TEST_FIELDCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test/math/Vector.h"
+#include "test/tools/FieldChunk.h"
+#include "test/tools/FieldSample.h"
+
+typedef struct FieldCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t recordCount;
+	uint64_t stamp;
+} FieldCacheHeader;
+
+typedef struct FieldCacheRecord {
+	uint64_t sceneHash;
+	uint64_t chunkKey;
+	uint64_t mask;
+	uint64_t stamp;
+	uint64_t checksum;
+	PackedFieldSample samples[FIELD_CHUNK_CELLS]; // within the FieldSample error bounds of what was stored
+} FieldCacheRecord;
+
+// memory-mapped file of chunk records, records of several scenes live side by side and the least recently used ones are evicted
+typedef struct FieldCache {
+	int fd;
+	size_t size;
+	FieldCacheHeader* header;
+	FieldCacheRecord* records;
+	unsigned char* dirty;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+	unsigned long corrupted;
+} FieldCache;
+
+uint64_t fieldCacheHash(uint64_t hash, const void* data, size_t size);
+FieldCache* fieldCacheOpen(const char* path, size_t maxBytes);
+void fieldCacheClose(FieldCache* cache);
+void fieldCacheSync(FieldCache* cache);
+int fieldCacheLookup(FieldCache* cache, uint64_t sceneHash, int cellX, int cellY, int cellZ, Vector* result);
+void fieldCacheStore(FieldCache* cache, uint64_t sceneHash, int cellX, int cellY, int cellZ, Vector value);
+
+#endif //TEST_FIELDCACHE_H
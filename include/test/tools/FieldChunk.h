@@ -0,0 +1,58 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FIELDCHUNK_H
+#define TEST_FIELDCHUNK_H
+
+#include <stdint.h>
+
+#define FIELD_CELL_STEP 8 // world units between two neighbouring cells
+#define FIELD_CHUNK_SIZE 4
+#define FIELD_CHUNK_CELLS (FIELD_CHUNK_SIZE * FIELD_CHUNK_SIZE * FIELD_CHUNK_SIZE)
+
+static inline int fieldChunkFloorDiv(int a, int b) {
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// chunk coordinates packed into 21 bits each
+static inline uint64_t fieldChunkGetKey(int chunkX, int chunkY, int chunkZ) {
+	return ((uint64_t) (chunkX + (1 << 20)) & 0x1fffff) << 42 |
+		((uint64_t) (chunkY + (1 << 20)) & 0x1fffff) << 21 |
+		((uint64_t) (chunkZ + (1 << 20)) & 0x1fffff);
+}
+
+static inline void fieldChunkFromKey(uint64_t key, int* chunkX, int* chunkY, int* chunkZ) {
+	*chunkX = (int) ((key >> 42) & 0x1fffff) - (1 << 20);
+	*chunkY = (int) ((key >> 21) & 0x1fffff) - (1 << 20);
+	*chunkZ = (int) (key & 0x1fffff) - (1 << 20);
+}
+
+// finds the chunk of a cell and the cell index inside it
+static inline uint64_t fieldChunkLocate(int cellX, int cellY, int cellZ, unsigned int* index) {
+	const int chunkX = fieldChunkFloorDiv(cellX, FIELD_CHUNK_SIZE);
+	const int chunkY = fieldChunkFloorDiv(cellY, FIELD_CHUNK_SIZE);
+	const int chunkZ = fieldChunkFloorDiv(cellZ, FIELD_CHUNK_SIZE);
+	*index = (unsigned int) (((cellX - chunkX * FIELD_CHUNK_SIZE) * FIELD_CHUNK_SIZE +
+		(cellY - chunkY * FIELD_CHUNK_SIZE)) * FIELD_CHUNK_SIZE + (cellZ - chunkZ * FIELD_CHUNK_SIZE));
+	return fieldChunkGetKey(chunkX, chunkY, chunkZ);
+}
+
+#endif //TEST_FIELDCHUNK_H
@@ -0,0 +1,73 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FIELDOCTREE_H
+#define TEST_FIELDOCTREE_H
+
+#include <stddef.h>
+
+#include "test/math/Vector.h"
+#include "test/physics/FieldSource.h"
+#include "test/collections/HashMap.h"
+
+#define FIELD_OCTREE_MAX_DEPTH 20
+
+// cells live on an integer lattice of 2^maxDepth steps per axis, corners are shared between neighbours
+typedef struct FieldOctreeNode {
+	int x;
+	int y;
+	int z;
+	int size;
+	int depth;
+	int firstChild; // the 8 children are consecutive, -1 for leaves
+	int corners[8]; // sample indices, x is the lowest bit of the corner number
+} FieldOctreeNode;
+
+typedef struct FieldOctree {
+	Vector origin;
+	double step;
+	int maxDepth;
+	double tolerance;
+	FieldOctreeNode* nodes;
+	size_t nodeCount;
+	size_t nodeCapacity;
+	Vector* samplePositions;
+	Vector* samples;
+	size_t sampleCount;
+	size_t sampleCapacity;
+	HashMap* sampleIndex;
+	size_t leafCount;
+	int deepestDepth;
+} FieldOctree;
+
+// a cell is split while the field at its center or a face center differs from the interpolation of its corners
+// by more than tolerance relative to the field there, cells above minDepth are always split
+FieldOctree* fieldOctreeBuild(const FieldSourceSet* sources, Vector center, double halfSize, double tolerance, int minDepth, int maxDepth);
+void fieldOctreeFree(FieldOctree* tree);
+const FieldOctreeNode* fieldOctreeFindLeaf(const FieldOctree* tree, Vector position);
+// trilinear interpolation inside the leaf containing position, returns 0 outside the tree
+int fieldOctreeSample(const FieldOctree* tree, Vector position, Vector* result);
+double fieldOctreeGetCellSize(const FieldOctree* tree, const FieldOctreeNode* node);
+Vector fieldOctreeGetCellCenter(const FieldOctree* tree, const FieldOctreeNode* node);
+// samples a uniform grid at the finest cell size of the tree would take
+double fieldOctreeGetUniformSampleCount(const FieldOctree* tree);
+
+#endif //TEST_FIELDOCTREE_H
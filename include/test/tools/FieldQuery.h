@@ -0,0 +1,57 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FIELDQUERY_H
+#define TEST_FIELDQUERY_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "test/physics/FieldScene.h"
+
+#define FIELD_QUERY_DEFAULT_BATCH_SIZE 16384
+
+// text is one "x y z" point per line, spaces, tabs, commas or semicolons between the numbers, '#' starts a comment;
+// binary is packed native doubles, 24 bytes per point, and the output follows the same format as B
+typedef struct FieldQueryOptions {
+	FILE* input;
+	FILE* output;
+	int binaryInput;
+	int binaryOutput;
+	size_t batchSize;
+	size_t threadCount;
+} FieldQueryOptions;
+
+typedef struct FieldQueryStats {
+	unsigned long long points;
+	unsigned long batches;
+	double seconds;
+	double parseTime;
+	double computeTime;
+	double writeTime;
+} FieldQueryStats;
+
+// parsing, computing and writing run as overlapping stages over a fixed set of batches, so memory doesn't grow with the input
+int fieldQueryRun(FieldScene* scene, const FieldQueryOptions* options, FieldQueryStats* stats);
+// the scene runs the specialized kernel while it matches, which can be NULL
+int fieldQueryMain(int argc, char **argv, const FieldSceneSpecialization* specialization);
+
+#endif //TEST_FIELDQUERY_H
@@ -0,0 +1,41 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FIELDSAMPLE_H
+#define TEST_FIELDSAMPLE_H
+
+#include <stdint.h>
+
+#include "test/math/Vector.h"
+
+// a field value in 32 bits: the octahedral encoding of its direction in the low 16, 8 bits per axis, and log2 of its
+// magnitude in the high 16
+typedef uint32_t PackedFieldSample;
+
+#define FIELD_SAMPLE_MIN_LOG2 -32 // smaller magnitudes are packed as zero
+#define FIELD_SAMPLE_MAX_LOG2 32 // larger ones are clamped
+#define FIELD_SAMPLE_MAX_ANGLE_ERROR 0.0115 // radians, between a direction and its unpacked value, about 0.65 degrees
+#define FIELD_SAMPLE_MAX_MAGNITUDE_ERROR 0.0004 // relative, within the magnitude range
+
+PackedFieldSample fieldSamplePack(Vector value);
+Vector fieldSampleUnpack(PackedFieldSample sample);
+
+#endif //TEST_FIELDSAMPLE_H
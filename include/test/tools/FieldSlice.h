@@ -0,0 +1,111 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_FIELDSLICE_H
+#define TEST_FIELDSLICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test/math/Vector.h"
+#include "test/physics/FieldSource.h"
+#include "test/collections/HashMap.h"
+#include "test/tools/ThreadPool.h"
+
+#define FIELD_SLICE_TILE 32
+#define FIELD_SLICE_LIC_STEPS 16 // streamline steps each way from a pixel
+#define FIELD_SLICE_REUSE_TOLERANCE 0.25 // in pixels, how far a cached tile may have moved and still be shown as it is
+
+// a square through center facing normal, up is projected into it as its second axis
+typedef struct FieldSlicePlane {
+	Vector center;
+	Vector normal;
+	Vector up;
+	double size; // width and height in world units
+} FieldSlicePlane;
+
+// tiles sit on a lattice of pixels anchored at the point of the plane nearest to the world origin, so panning within the
+// plane finds the same tiles again
+typedef struct FieldSliceTile {
+	int x;
+	int y;
+	Vector corner; // world position of the first pixel
+	Vector stepU;
+	Vector stepV;
+	uint64_t sourcesHash;
+	float* levels; // log10 |B|
+	float* directions; // direction of B within the plane, u and v interleaved, zero where B is too weak
+	unsigned char* lic;
+	float minLevel;
+	float maxLevel;
+	int sampled; // the samples belong to corner and sourcesHash
+	int stale; // sampled for another plane or scene, shown until the new samples are in
+	int resampled; // in this update, so the LIC around it is redone
+	int licNeighbours; // which of the 8 neighbours were there for the last LIC, -1 before any
+	unsigned long lastUsed;
+} FieldSliceTile;
+
+typedef struct FieldSliceStats {
+	size_t tiles;
+	size_t sampledTiles;
+	size_t licTiles;
+	size_t pendingTiles;
+	double updateTime;
+	float minLevel;
+	float maxLevel;
+} FieldSliceStats;
+
+typedef struct FieldSlice {
+	size_t resolution;
+	ThreadPool* pool;
+	HashMap* tiles; // by packed lattice coordinates
+	FieldSliceTile** cover; // the tiles under the image, row by row from the lowest
+	int coverX;
+	int coverY;
+	int coverWidth;
+	int coverHeight;
+	int pixelX; // lattice pixel at the first image pixel
+	int pixelY;
+	Vector anchor;
+	Vector u;
+	Vector v;
+	double step;
+	unsigned char* image; // rgba, the first row is the lowest
+	unsigned char* palette;
+	unsigned long epoch;
+	double licTime; // per tile, as last measured, the sampling leaves room for it and the composition before a deadline
+	double composeTime;
+	FieldSliceStats stats;
+} FieldSlice;
+
+// resolution is the image side in pixels, a multiple of FIELD_SLICE_TILE; pool may be NULL
+FieldSlice* fieldSliceNew(size_t resolution, ThreadPool* pool);
+void fieldSliceFree(FieldSlice* slice);
+// samples the tiles which are missing or moved, nearest to the center first and until deadline (0 for none), redoes
+// the LIC where samples changed and composes the heatmap shaded by the LIC; sourcesHash tells the scenes apart,
+// returns the number of tiles still showing old samples or -1 when out of memory
+int fieldSliceUpdate(FieldSlice* slice, const FieldSourceSet* sources, uint64_t sourcesHash, FieldSlicePlane plane, double deadline);
+// the image spans these counterclockwise from the corner of its first pixel
+Vector fieldSliceGetCorner(const FieldSlice* slice, int corner);
+float fieldSliceGetLevel(const FieldSlice* slice, size_t x, size_t y);
+unsigned char fieldSliceGetLic(const FieldSlice* slice, size_t x, size_t y);
+
+#endif //TEST_FIELDSLICE_H
@@ -0,0 +1,60 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_GRIDSOLVER_H
+#define TEST_GRIDSOLVER_H
+
+#include <stddef.h>
+
+#include "test/math/Vector.h"
+#include "test/math/Fft.h"
+#include "test/physics/FieldSource.h"
+#include "test/tools/ThreadPool.h"
+
+// B on a regular grid of current moments by FFT convolution with the Biot-Savart kernel, zero padded to at least twice
+// the grid along every axis so nothing wraps around; the cost is O(N log N) in the padded node count
+typedef struct GridSolver {
+	Vector origin; // position of node 0, 0, 0
+	double spacing;
+	size_t size[3];
+	size_t padded[3];
+	FftPlan* plans[3];
+	double* moments[3]; // complex padded grids of mu / 4pi I l, then of the transformed field
+	double* kernel[3]; // the kernel is odd, so its transform is imaginary and only that part is kept
+	int kernelReady;
+	Vector* field; // B at every node after a solve, x fastest
+	ThreadPool* pool;
+} GridSolver;
+
+// pool may be NULL to solve on the calling thread alone
+GridSolver* gridSolverNew(Vector origin, double spacing, size_t sizeX, size_t sizeY, size_t sizeZ, ThreadPool* pool);
+void gridSolverFree(GridSolver* solver);
+void gridSolverClear(GridSolver* solver);
+// spreads the current element I l at position over the 8 nodes around it, outside the grid it is dropped
+int gridSolverDepositCurrent(GridSolver* solver, Vector position, Vector currentMoment, double permeability);
+// wires and loops are split into pieces of half a cell, dipoles are left out; returns the number of sources deposited
+size_t gridSolverDepositSources(GridSolver* solver, const FieldSourceSet* sources);
+int gridSolverSolve(GridSolver* solver);
+Vector gridSolverGetField(const GridSolver* solver, size_t x, size_t y, size_t z);
+// trilinear interpolation between the nodes, returns 0 outside the grid
+int gridSolverSample(const GridSolver* solver, Vector position, Vector* result);
+
+#endif //TEST_GRIDSOLVER_H
@@ -0,0 +1,57 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_ISOMESH_H
+#define TEST_ISOMESH_H
+
+#include <stddef.h>
+
+#include "test/math/Vector.h"
+#include "test/collections/HashMap.h"
+
+typedef struct IsoMeshVertex {
+	float x;
+	float y;
+	float z;
+	float nx;
+	float ny;
+	float nz;
+} IsoMeshVertex;
+
+// an indexed triangle mesh, its buffers are kept from one extraction to the next
+typedef struct IsoMesh {
+	IsoMeshVertex* vertices;
+	size_t vertexCount;
+	size_t vertexCapacity;
+	unsigned int* indices;
+	size_t indexCount;
+	size_t indexCapacity;
+	HashMap* edges; // grid edge to the vertex on it
+} IsoMesh;
+
+IsoMesh* isoMeshNew();
+void isoMeshFree(IsoMesh* mesh);
+// replaces the mesh with the surface where a size^3 grid of samples (x major, z minor) crosses level; the outermost layer
+// of samples only provides gradients; origin is the position of the first sample, spacing the distance between two;
+// triangles wind counter-clockwise seen from the lower values, where the normals point as well
+void isoMeshExtract(IsoMesh* mesh, const float* samples, int size, double level, Vector origin, double spacing);
+
+#endif //TEST_ISOMESH_H
@@ -0,0 +1,84 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_JOBSYSTEM_H
+#define TEST_JOBSYSTEM_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+typedef struct Job Job;
+
+// runs one chunk of the job and returns how many units of work it did
+typedef size_t (*JobStep)(Job* job);
+// called once when the job is done or cancelled, it may free the job
+typedef void (*JobRelease)(Job* job, int cancelled);
+
+// a job runs chunk by chunk until no work is pending, between chunks it is cancelled if a newer generation started
+struct Job {
+	JobStep step;
+	JobRelease release;
+	void* arg;
+	size_t pendingWork;
+	unsigned long generation;
+	Job* continuation; // runs with the same generation once this job is done, cancelled along with it
+	Job* next;
+};
+
+typedef struct JobSystemStats {
+	unsigned long jobsDone;
+	unsigned long jobsCancelled;
+	unsigned long long workDone;
+	unsigned long long workCancelled; // units dropped before being computed
+	unsigned long long workStale; // units computed after their generation had been superseded
+} JobSystemStats;
+
+typedef struct JobSystem {
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	pthread_cond_t idle;
+	pthread_t* threads;
+	size_t threadCount;
+	Job* head;
+	Job* tail;
+	size_t activeJobs;
+	unsigned long generation;
+	int cancelStale;
+	int running;
+	JobSystemStats stats;
+} JobSystem;
+
+// without threads the jobs only run inside jobSystemRun on the caller's thread
+JobSystem* jobSystemNew(size_t threadCount);
+void jobSystemFree(JobSystem* system);
+void jobSystemSubmit(JobSystem* system, Job* job);
+// every job submitted so far becomes stale, returns the new generation
+unsigned long jobSystemAdvance(JobSystem* system);
+unsigned long jobSystemGetGeneration(JobSystem* system);
+// whether stale jobs are dropped before their next chunk (the default) or run to completion
+void jobSystemSetCancelStale(JobSystem* system, int cancelStale);
+// runs chunks until the queue is empty or the deadline (getTimeDetailed seconds, 0 for none) passes, returns 1 when empty
+int jobSystemRun(JobSystem* system, double deadline);
+void jobSystemWait(JobSystem* system);
+size_t jobSystemGetPendingWork(JobSystem* system);
+JobSystemStats jobSystemGetStats(JobSystem* system);
+
+#endif //TEST_JOBSYSTEM_H
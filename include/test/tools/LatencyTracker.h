@@ -0,0 +1,64 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_LATENCYTRACKER_H
+#define TEST_LATENCYTRACKER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// samples are durations in seconds, percentiles are nearest rank over the last LATENCY_WINDOW samples
+#define LATENCY_WINDOW 240
+
+// one thread records into a lock free ring, one other thread reads, so timing a frame never waits for the HUD
+typedef struct LatencyTracker LatencyTracker;
+
+typedef struct LatencyStats {
+	unsigned long count;
+	unsigned long overBudget;
+	unsigned long dropped; // overwritten before a reader saw them
+	double budget;
+	double mean;
+	double p50;
+	double p95;
+	double p99;
+	double max;
+	// since the tracker was created, percentiles within a few percent
+	double runP50;
+	double runP95;
+	double runP99;
+	double runMax;
+} LatencyStats;
+
+// samples above budget count as over budget, 0 counts none
+LatencyTracker* latencyTrackerNew(const char* name, double budget);
+void latencyTrackerFree(LatencyTracker* tracker);
+void latencyTrackerSetBudget(LatencyTracker* tracker, double budget);
+// the writer side, never blocks
+void latencyTrackerRecord(LatencyTracker* tracker, double seconds);
+// the reader side, takes in everything recorded since the previous read
+void latencyTrackerGetStats(LatencyTracker* tracker, LatencyStats* stats);
+// copies up to count of the latest window samples oldest first, returns how many
+size_t latencyTrackerGetHistory(LatencyTracker* tracker, double* samples, size_t count);
+// one JSON object per call, times in milliseconds
+void latencyTrackerDump(LatencyTracker* tracker, FILE* file);
+
+#endif //TEST_LATENCYTRACKER_H
@@ -0,0 +1,76 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_MEMORYSTATS_H
+#define TEST_MEMORYSTATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef enum MemoryTag {
+	MEMORY_TAG_FIELD_POINTS,
+	MEMORY_TAG_SOURCES,
+	MEMORY_TAG_COLLECTIONS,
+	MEMORY_TAG_RENDERING,
+	MEMORY_TAG_MAPPED,
+	MEMORY_TAG_COUNT
+} MemoryTag;
+
+typedef struct MemoryTagStats {
+	int64_t currentBytes;
+	int64_t peakBytes;
+	uint64_t allocations;
+	double allocationRate;
+} MemoryTagStats;
+
+typedef struct MemoryStats {
+	int enabled;
+	double time;
+	MemoryTagStats tags[MEMORY_TAG_COUNT];
+} MemoryStats;
+
+const char* memoryGetTagName(MemoryTag tag);
+// fills stats, allocation rates are per second since the previous contents of stats, so start from zeroed stats
+void memoryGetStats(MemoryStats* stats);
+// one JSON object per call
+void memoryDumpStats(FILE* file);
+
+#ifdef ENABLE_MEMORY_STATS
+
+void* memoryAlloc(MemoryTag tag, size_t size);
+void* memoryCalloc(MemoryTag tag, size_t count, size_t size);
+void* memoryRealloc(MemoryTag tag, void* pointer, size_t size);
+void memoryFree(MemoryTag tag, void* pointer);
+// memory not coming from malloc, e.g. mapped files
+void memoryTrack(MemoryTag tag, int64_t bytes);
+
+#else
+
+#define memoryAlloc(tag, size) malloc(size)
+#define memoryCalloc(tag, count, size) calloc(count, size)
+#define memoryRealloc(tag, pointer, size) realloc(pointer, size)
+#define memoryFree(tag, pointer) free(pointer)
+#define memoryTrack(tag, bytes) ((void) 0)
+
+#endif
+
+#endif //TEST_MEMORYSTATS_H
@@ -0,0 +1,79 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_SHAREDFIELD_H
+#define TEST_SHAREDFIELD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test/math/Vector.h"
+#include "test/tools/FieldChunk.h"
+
+#define SHARED_FIELD_CHUNKS 8192
+#define SHARED_FIELD_RING_SIZE 4096
+
+typedef struct SharedFieldHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sceneHash;
+	uint64_t heartbeat; // milliseconds of getTimeMonotonic
+	uint64_t computedChunks;
+	int32_t ownerPid;
+	uint64_t enqueuePosition __attribute__((aligned(64)));
+	uint64_t dequeuePosition __attribute__((aligned(64)));
+} SharedFieldHeader;
+
+typedef struct SharedFieldRequest {
+	uint64_t sequence;
+	uint64_t chunkKey;
+} SharedFieldRequest;
+
+// written by the daemon only, readers retry while the sequence is odd or has changed under them
+typedef struct SharedFieldChunk {
+	uint64_t sequence;
+	uint64_t chunkKey;
+	uint64_t stamp;
+	Vector samples[FIELD_CHUNK_CELLS];
+} SharedFieldChunk;
+
+// POSIX shared memory region of one scene: a lock-free request ring from the viewers and a seqlock-protected chunk table from the daemon
+typedef struct SharedField {
+	int owner;
+	size_t size;
+	char name[64];
+	SharedFieldHeader* header;
+	SharedFieldRequest* ring;
+	SharedFieldChunk* chunks;
+} SharedField;
+
+SharedField* sharedFieldCreate(uint64_t sceneHash);
+SharedField* sharedFieldAttach(uint64_t sceneHash);
+void sharedFieldClose(SharedField* field);
+void sharedFieldHeartbeat(SharedField* field);
+int sharedFieldIsAlive(const SharedField* field);
+int sharedFieldRequest(SharedField* field, uint64_t chunkKey);
+int sharedFieldNextRequest(SharedField* field, uint64_t* chunkKey);
+int sharedFieldContains(SharedField* field, uint64_t chunkKey);
+int sharedFieldRead(SharedField* field, int cellX, int cellY, int cellZ, Vector* result);
+void sharedFieldPublish(SharedField* field, uint64_t chunkKey, const Vector* samples);
+
+#endif //TEST_SHAREDFIELD_H
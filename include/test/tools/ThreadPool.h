@@ -0,0 +1,52 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_THREADPOOL_H
+#define TEST_THREADPOOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+typedef void (*ThreadPoolTask)(void* arg, size_t index);
+
+// fixed set of workers which run parallel loops, the calling thread takes part as well
+typedef struct ThreadPool {
+	pthread_t* threads;
+	size_t threadCount;
+	pthread_mutex_t callMutex;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	ThreadPoolTask task;
+	void* arg;
+	size_t next;
+	size_t count;
+	size_t finished;
+	int running;
+} ThreadPool;
+
+size_t threadPoolGetDefaultThreadCount();
+ThreadPool* threadPoolNew(size_t threadCount);
+void threadPoolFree(ThreadPool* pool);
+size_t threadPoolGetThreadCount(const ThreadPool* pool);
+void threadPoolParallelFor(ThreadPool* pool, size_t count, ThreadPoolTask task, void* arg);
+
+#endif //TEST_THREADPOOL_H
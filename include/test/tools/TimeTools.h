@@ -23,6 +23,8 @@
 #define TEST_TIMETOOLS_H
 
 double getTimeDetailed();
+// seconds from an unspecified start, never stepped with the wall clock; every process on the machine shares it
+double getTimeMonotonic();
 unsigned long getTime();
 
 #endif //TEST_TIMETOOLS_H
@@ -0,0 +1,47 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_VIDEOWRITER_H
+#define TEST_VIDEOWRITER_H
+
+#include <stdio.h>
+
+typedef enum VideoFormat {
+	VIDEO_FORMAT_RAW, // packed rgb24 rows top to bottom, e.g. for ffmpeg -f rawvideo -pix_fmt rgb24
+	VIDEO_FORMAT_Y4M // YUV4MPEG2 with full range 4:2:0
+} VideoFormat;
+
+typedef struct VideoWriter {
+	FILE* file;
+	VideoFormat format;
+	int width;
+	int height;
+	unsigned char* buffer;
+	unsigned long frames;
+} VideoWriter;
+
+// Y4M when the path ends with .y4m, raw otherwise
+VideoWriter* videoWriterOpen(const char* path, int width, int height, int fps);
+// rgba holds width * height pixels of 4 bytes, bottom up rows as GL reads them back; returns 0 on a write error
+int videoWriterWriteRgba(VideoWriter* writer, const unsigned char* rgba, int bottomUp);
+void videoWriterClose(VideoWriter* writer);
+
+#endif //TEST_VIDEOWRITER_H
@@ -22,21 +22,24 @@
 #include "test/collections/DynamicArray.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#include "test/tools/MemoryStats.h"
 
 void arrayReInit(DynamicArray* array, size_t capacity) {
 	if (!array) {
 		return;
 	}
 	if (array->rawArray) {
-		free(array->rawArray);
+		memoryFree(MEMORY_TAG_COLLECTIONS, array->rawArray);
 	}
-	array->rawArray = (void**) malloc(sizeof(void*) * capacity),
+	array->rawArray = (void**) memoryAlloc(MEMORY_TAG_COLLECTIONS, sizeof(void*) * capacity),
 	array->length = 0;
 	array->capacity = capacity;
 }
 
 DynamicArray* arrayNew(size_t initialCapacity) {
-	DynamicArray* result = (DynamicArray*) malloc(sizeof(DynamicArray));
+	DynamicArray* result = (DynamicArray*) memoryAlloc(MEMORY_TAG_COLLECTIONS, sizeof(DynamicArray));
 	result->rawArray = NULL;
 	arrayReInit(result, initialCapacity);
 	return result;
@@ -46,8 +49,8 @@ void arrayFree(DynamicArray* array) {
 	if (!array) {
 		return;
 	}
-	free(array->rawArray);
-	free(array);
+	memoryFree(MEMORY_TAG_COLLECTIONS, array->rawArray);
+	memoryFree(MEMORY_TAG_COLLECTIONS, array);
 }
 
 void arrayFreeWithContents(DynamicArray* array) {
@@ -103,21 +106,14 @@ void arrayMoveContents(DynamicArray* array, size_t start, size_t end, long direc
 	if (!array || start >= end || end > array->length || !direction || newStart >= newEnd || newEnd > array->capacity) {
 		return;
 	}
-	size_t i, count;
-	for (
-		i = direction < 0 ? start : end, count = direction < 0 ? newEnd : newStart;
-		direction < 0 ? i < count : i > count;
-		i += direction < 0 ? 1 : -1)
-	{
-		*(array->rawArray + i + (direction < 0 ? -1 : 1)) = *(array->rawArray + i);
-	}
+	memmove(array->rawArray + newStart, array->rawArray + start, sizeof(void*) * (end - start));
 }
 
 void arrayResize(DynamicArray* array, size_t newCapacity) {
 	if (!array || newCapacity < array->length || array->capacity == newCapacity) {
 		return;
 	}
-	array->rawArray = (void**) realloc(array->rawArray, sizeof(void*) * newCapacity);
+	array->rawArray = (void**) memoryRealloc(MEMORY_TAG_COLLECTIONS, array->rawArray, sizeof(void*) * newCapacity);
 	array->capacity = newCapacity;
 }
 
@@ -152,7 +148,7 @@ void arrayRemoveSome(DynamicArray* array, size_t index, size_t count) {
 	if (!array || index + count > array->length) {
 		return;
 	}
-	arrayMoveContents(array, index + 1, array->length, -count);
+	arrayMoveContents(array, index + count, array->length, -(long) count);
 	array->length -= count;
 	if (array->length < array->capacity / 2) {
 		arrayResize(array, (size_t) (array->length * 0.7));
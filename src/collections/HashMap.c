@@ -0,0 +1,183 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/collections/HashMap.h"
+
+#include <stdlib.h>
+
+#include "test/tools/MemoryStats.h"
+
+static inline size_t hashKey(uint64_t key) {
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return (size_t) key;
+}
+
+static inline size_t roundCapacity(size_t capacity) {
+	size_t result = 8;
+	while (result < capacity) {
+		result <<= 1;
+	}
+	return result;
+}
+
+static HashMapEntry* findEntry(const HashMap* map, uint64_t key) {
+	const size_t mask = map->capacity - 1;
+	size_t i = hashKey(key) & mask;
+	while (map->rawArray[i].used) {
+		if (map->rawArray[i].key == key) {
+			return map->rawArray + i;
+		}
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+static void rehash(HashMap* map, size_t newCapacity) {
+	HashMapEntry* oldArray = map->rawArray;
+	const size_t oldCapacity = map->capacity;
+	map->rawArray = (HashMapEntry*) memoryCalloc(MEMORY_TAG_COLLECTIONS, newCapacity, sizeof(HashMapEntry));
+	map->capacity = newCapacity;
+	map->length = 0;
+	size_t i;
+	for (i = 0; i < oldCapacity; ++i) {
+		if (oldArray[i].used) {
+			mapPut(map, oldArray[i].key, oldArray[i].value);
+		}
+	}
+	memoryFree(MEMORY_TAG_COLLECTIONS, oldArray);
+}
+
+HashMap* mapNew(size_t initialCapacity) {
+	HashMap* result = (HashMap*) memoryAlloc(MEMORY_TAG_COLLECTIONS, sizeof(HashMap));
+	result->capacity = roundCapacity(initialCapacity * 2);
+	result->rawArray = (HashMapEntry*) memoryCalloc(MEMORY_TAG_COLLECTIONS, result->capacity, sizeof(HashMapEntry));
+	result->length = 0;
+	return result;
+}
+
+void mapFree(HashMap* map) {
+	if (!map) {
+		return;
+	}
+	memoryFree(MEMORY_TAG_COLLECTIONS, map->rawArray);
+	memoryFree(MEMORY_TAG_COLLECTIONS, map);
+}
+
+void mapFreeWithContents(HashMap* map) {
+	if (!map) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < map->capacity; ++i) {
+		if (map->rawArray[i].used) {
+			free(map->rawArray[i].value);
+		}
+	}
+	mapFree(map);
+}
+
+size_t mapGetLength(const HashMap* map) {
+	if (!map) {
+		return 0;
+	}
+	return map->length;
+}
+
+void* mapGet(const HashMap* map, uint64_t key) {
+	if (!map) {
+		return NULL;
+	}
+	HashMapEntry* entry = findEntry(map, key);
+	return entry ? entry->value : NULL;
+}
+
+int mapContains(const HashMap* map, uint64_t key) {
+	if (!map) {
+		return 0;
+	}
+	return findEntry(map, key) != NULL;
+}
+
+void mapPut(HashMap* map, uint64_t key, void* value) {
+	if (!map) {
+		return;
+	}
+	if ((map->length + 1) * 2 > map->capacity) {
+		rehash(map, map->capacity * 2);
+	}
+	const size_t mask = map->capacity - 1;
+	size_t i = hashKey(key) & mask;
+	while (map->rawArray[i].used) {
+		if (map->rawArray[i].key == key) {
+			map->rawArray[i].value = value;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+	map->rawArray[i].key = key;
+	map->rawArray[i].value = value;
+	map->rawArray[i].used = 1;
+	++map->length;
+}
+
+void* mapRemove(HashMap* map, uint64_t key) {
+	if (!map) {
+		return NULL;
+	}
+	HashMapEntry* entry = findEntry(map, key);
+	if (!entry) {
+		return NULL;
+	}
+	void* result = entry->value;
+
+	// backward shift deletion keeps probe chains intact without tombstones
+	const size_t mask = map->capacity - 1;
+	size_t hole = (size_t) (entry - map->rawArray);
+	size_t i = (hole + 1) & mask;
+	while (map->rawArray[i].used) {
+		const size_t home = hashKey(map->rawArray[i].key) & mask;
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			map->rawArray[hole] = map->rawArray[i];
+			hole = i;
+		}
+		i = (i + 1) & mask;
+	}
+	map->rawArray[hole].used = 0;
+	map->rawArray[hole].value = NULL;
+	--map->length;
+	return result;
+}
+
+void mapRemoveAll(HashMap* map) {
+	if (!map) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < map->capacity; ++i) {
+		map->rawArray[i].used = 0;
+		map->rawArray[i].value = NULL;
+	}
+	map->length = 0;
+}
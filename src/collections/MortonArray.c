@@ -0,0 +1,310 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/collections/MortonArray.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MORTON_AXIS_Z 0x1249249249249249ull // every third bit, shifted by one for y and two for x
+
+typedef struct MortonSortEntry {
+	uint64_t code;
+	size_t index;
+} MortonSortEntry;
+
+static inline uint64_t spreadBits(int value) {
+	uint64_t x = (uint64_t) (value + (1 << 20)) & 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & MORTON_AXIS_Z;
+	return x;
+}
+
+static inline int compactBits(uint64_t x) {
+	x &= MORTON_AXIS_Z;
+	x = (x ^ (x >> 2)) & 0x10c30c30c30c30c3ull;
+	x = (x ^ (x >> 4)) & 0x100f00f00f00f00full;
+	x = (x ^ (x >> 8)) & 0x1f0000ff0000ffull;
+	x = (x ^ (x >> 16)) & 0x1f00000000ffffull;
+	x = (x ^ (x >> 32)) & 0x1fffff;
+	return (int) x - (1 << 20);
+}
+
+uint64_t mortonEncode(int x, int y, int z) {
+	return spreadBits(x) << 2 | spreadBits(y) << 1 | spreadBits(z);
+}
+
+void mortonDecode(uint64_t code, int* x, int* y, int* z) {
+	*x = compactBits(code >> 2);
+	*y = compactBits(code >> 1);
+	*z = compactBits(code);
+}
+
+int mortonContains(uint64_t code, uint64_t minCode, uint64_t maxCode) {
+	int axis;
+	for (axis = 0; axis < 3; ++axis) {
+		const uint64_t mask = MORTON_AXIS_Z << axis;
+		if ((code & mask) < (minCode & mask) || (code & mask) > (maxCode & mask)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// the lower bits of the axis of bit, below it
+static inline uint64_t getLowerAxisBits(int bit) {
+	return (MORTON_AXIS_Z << (bit % 3)) & ((1ull << bit) - 1);
+}
+
+// smallest code above code which lies inside the box, code itself lies between the corners but outside the box;
+// Tropf and Herzog, "Multidimensional Range Search in Dynamically Balanced Trees", 1981
+static uint64_t getBigMin(uint64_t code, uint64_t minCode, uint64_t maxCode) {
+	uint64_t result = UINT64_MAX;
+	int bit;
+	for (bit = 62; bit >= 0; --bit) {
+		const uint64_t mask = 1ull << bit;
+		const int state = (code & mask ? 4 : 0) | (minCode & mask ? 2 : 0) | (maxCode & mask ? 1 : 0);
+		switch (state) {
+			case 1: // 0 0 1
+				result = (minCode | mask) & ~getLowerAxisBits(bit);
+				maxCode = (maxCode & ~mask) | getLowerAxisBits(bit);
+				break;
+			case 3: // 0 1 1
+				return minCode;
+			case 4: // 1 0 0
+				return result;
+			case 5: // 1 0 1
+				minCode = (minCode | mask) & ~getLowerAxisBits(bit);
+				break;
+		}
+	}
+	return result;
+}
+
+static size_t lowerBound(const uint64_t* codes, size_t from, size_t to, uint64_t code) {
+	while (from < to) {
+		const size_t middle = from + (to - from) / 2;
+		if (codes[middle] < code) {
+			from = middle + 1;
+		} else {
+			to = middle;
+		}
+	}
+	return from;
+}
+
+static int compareSortEntries(const void* a, const void* b) {
+	const uint64_t codeA = ((const MortonSortEntry*) a)->code;
+	const uint64_t codeB = ((const MortonSortEntry*) b)->code;
+	return codeA < codeB ? -1 : codeA > codeB;
+}
+
+static int reserve(MortonArray* array, size_t capacity) {
+	if (capacity <= array->capacity) {
+		return 1;
+	}
+	uint64_t* codes = (uint64_t*) memoryRealloc(array->tag, array->codes, sizeof(uint64_t) * capacity);
+	if (!codes) {
+		return 0;
+	}
+	array->codes = codes;
+	char* items = (char*) memoryRealloc(array->tag, array->items, array->itemSize * capacity);
+	if (!items) {
+		return 0;
+	}
+	array->items = items;
+	array->capacity = capacity;
+	// the spare buffers follow at the next sort
+	memoryFree(array->tag, array->spareCodes);
+	memoryFree(array->tag, array->spareItems);
+	array->spareCodes = NULL;
+	array->spareItems = NULL;
+	return 1;
+}
+
+MortonArray* mortonArrayNew(MemoryTag tag, size_t itemSize, size_t initialCapacity) {
+	MortonArray* result = (MortonArray*) memoryCalloc(tag, 1, sizeof(MortonArray));
+	if (!result) {
+		return NULL;
+	}
+	result->tag = tag;
+	result->itemSize = itemSize;
+	if (!reserve(result, initialCapacity ? initialCapacity : 1)) {
+		mortonArrayFree(result);
+		return NULL;
+	}
+	return result;
+}
+
+void mortonArrayFree(MortonArray* array) {
+	if (!array) {
+		return;
+	}
+	memoryFree(array->tag, array->codes);
+	memoryFree(array->tag, array->items);
+	memoryFree(array->tag, array->spareCodes);
+	memoryFree(array->tag, array->spareItems);
+	memoryFree(array->tag, array);
+}
+
+size_t mortonArrayGetLength(const MortonArray* array) {
+	if (!array) {
+		return 0;
+	}
+	return array->length;
+}
+
+void* mortonArrayGetAt(const MortonArray* array, size_t index) {
+	if (!array || index >= array->length) {
+		return NULL;
+	}
+	return array->items + index * array->itemSize;
+}
+
+uint64_t mortonArrayGetCode(const MortonArray* array, size_t index) {
+	if (!array || index >= array->length) {
+		return 0;
+	}
+	return array->codes[index];
+}
+
+void* mortonArrayAppend(MortonArray* array, int x, int y, int z) {
+	if (!array || (array->length == array->capacity && !reserve(array, array->capacity * 2))) {
+		return NULL;
+	}
+	array->codes[array->length] = mortonEncode(x, y, z);
+	return array->items + array->length++ * array->itemSize;
+}
+
+void mortonArraySort(MortonArray* array) {
+	if (!array || array->sortedLength == array->length) {
+		return;
+	}
+	const size_t tailLength = array->length - array->sortedLength;
+	MortonSortEntry* tail = (MortonSortEntry*) memoryAlloc(array->tag, sizeof(MortonSortEntry) * tailLength);
+	if (!array->spareCodes) {
+		array->spareCodes = (uint64_t*) memoryAlloc(array->tag, sizeof(uint64_t) * array->capacity);
+		array->spareItems = (char*) memoryAlloc(array->tag, array->itemSize * array->capacity);
+	}
+	if (!tail || !array->spareCodes || !array->spareItems) {
+		memoryFree(array->tag, tail);
+		return;
+	}
+	size_t i, j, k;
+	for (i = 0; i < tailLength; ++i) {
+		tail[i].code = array->codes[array->sortedLength + i];
+		tail[i].index = array->sortedLength + i;
+	}
+	qsort(tail, tailLength, sizeof(MortonSortEntry), compareSortEntries);
+
+	// merge both ordered runs into the spare buffers, then swap them in
+	for (i = 0, j = 0, k = 0; i < array->sortedLength || j < tailLength; ++k) {
+		size_t from;
+		if (j == tailLength || (i < array->sortedLength && array->codes[i] <= tail[j].code)) {
+			from = i++;
+		} else {
+			from = tail[j++].index;
+		}
+		array->spareCodes[k] = array->codes[from];
+		memcpy(array->spareItems + k * array->itemSize, array->items + from * array->itemSize, array->itemSize);
+	}
+	memoryFree(array->tag, tail);
+	uint64_t* codes = array->codes;
+	char* items = array->items;
+	array->codes = array->spareCodes;
+	array->items = array->spareItems;
+	array->spareCodes = codes;
+	array->spareItems = items;
+	array->sortedLength = array->length;
+	++array->sorts;
+}
+
+int mortonArrayNeedsSort(const MortonArray* array) {
+	if (!array) {
+		return 0;
+	}
+	return (array->length - array->sortedLength) * 8 > array->length;
+}
+
+size_t mortonArrayRetain(MortonArray* array, const uint64_t* minCodes, const uint64_t* maxCodes, size_t boxCount) {
+	if (!array) {
+		return 0;
+	}
+	size_t i, box, kept = 0, sortedKept = 0;
+	for (i = 0; i < array->length; ++i) {
+		for (box = 0; box < boxCount && !mortonContains(array->codes[i], minCodes[box], maxCodes[box]); ++box);
+		if (box == boxCount) {
+			continue;
+		}
+		if (kept != i) {
+			array->codes[kept] = array->codes[i];
+			memcpy(array->items + kept * array->itemSize, array->items + i * array->itemSize, array->itemSize);
+		}
+		if (i < array->sortedLength) {
+			++sortedKept;
+		}
+		++kept;
+	}
+	const size_t removed = array->length - kept;
+	array->length = kept;
+	array->sortedLength = sortedKept;
+	return removed;
+}
+
+size_t mortonArrayNextInBox(const MortonArray* array, size_t index, uint64_t minCode, uint64_t maxCode) {
+	if (!array) {
+		return 0;
+	}
+	while (index < array->sortedLength) {
+		const uint64_t code = array->codes[index];
+		if (code > maxCode) {
+			index = array->sortedLength;
+			break;
+		}
+		if (code >= minCode && mortonContains(code, minCode, maxCode)) {
+			return index;
+		}
+		const uint64_t next = code < minCode ? minCode : getBigMin(code, minCode, maxCode);
+		index = lowerBound(array->codes, index + 1, array->sortedLength, next);
+	}
+	for (; index < array->length; ++index) {
+		if (mortonContains(array->codes[index], minCode, maxCode)) {
+			return index;
+		}
+	}
+	return array->length;
+}
+
+size_t mortonArrayFind(const MortonArray* array, int x, int y, int z) {
+	if (!array) {
+		return 0;
+	}
+	const uint64_t code = mortonEncode(x, y, z);
+	size_t index = lowerBound(array->codes, 0, array->sortedLength, code);
+	if (index < array->sortedLength && array->codes[index] == code) {
+		return index;
+	}
+	for (index = array->sortedLength; index < array->length && array->codes[index] != code; ++index);
+	return index;
+}
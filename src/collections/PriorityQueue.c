@@ -0,0 +1,149 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/collections/PriorityQueue.h"
+
+#include <stdlib.h>
+
+#include "test/tools/MemoryStats.h"
+
+static inline void swapEntries(PriorityQueueEntry* a, PriorityQueueEntry* b) {
+	PriorityQueueEntry t = *a;
+	*a = *b;
+	*b = t;
+}
+
+PriorityQueue* queueNew(size_t initialCapacity) {
+	PriorityQueue* result = (PriorityQueue*) memoryAlloc(MEMORY_TAG_COLLECTIONS, sizeof(PriorityQueue));
+	result->rawArray = (PriorityQueueEntry*) memoryAlloc(MEMORY_TAG_COLLECTIONS, sizeof(PriorityQueueEntry) * (initialCapacity ? initialCapacity : 1));
+	result->length = 0;
+	result->capacity = initialCapacity ? initialCapacity : 1;
+	return result;
+}
+
+void queueFree(PriorityQueue* queue) {
+	if (!queue) {
+		return;
+	}
+	memoryFree(MEMORY_TAG_COLLECTIONS, queue->rawArray);
+	memoryFree(MEMORY_TAG_COLLECTIONS, queue);
+}
+
+void queueFreeWithContents(PriorityQueue* queue) {
+	if (!queue) {
+		return;
+	}
+	queueDestroyAll(queue);
+	queueFree(queue);
+}
+
+size_t queueGetLength(const PriorityQueue* queue) {
+	if (!queue) {
+		return 0;
+	}
+	return queue->length;
+}
+
+void queueResize(PriorityQueue* queue, size_t newCapacity) {
+	if (!queue || !newCapacity || newCapacity < queue->length || queue->capacity == newCapacity) {
+		return;
+	}
+	queue->rawArray = (PriorityQueueEntry*) memoryRealloc(MEMORY_TAG_COLLECTIONS, queue->rawArray, sizeof(PriorityQueueEntry) * newCapacity);
+	queue->capacity = newCapacity;
+}
+
+void queuePush(PriorityQueue* queue, void* elem, double priority) {
+	if (!queue) {
+		return;
+	}
+	if (queue->length == queue->capacity) {
+		queueResize(queue, (size_t) (queue->length * 1.3 + 1));
+	}
+	size_t i = queue->length++;
+	queue->rawArray[i].priority = priority;
+	queue->rawArray[i].elem = elem;
+	while (i > 0) {
+		const size_t parent = (i - 1) / 2;
+		if (queue->rawArray[parent].priority <= queue->rawArray[i].priority) {
+			break;
+		}
+		swapEntries(queue->rawArray + parent, queue->rawArray + i);
+		i = parent;
+	}
+}
+
+void* queuePeek(const PriorityQueue* queue) {
+	if (!queue || !queue->length) {
+		return NULL;
+	}
+	return queue->rawArray[0].elem;
+}
+
+double queuePeekPriority(const PriorityQueue* queue) {
+	if (!queue || !queue->length) {
+		return 0;
+	}
+	return queue->rawArray[0].priority;
+}
+
+void* queuePop(PriorityQueue* queue) {
+	if (!queue || !queue->length) {
+		return NULL;
+	}
+	void* result = queue->rawArray[0].elem;
+	queue->rawArray[0] = queue->rawArray[--queue->length];
+	size_t i = 0;
+	while (1) {
+		const size_t left = 2 * i + 1;
+		const size_t right = left + 1;
+		size_t smallest = i;
+		if (left < queue->length && queue->rawArray[left].priority < queue->rawArray[smallest].priority) {
+			smallest = left;
+		}
+		if (right < queue->length && queue->rawArray[right].priority < queue->rawArray[smallest].priority) {
+			smallest = right;
+		}
+		if (smallest == i) {
+			break;
+		}
+		swapEntries(queue->rawArray + smallest, queue->rawArray + i);
+		i = smallest;
+	}
+	return result;
+}
+
+void queueRemoveAll(PriorityQueue* queue) {
+	if (!queue) {
+		return;
+	}
+	queue->length = 0;
+}
+
+void queueDestroyAll(PriorityQueue* queue) {
+	if (!queue) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < queue->length; ++i) {
+		free(queue->rawArray[i].elem);
+	}
+	queue->length = 0;
+}
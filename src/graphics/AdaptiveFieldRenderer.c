@@ -0,0 +1,108 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/graphics/AdaptiveFieldRenderer.h"
+
+#include <stdint.h>
+#include <math.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+
+#include "test/graphics/Color.h"
+#include "test/graphics/MagneticFieldRenderer.h"
+#include "test/tools/FieldOctree.h"
+#include "test/tools/TimeTools.h"
+
+#define ADAPTIVE_EXTENT 96.0
+#define ADAPTIVE_SNAP 12.0
+#define ADAPTIVE_TOLERANCE 0.05
+#define ADAPTIVE_MIN_DEPTH 2
+#define ADAPTIVE_MAX_DEPTH 6
+#define ADAPTIVE_ARROW_SCALE 0.4
+
+static FieldOctree* _tree = NULL;
+static uint64_t _sceneHash = 0;
+static Vector _center = { 0, 0, 0 };
+static AdaptiveFieldStats _stats = { 0, 0, 0, 0 };
+
+static void updateTree(const RenderContext* context) {
+	const Vector center = {
+		floor(context->camera.position.x / ADAPTIVE_SNAP) * ADAPTIVE_SNAP,
+		floor(context->camera.position.y / ADAPTIVE_SNAP) * ADAPTIVE_SNAP,
+		floor(context->camera.position.z / ADAPTIVE_SNAP) * ADAPTIVE_SNAP
+	};
+	const uint64_t sceneHash = getMagneticFieldSceneHash();
+	if (_tree && _sceneHash == sceneHash && vectorIsEqual(_center, center)) {
+		return;
+	}
+
+	const double startTime = getTimeDetailed();
+	FieldSourceSet* sources = copyMagneticFieldSources();
+	fieldOctreeFree(_tree);
+	_tree = fieldOctreeBuild(sources, center, ADAPTIVE_EXTENT / 2, ADAPTIVE_TOLERANCE, ADAPTIVE_MIN_DEPTH, ADAPTIVE_MAX_DEPTH);
+	fieldSourceSetFree(sources);
+	_sceneHash = sceneHash;
+	_center = center;
+	_stats.leaves = _tree ? _tree->leafCount : 0;
+	_stats.samples = _tree ? _tree->sampleCount : 0;
+	_stats.uniformSamples = _tree ? fieldOctreeGetUniformSampleCount(_tree) : 0;
+	_stats.buildTime = (float) (getTimeDetailed() - startTime);
+}
+
+int initAdaptiveField() {
+	return 1;
+}
+
+// one arrow per leaf, as long as a fraction of the cell and colored by depth, so the refinement is visible
+void renderAdaptiveField(const RenderContext* context) {
+	size_t i;
+	int corner;
+	updateTree(context);
+	if (!_tree) {
+		return;
+	}
+	glBegin(GL_LINES);
+	for (i = 0; i < _tree->nodeCount; ++i) {
+		const FieldOctreeNode* node = _tree->nodes + i;
+		if (node->firstChild >= 0) {
+			continue;
+		}
+		Vector field = vectorZero;
+		for (corner = 0; corner < 8; ++corner) {
+			field = vectorSum(field, _tree->samples[node->corners[corner]]);
+		}
+		if (vectorGetLengthSq(field) <= 0) {
+			continue;
+		}
+		const Vector center = fieldOctreeGetCellCenter(_tree, node);
+		const Vector tip = vectorSum(center, vectorMultiply(vectorNormalize(field), fieldOctreeGetCellSize(_tree, node) * ADAPTIVE_ARROW_SCALE));
+		const float depth = (float) node->depth / ADAPTIVE_MAX_DEPTH;
+		glColor3f(colorWhite.r * (1 - depth) + colorRed.r * depth, colorWhite.g * (1 - depth) + colorRed.g * depth, colorWhite.b * (1 - depth) + colorRed.b * depth);
+		glVertex3d(center.x, center.y, center.z);
+		glColor3f(colorRed.r, colorRed.g, colorRed.b);
+		glVertex3d(tip.x, tip.y, tip.z);
+	}
+	glEnd();
+}
+
+AdaptiveFieldStats getAdaptiveFieldStats() {
+	return _stats;
+}
@@ -0,0 +1,209 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/graphics/FrameCapture.h"
+
+#include <stdio.h>
+
+#include "test/tools/MemoryStats.h"
+#include "test/tools/TimeTools.h"
+
+#define FRAME_CAPTURE_STOP_TIMEOUT 1000000000 // ns to wait for the last read backs
+
+static void* runWriter(void* arg) {
+	FrameCapture* capture = (FrameCapture*) arg;
+	void* item;
+	while (boundedQueuePop(capture->queue, &item)) {
+		const int slot = (int) (size_t) item;
+		pthread_mutex_lock(&capture->mutex);
+		const int failed = capture->stats.failed;
+		const int discard = capture->discard;
+		pthread_mutex_unlock(&capture->mutex);
+
+		const int written = !failed && !discard && videoWriterWriteRgba(capture->writer, capture->mapping + capture->frameSize * slot, 1);
+
+		pthread_mutex_lock(&capture->mutex);
+		if (written) {
+			++capture->stats.written;
+		} else {
+			if (!failed && !discard) {
+				fprintf(stderr, "error: Can't write captured frame, dropping the rest\n");
+				capture->stats.failed = 1;
+			}
+			++capture->stats.dropped;
+		}
+		capture->states[slot] = FRAME_CAPTURE_FREE;
+		pthread_mutex_unlock(&capture->mutex);
+	}
+	return NULL;
+}
+
+// hands every slot whose copy has finished to the writer, in the order the frames were read
+static void collectFrames(FrameCapture* capture, GLbitfield flags, GLuint64 timeout) {
+	while (capture->states[capture->oldest] == FRAME_CAPTURE_READING) {
+		const int slot = capture->oldest;
+		const GLenum status = glClientWaitSync(capture->fences[slot], flags, timeout);
+		if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+			break;
+		}
+		glDeleteSync(capture->fences[slot]);
+		capture->fences[slot] = NULL;
+		pthread_mutex_lock(&capture->mutex);
+		capture->states[slot] = FRAME_CAPTURE_WRITING;
+		pthread_mutex_unlock(&capture->mutex);
+		// never blocks, the queue holds as many items as there are slots
+		boundedQueuePush(capture->queue, (void*) (size_t) slot);
+		capture->oldest = (slot + 1) % FRAME_CAPTURE_SLOTS;
+	}
+}
+
+int frameCaptureIsSupported() {
+	return GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+}
+
+FrameCapture* frameCaptureStart(const char* path, int width, int height, int fps) {
+	if (!frameCaptureIsSupported() || width <= 0 || height <= 0) {
+		return NULL;
+	}
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const size_t frameSize = (size_t) width * height * 4;
+
+	FrameCapture* capture = (FrameCapture*) memoryCalloc(MEMORY_TAG_RENDERING, 1, sizeof(FrameCapture));
+	if (!capture) {
+		return NULL;
+	}
+	capture->writer = videoWriterOpen(path, width, height, fps);
+	capture->queue = boundedQueueNew(FRAME_CAPTURE_SLOTS);
+	if (!capture->writer || !capture->queue) {
+		videoWriterClose(capture->writer);
+		boundedQueueFree(capture->queue);
+		memoryFree(MEMORY_TAG_RENDERING, capture);
+		return NULL;
+	}
+	glGenBuffers(1, &capture->buffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->buffer);
+	glBufferStorage(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) (frameSize * FRAME_CAPTURE_SLOTS), NULL, flags | GL_CLIENT_STORAGE_BIT);
+	capture->mapping = (unsigned char*) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) (frameSize * FRAME_CAPTURE_SLOTS), flags);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!capture->mapping) {
+		glDeleteBuffers(1, &capture->buffer);
+		videoWriterClose(capture->writer);
+		boundedQueueFree(capture->queue);
+		memoryFree(MEMORY_TAG_RENDERING, capture);
+		return NULL;
+	}
+	memoryTrack(MEMORY_TAG_MAPPED, (int64_t) (frameSize * FRAME_CAPTURE_SLOTS));
+	capture->frameSize = frameSize;
+	capture->width = width;
+	capture->height = height;
+	pthread_mutex_init(&capture->mutex, NULL);
+	pthread_create(&capture->thread, NULL, runWriter, capture);
+	return capture;
+}
+
+void frameCaptureFrame(FrameCapture* capture) {
+	if (!capture) {
+		return;
+	}
+	const double startTime = getTimeDetailed();
+	collectFrames(capture, 0, 0);
+
+	const int slot = capture->next;
+	pthread_mutex_lock(&capture->mutex);
+	const int isFree = capture->states[slot] == FRAME_CAPTURE_FREE;
+	if (!isFree) {
+		++capture->stats.dropped;
+	}
+	pthread_mutex_unlock(&capture->mutex);
+	if (isFree) {
+		// only queues the copy, the pixels land in the slot once the GPU gets there
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->buffer);
+		glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) (capture->frameSize * slot));
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		capture->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		capture->next = (slot + 1) % FRAME_CAPTURE_SLOTS;
+	}
+
+	const double cost = getTimeDetailed() - startTime;
+	pthread_mutex_lock(&capture->mutex);
+	if (isFree) {
+		capture->states[slot] = FRAME_CAPTURE_READING;
+		++capture->stats.captured;
+	}
+	capture->stats.lastCost = cost;
+	if (cost > capture->stats.maxCost) {
+		capture->stats.maxCost = cost;
+	}
+	pthread_mutex_unlock(&capture->mutex);
+}
+
+FrameCaptureStats frameCaptureStop(FrameCapture* capture, int hasContext) {
+	FrameCaptureStats result = { 0, 0, 0, 0, 0, 0 };
+	if (!capture) {
+		return result;
+	}
+	int slot;
+	if (hasContext) {
+		collectFrames(capture, GL_SYNC_FLUSH_COMMANDS_BIT, FRAME_CAPTURE_STOP_TIMEOUT);
+	}
+	pthread_mutex_lock(&capture->mutex);
+	capture->discard = !hasContext;
+	for (slot = 0; slot < FRAME_CAPTURE_SLOTS; ++slot) {
+		if (capture->states[slot] == FRAME_CAPTURE_READING) {
+			++capture->stats.dropped;
+		}
+	}
+	pthread_mutex_unlock(&capture->mutex);
+
+	// the writer drains what is queued before it sees the queue closed
+	boundedQueueClose(capture->queue);
+	pthread_join(capture->thread, NULL);
+	if (hasContext) {
+		for (slot = 0; slot < FRAME_CAPTURE_SLOTS; ++slot) {
+			if (capture->fences[slot]) {
+				glDeleteSync(capture->fences[slot]);
+			}
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->buffer);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glDeleteBuffers(1, &capture->buffer);
+	}
+	memoryTrack(MEMORY_TAG_MAPPED, -(int64_t) (capture->frameSize * FRAME_CAPTURE_SLOTS));
+	result = capture->stats;
+	videoWriterClose(capture->writer);
+	boundedQueueFree(capture->queue);
+	pthread_mutex_destroy(&capture->mutex);
+	memoryFree(MEMORY_TAG_RENDERING, capture);
+	return result;
+}
+
+FrameCaptureStats frameCaptureGetStats(FrameCapture* capture) {
+	FrameCaptureStats result = { 0, 0, 0, 0, 0, 0 };
+	if (!capture) {
+		return result;
+	}
+	pthread_mutex_lock(&capture->mutex);
+	result = capture->stats;
+	pthread_mutex_unlock(&capture->mutex);
+	return result;
+}
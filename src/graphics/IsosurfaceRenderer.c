@@ -0,0 +1,259 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/graphics/IsosurfaceRenderer.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+
+#include "test/graphics/Color.h"
+#include "test/graphics/MagneticFieldRenderer.h"
+#include "test/physics/FieldSource.h"
+#include "test/collections/HashMap.h"
+#include "test/math/MathFunctions.h"
+#include "test/tools/FieldChunk.h"
+#include "test/tools/IsoMesh.h"
+#include "test/tools/MemoryStats.h"
+#include "test/tools/TimeTools.h"
+
+#define ISO_CHUNK_CELLS 16
+#define ISO_SPACING 1.5
+#define ISO_CHUNK_RADIUS 2
+#define ISO_CHUNKS ((2 * ISO_CHUNK_RADIUS) * (2 * ISO_CHUNK_RADIUS) * (2 * ISO_CHUNK_RADIUS))
+// one extra sample on every side for gradients at the chunk border
+#define ISO_SAMPLES (ISO_CHUNK_CELLS + 3)
+#define ISO_DEFAULT_LEVEL 1.0
+
+// how far a resampled value may drift, relative to the level, before the chunk is extracted again
+#define ISO_SAMPLE_TOLERANCE 1.0e-3
+
+typedef struct IsoChunk {
+	uint64_t key;
+	int used;
+	int dirty;
+	uint64_t sceneHash;
+	double level;
+	float* samples; // the samples the mesh was extracted from
+	float* fresh; // the samples of the latest scene
+	IsoMesh* mesh;
+} IsoChunk;
+
+typedef struct IsoJob {
+	IsoChunk* chunks[ISO_CHUNKS];
+	size_t chunkCount;
+	const FieldSourceSet* sources;
+	uint64_t sceneHash;
+	double level;
+	size_t extracted;
+} IsoJob;
+
+static ThreadPool* _pool;
+static IsoChunk _chunks[ISO_CHUNKS];
+static double _level = ISO_DEFAULT_LEVEL;
+static IsosurfaceStats _stats;
+
+static void computeSamples(const IsoChunk* chunk, const IsoJob* job, float* samples) {
+	Vector positions[ISO_SAMPLES * ISO_SAMPLES];
+	Vector results[ISO_SAMPLES * ISO_SAMPLES];
+	int chunkX, chunkY, chunkZ, x, y, z;
+	size_t i;
+	fieldChunkFromKey(chunk->key, &chunkX, &chunkY, &chunkZ);
+	for (x = 0; x < ISO_SAMPLES; ++x) {
+		for (y = 0; y < ISO_SAMPLES; ++y) {
+			for (z = 0; z < ISO_SAMPLES; ++z) {
+				positions[y * ISO_SAMPLES + z] = vectorCreate(
+					(chunkX * ISO_CHUNK_CELLS + x - 1) * ISO_SPACING,
+					(chunkY * ISO_CHUNK_CELLS + y - 1) * ISO_SPACING,
+					(chunkZ * ISO_CHUNK_CELLS + z - 1) * ISO_SPACING
+				);
+				results[y * ISO_SAMPLES + z] = vectorZero;
+			}
+		}
+		fieldSourceSetEvaluate(job->sources, positions, results, ISO_SAMPLES * ISO_SAMPLES);
+		for (i = 0; i < ISO_SAMPLES * ISO_SAMPLES; ++i) {
+			samples[(size_t) x * ISO_SAMPLES * ISO_SAMPLES + i] = (float) vectorGetLength(results[i]);
+		}
+	}
+}
+
+// an edit far away barely moves the samples here, the mesh only changes when one crosses the level or drifts visibly
+static int samplesDiffer(const float* from, const float* to, double level) {
+	const double tolerance = ISO_SAMPLE_TOLERANCE * fabs(level);
+	size_t i;
+	for (i = 0; i < ISO_SAMPLES * ISO_SAMPLES * ISO_SAMPLES; ++i) {
+		if ((from[i] > level) != (to[i] > level) || fabs(from[i] - to[i]) > tolerance) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void updateChunk(void* arg, size_t index) {
+	IsoJob* job = (IsoJob*) arg;
+	IsoChunk* chunk = job->chunks[index];
+	int dirty = chunk->dirty || chunk->level != job->level;
+	if (chunk->sceneHash != job->sceneHash) {
+		computeSamples(chunk, job, chunk->fresh);
+		chunk->sceneHash = job->sceneHash;
+		if (dirty || samplesDiffer(chunk->samples, chunk->fresh, job->level)) {
+			float* samples = chunk->samples;
+			chunk->samples = chunk->fresh;
+			chunk->fresh = samples;
+			dirty = 1;
+		}
+	}
+
+	// samples within the tolerance and an unchanged level keep the old mesh
+	if (!dirty) {
+		return;
+	}
+	int chunkX, chunkY, chunkZ;
+	fieldChunkFromKey(chunk->key, &chunkX, &chunkY, &chunkZ);
+	const Vector origin = vectorCreate(
+		(chunkX * ISO_CHUNK_CELLS - 1) * ISO_SPACING,
+		(chunkY * ISO_CHUNK_CELLS - 1) * ISO_SPACING,
+		(chunkZ * ISO_CHUNK_CELLS - 1) * ISO_SPACING
+	);
+	isoMeshExtract(chunk->mesh, chunk->samples, ISO_SAMPLES, job->level, origin, ISO_SPACING);
+	chunk->level = job->level;
+	chunk->dirty = 0;
+	__atomic_add_fetch(&job->extracted, 1, __ATOMIC_RELAXED);
+}
+
+static void updateChunks(const RenderContext* context) {
+	const int centerX = fieldChunkFloorDiv((int) floor(context->camera.position.x / ISO_SPACING), ISO_CHUNK_CELLS);
+	const int centerY = fieldChunkFloorDiv((int) floor(context->camera.position.y / ISO_SPACING), ISO_CHUNK_CELLS);
+	const int centerZ = fieldChunkFloorDiv((int) floor(context->camera.position.z / ISO_SPACING), ISO_CHUNK_CELLS);
+	HashMap* wanted = mapNew(ISO_CHUNKS);
+	IsoJob job;
+	int x, y, z;
+	size_t i, count;
+
+	// keep chunks still in the window, hand the others over to the new keys
+	for (x = centerX - ISO_CHUNK_RADIUS; x < centerX + ISO_CHUNK_RADIUS; ++x) {
+		for (y = centerY - ISO_CHUNK_RADIUS; y < centerY + ISO_CHUNK_RADIUS; ++y) {
+			for (z = centerZ - ISO_CHUNK_RADIUS; z < centerZ + ISO_CHUNK_RADIUS; ++z) {
+				mapPut(wanted, fieldChunkGetKey(x, y, z), wanted);
+			}
+		}
+	}
+	for (i = 0; i < ISO_CHUNKS; ++i) {
+		if (_chunks[i].used && mapContains(wanted, _chunks[i].key)) {
+			mapRemove(wanted, _chunks[i].key);
+		} else {
+			_chunks[i].used = 0;
+		}
+	}
+	for (i = 0, count = 0; i < wanted->capacity; ++i) {
+		if (!wanted->rawArray[i].used) {
+			continue;
+		}
+		while (_chunks[count].used) {
+			++count;
+		}
+		_chunks[count].key = wanted->rawArray[i].key;
+		_chunks[count].used = 1;
+		_chunks[count].dirty = 1;
+		_chunks[count].sceneHash = 0;
+		_chunks[count].mesh->vertexCount = 0;
+		_chunks[count].mesh->indexCount = 0;
+	}
+	mapFree(wanted);
+
+	job.sources = copyMagneticFieldSources();
+	job.sceneHash = getMagneticFieldSceneHash();
+	job.level = _level;
+	job.extracted = 0;
+	job.chunkCount = 0;
+	for (i = 0; i < ISO_CHUNKS; ++i) {
+		job.chunks[job.chunkCount++] = _chunks + i;
+	}
+
+	const double startTime = getTimeDetailed();
+	threadPoolParallelFor(_pool, job.chunkCount, updateChunk, &job);
+	const double duration = getTimeDetailed() - startTime;
+	fieldSourceSetFree((FieldSourceSet*) job.sources);
+	if (job.extracted) {
+		_stats.voxelsPerSecond = job.extracted * (double) ISO_CHUNK_CELLS * ISO_CHUNK_CELLS * ISO_CHUNK_CELLS / max(duration, 1.0e-9);
+	}
+	_stats.level = _level;
+	_stats.chunks = job.chunkCount;
+	_stats.extractedChunks = job.extracted;
+	_stats.triangles = 0;
+	for (i = 0; i < ISO_CHUNKS; ++i) {
+		_stats.triangles += _chunks[i].mesh->indexCount / 3;
+	}
+}
+
+int initIsosurface(ThreadPool* pool) {
+	size_t i;
+	_pool = pool;
+	for (i = 0; i < ISO_CHUNKS; ++i) {
+		_chunks[i].samples = (float*) memoryAlloc(MEMORY_TAG_RENDERING, sizeof(float) * ISO_SAMPLES * ISO_SAMPLES * ISO_SAMPLES);
+		_chunks[i].fresh = (float*) memoryAlloc(MEMORY_TAG_RENDERING, sizeof(float) * ISO_SAMPLES * ISO_SAMPLES * ISO_SAMPLES);
+		_chunks[i].mesh = isoMeshNew();
+		if (!_chunks[i].samples || !_chunks[i].fresh || !_chunks[i].mesh) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void renderIsosurface(const RenderContext* context) {
+	static const GLfloat lightPosition[] = { 0.3f, 1, 0.5f, 0 };
+	size_t i;
+	updateChunks(context);
+
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glEnable(GL_COLOR_MATERIAL);
+	glEnable(GL_CULL_FACE);
+	glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
+	glColor3f(colorOrange.r, colorOrange.g, colorOrange.b);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	for (i = 0; i < ISO_CHUNKS; ++i) {
+		const IsoMesh* mesh = _chunks[i].mesh;
+		if (!_chunks[i].used || !mesh->indexCount) {
+			continue;
+		}
+		glVertexPointer(3, GL_FLOAT, sizeof(IsoMeshVertex), &mesh->vertices->x);
+		glNormalPointer(GL_FLOAT, sizeof(IsoMeshVertex), &mesh->vertices->nx);
+		glDrawElements(GL_TRIANGLES, (GLsizei) mesh->indexCount, GL_UNSIGNED_INT, mesh->indices);
+	}
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisable(GL_COLOR_MATERIAL);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_LIGHT0);
+	glDisable(GL_LIGHTING);
+}
+
+void setIsosurfaceLevel(double level) {
+	_level = level;
+}
+
+IsosurfaceStats getIsosurfaceStats() {
+	return _stats;
+}
@@ -21,28 +21,95 @@
 
 #include "test/graphics/MagneticFieldRenderer.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <GL/glew.h>
 #include <GL/glut.h>
 #include <pthread.h>
 
-#include "test/physics/electromagnetism.h"
+#include "test/graphics/VertexStream.h"
+#include "test/physics/FieldSource.h"
+#include "test/physics/FieldScene.h"
+#include "test/physics/SceneKernel.h"
 #include "test/collections/DynamicArray.h"
+#include "test/collections/HashMap.h"
+#include "test/collections/MortonArray.h"
+#include "test/collections/PriorityQueue.h"
 #include "test/tools/RenderTools.h"
+#include "test/tools/TimeTools.h"
+#include "test/tools/FieldCache.h"
+#include "test/tools/FieldChunk.h"
+#include "test/tools/FieldSample.h"
+#include "test/tools/JobSystem.h"
+#include "test/tools/MemoryStats.h"
+#include "test/tools/SharedField.h"
+#include "test/math/MathFunctions.h"
 
-typedef struct Conductor {
-	Vector position;
-	double I;
-	double permeability;
-	Vector l;
-} Conductor;
+#define FIELD_WINDOW_RADIUS 48
+#define FIELD_REPRIORITIZE_COS 0.996 // about 5 degrees of camera turn
+#define FIELD_INVISIBLE_PENALTY 1.0e4
+#define FIELD_CACHE_SYNC_INTERVAL 2.0
+#define FIELD_STREAM_MAX_POINTS 32768
+#define FIELD_REQUEST_INTERVAL 0.5
+#define FIELD_UPDATE_CHUNK 16 // cells between two checks for a newer context
+#define FIELD_DELTA_MAX_SHRINK 2.0 // how much an edit may weaken a point before it is computed again
 
-typedef struct VectorFieldPoint {
-	Vector position;
-	Vector direction;
-} VectorFieldPoint;
+// the points of one chunk of cells, packed; their positions follow from the chunk and their index in it
+typedef struct FieldPointChunk {
+	uint64_t mask; // which cells have a point
+	uint64_t stale; // which of those an edit has moved since they were computed, they are drawn until computed again
+	PackedFieldSample samples[FIELD_CHUNK_CELLS];
+} FieldPointChunk;
 
-static DynamicArray* _conductors;
-static DynamicArray* _fieldPoints;
+// what one viewport needs from the field: the window of cells around its focus and how to order them
+typedef struct FieldView {
+	Vector focus;
+	Vector direction; // normalized, only perspective views order cells by it
+	int perspective;
+	double cosHalfFov;
+	int from[3];
+	int to[3];
+} FieldView;
+
+typedef struct PendingCell {
+	int x;
+	int y;
+	int z;
+	double priority;
+} PendingCell;
+
+static FieldScene* _scene;
+static MortonArray* _fieldPoints; // chunks in Morton order, so neighbouring cells share cache lines
+static size_t _fieldPointCount = 0;
 static pthread_mutex_t _fieldPointsMutex;
+static unsigned long _fieldGeneration = 0;
+static Vector* _deltaPositions = NULL;
+static Vector* _deltaDirections = NULL;
+static size_t _deltaCapacity = 0;
+static PriorityQueue* _pendingCells;
+static FieldView _plannedViews[RENDER_MAX_VIEWPORTS];
+static int _plannedViewCount = 0;
+static uint64_t _windowMinCodes[RENDER_MAX_VIEWPORTS];
+static uint64_t _windowMaxCodes[RENDER_MAX_VIEWPORTS];
+static MagneticFieldUpdateStats _updateStats = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+static FieldCache* _fieldCache = NULL;
+static uint64_t _sceneHash = 0;
+static double _lastCacheSyncTime = 0;
+static VertexStream* _fieldStream = NULL;
+static int _fieldStreamChecked = 0;
+static unsigned long _publishedGeneration = 0;
+static int _published = 0;
+static SharedField* _sharedField = NULL;
+static DynamicArray* _waitingCells;
+static HashMap* _requestedChunks;
+static double _requestedChunksResetTime = 0;
+static JobSystem* _updateJobs = NULL;
+static Job _windowJob;
+static Job _publishJob;
+static int _windowJobActive = 0;
+static int _planEdited = 0;
 
 static inline void drawVector(Vector position, Vector vector, Color lineColor, Color endColor) {
 	if (vectorGetLengthSq(vector) < 0.001) {
@@ -60,118 +127,730 @@ static inline void drawVector(Vector position, Vector vector, Color lineColor, C
 	renderCube(sum, vectorCreate(endSize, endSize, endSize), endColor);
 }
 
-int initMagneticField() {
-	_conductors = arrayNew(1);
-	_fieldPoints = arrayNew(2048);
+static inline void drawLine(Vector from, Vector to, Color color) {
+	glColor3f(color.r, color.g, color.b);
+	glBegin(GL_LINES);
+		glVertex3d(from.x, from.y, from.z);
+		glVertex3d(to.x, to.y, to.z);
+	glEnd();
+}
+
+static void renderFieldSources(const FieldSourceSet* sources) {
+	static const Vector markerSize = { 0.3, 0.3, 0.3 };
+	const Conductor* elements = (const Conductor*) sources->sources[FIELD_SOURCE_ELEMENT];
+	const FieldSegment* segments = (const FieldSegment*) sources->sources[FIELD_SOURCE_SEGMENT];
+	const FieldLoop* loops = (const FieldLoop*) sources->sources[FIELD_SOURCE_LOOP];
+	const FieldDipole* dipoles = (const FieldDipole*) sources->sources[FIELD_SOURCE_DIPOLE];
+	const FieldCharge* charges = (const FieldCharge*) sources->sources[FIELD_SOURCE_CHARGE];
+	size_t i, j;
+	for (i = 0; i < sources->counts[FIELD_SOURCE_ELEMENT]; ++i) {
+		renderParallelepiped(elements[i].position, vectorSum(elements[i].position, elements[i].l), colorBlue);
+	}
+	for (i = 0; i < sources->counts[FIELD_SOURCE_SEGMENT]; ++i) {
+		drawLine(segments[i].start, segments[i].end, colorBlue);
+	}
+	for (i = 0; i < sources->counts[FIELD_SOURCE_LOOP]; ++i) {
+		const Vector normal = vectorNormalize(loops[i].normal);
+		const Vector helper = fabs(normal.x) < 0.9 ? vectorCreate(1, 0, 0) : vectorCreate(0, 1, 0);
+		const Vector u = vectorMultiply(vectorNormalize(vectorCrossProduct(normal, helper)), loops[i].radius);
+		const Vector v = vectorCrossProduct(normal, u);
+		glColor3f(colorBlue.r, colorBlue.g, colorBlue.b);
+		glBegin(GL_LINE_LOOP);
+		for (j = 0; j < 48; ++j) {
+			const double angle = 2 * M_PI * j / 48;
+			const Vector p = vectorSum(loops[i].center, vectorSum(vectorMultiply(u, cos(angle)), vectorMultiply(v, sin(angle))));
+			glVertex3d(p.x, p.y, p.z);
+		}
+		glEnd();
+	}
+	for (i = 0; i < sources->counts[FIELD_SOURCE_DIPOLE]; ++i) {
+		renderCube(dipoles[i].position, markerSize, colorBlue);
+		drawLine(dipoles[i].position, vectorSum(dipoles[i].position, vectorNormalize(dipoles[i].moment)), colorRed);
+	}
+	for (i = 0; i < sources->counts[FIELD_SOURCE_CHARGE]; ++i) {
+		renderCube(charges[i].position, markerSize, colorYellow);
+		drawLine(charges[i].position, vectorSum(charges[i].position, charges[i].velocity), colorYellow);
+	}
+}
+
+static inline int getCellChunk(double cell) {
+	return fieldChunkFloorDiv((int) cell, FIELD_CHUNK_SIZE);
+}
+
+// world position of the cell at index in the chunk with the Morton code
+static inline void getChunkCellPosition(uint64_t code, unsigned int index, int* x, int* y, int* z) {
+	int chunkX, chunkY, chunkZ;
+	mortonDecode(code, &chunkX, &chunkY, &chunkZ);
+	*x = (chunkX * FIELD_CHUNK_SIZE + (int) index / (FIELD_CHUNK_SIZE * FIELD_CHUNK_SIZE)) * FIELD_CELL_STEP;
+	*y = (chunkY * FIELD_CHUNK_SIZE + (int) index / FIELD_CHUNK_SIZE % FIELD_CHUNK_SIZE) * FIELD_CELL_STEP;
+	*z = (chunkZ * FIELD_CHUNK_SIZE + (int) index % FIELD_CHUNK_SIZE) * FIELD_CELL_STEP;
+}
+
+static inline int countChunkPoints(const FieldPointChunk* chunk) {
+	uint64_t mask = chunk->mask;
+	int result = 0;
+	for (; mask; mask &= mask - 1) {
+		++result;
+	}
+	return result;
+}
+
+// the chunk of the cell and the index of the cell in it, an empty chunk is appended when create is set and there is
+// none; must be called with _fieldPointsMutex locked
+static FieldPointChunk* findFieldPointChunk(int cellX, int cellY, int cellZ, unsigned int* index, int create) {
+	int chunkX, chunkY, chunkZ;
+	fieldChunkFromKey(fieldChunkLocate(cellX, cellY, cellZ, index), &chunkX, &chunkY, &chunkZ);
+	const size_t found = mortonArrayFind(_fieldPoints, chunkX, chunkY, chunkZ);
+	if (found < mortonArrayGetLength(_fieldPoints)) {
+		return (FieldPointChunk*) mortonArrayGetAt(_fieldPoints, found);
+	}
+	if (!create) {
+		return NULL;
+	}
+	FieldPointChunk* chunk = (FieldPointChunk*) mortonArrayAppend(_fieldPoints, chunkX, chunkY, chunkZ);
+	if (chunk) {
+		memset(chunk, 0, sizeof(FieldPointChunk));
+	}
+	return chunk;
+}
+
+// must be called with _fieldPointsMutex locked
+static void updateSceneHash() {
+	_sceneHash = fieldSceneGetChunkHash(_scene);
+}
+
+// unpacks every point, adds the difference the edit makes and packs it again so the edit shows at once; the sum carries
+// the packing error of the old value, which stays within twice the sample bounds of the new one unless the edit weakens
+// the point further, so only those points are marked stale for the next plan; must be called with _fieldPointsMutex locked
+static void applySourceDelta(const FieldSource* oldSource, const FieldSource* newSource) {
+	const size_t chunkCount = mortonArrayGetLength(_fieldPoints);
+	size_t i, count = 0;
+	unsigned int index;
+	int x, y, z;
+	if (_fieldPointCount > _deltaCapacity) {
+		_deltaCapacity = _fieldPointCount;
+		_deltaPositions = (Vector*) memoryRealloc(MEMORY_TAG_FIELD_POINTS, _deltaPositions, sizeof(Vector) * _deltaCapacity);
+		_deltaDirections = (Vector*) memoryRealloc(MEMORY_TAG_FIELD_POINTS, _deltaDirections, sizeof(Vector) * _deltaCapacity);
+	}
+	for (i = 0; i < chunkCount; ++i) {
+		const FieldPointChunk* chunk = (const FieldPointChunk*) mortonArrayGetAt(_fieldPoints, i);
+		for (index = 0; index < FIELD_CHUNK_CELLS; ++index) {
+			if (chunk->mask & (1ULL << index)) {
+				getChunkCellPosition(mortonArrayGetCode(_fieldPoints, i), index, &x, &y, &z);
+				_deltaPositions[count] = vectorCreate(x, y, z);
+				_deltaDirections[count++] = fieldSampleUnpack(chunk->samples[index]);
+			}
+		}
+	}
+	fieldSourceEvaluate(oldSource, -1, _deltaPositions, _deltaDirections, count);
+	fieldSourceEvaluate(newSource, 1, _deltaPositions, _deltaDirections, count);
+	for (i = 0, count = 0; i < chunkCount; ++i) {
+		FieldPointChunk* chunk = (FieldPointChunk*) mortonArrayGetAt(_fieldPoints, i);
+		for (index = 0; index < FIELD_CHUNK_CELLS; ++index) {
+			if (chunk->mask & (1ULL << index)) {
+				const double oldLengthSq = vectorGetLengthSq(fieldSampleUnpack(chunk->samples[index]));
+				const double newLengthSq = vectorGetLengthSq(_deltaDirections[count]);
+				if (oldLengthSq > FIELD_DELTA_MAX_SHRINK * FIELD_DELTA_MAX_SHRINK * newLengthSq) {
+					chunk->stale |= 1ULL << index;
+					_planEdited = 1;
+				}
+				chunk->samples[index] = fieldSamplePack(_deltaDirections[count++]);
+			}
+		}
+	}
+	updateSceneHash();
+	++_fieldGeneration;
+}
+
+size_t addMagneticFieldSource(FieldSource source) {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	const size_t index = fieldSceneAddSource(_scene, &source);
+	applySourceDelta(NULL, &source);
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return index;
+}
+
+int updateMagneticFieldSource(size_t index, FieldSource source) {
+	FieldSource previous;
+	pthread_mutex_lock(&_fieldPointsMutex);
+	// the scene hash is taken from the stored sources, so they must be up to date first
+	if (!fieldSceneUpdateSource(_scene, index, &source, &previous)) {
+		pthread_mutex_unlock(&_fieldPointsMutex);
+		return 0;
+	}
+	applySourceDelta(&previous, &source);
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return 1;
+}
+
+int removeMagneticFieldSource(FieldSourceType type, size_t index) {
+	FieldSource previous;
+	pthread_mutex_lock(&_fieldPointsMutex);
+	if (!fieldSceneRemoveSource(_scene, type, index, &previous)) {
+		pthread_mutex_unlock(&_fieldPointsMutex);
+		return 0;
+	}
+	applySourceDelta(&previous, NULL);
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return 1;
+}
+
+int getMagneticFieldSource(FieldSourceType type, size_t index, FieldSource* result) {
+	return fieldSceneGetSource(_scene, type, index, result);
+}
+
+size_t getMagneticFieldSourceCount(FieldSourceType type) {
+	return fieldSceneGetSourceCount(_scene, type);
+}
+
+FieldSourceSet* copyMagneticFieldSources() {
+	return fieldSceneCopySources(_scene);
+}
+
+size_t addMagneticFieldConductor(Conductor conductor) {
+	FieldSource source = { .type = FIELD_SOURCE_ELEMENT };
+	source.element = conductor;
+	return addMagneticFieldSource(source);
+}
+
+int updateMagneticFieldConductor(size_t index, Conductor conductor) {
+	FieldSource source = { .type = FIELD_SOURCE_ELEMENT };
+	source.element = conductor;
+	return updateMagneticFieldSource(index, source);
+}
+
+int removeMagneticFieldConductor(size_t index) {
+	return removeMagneticFieldSource(FIELD_SOURCE_ELEMENT, index);
+}
+
+int getMagneticFieldConductor(size_t index, Conductor* result) {
+	FieldSource source;
+	if (!getMagneticFieldSource(FIELD_SOURCE_ELEMENT, index, &source)) {
+		return 0;
+	}
+	*result = source.element;
+	return 1;
+}
+
+size_t getMagneticFieldConductorCount() {
+	return getMagneticFieldSourceCount(FIELD_SOURCE_ELEMENT);
+}
+
+size_t getMagneticFieldPointCount() {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	const size_t result = _fieldPointCount;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return result;
+}
+
+unsigned long getMagneticFieldGeneration() {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	const unsigned long result = _fieldGeneration;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return result;
+}
+
+int initMagneticFieldScene(const char* scenePath) {
+	_scene = fieldSceneNew();
+	if (!_scene) {
+		return 0;
+	}
+	// the kernel generated for the build's scene file runs while the scene matches it, edits fall back to the generic ones
+	fieldSceneSetSpecialization(_scene, sceneKernelGetSpecialization());
+	if (scenePath) {
+		if (fieldSceneLoadFile(_scene, scenePath) < 0) {
+			return 0;
+		}
+	} else {
+		fieldSceneAddDefaultSources(_scene);
+	}
+	_fieldPoints = mortonArrayNew(MEMORY_TAG_FIELD_POINTS, sizeof(FieldPointChunk), 64);
+	_pendingCells = queueNew(2048);
+	_waitingCells = arrayNew(256);
+	_requestedChunks = mapNew(256);
+	_updateJobs = jobSystemNew(0);
 	pthread_mutex_init(&_fieldPointsMutex, NULL);
 
-	Conductor* conductor1 = (Conductor*) malloc(sizeof(Conductor));
-	conductor1->position = (Vector) { 12, -12, -12 };
-	conductor1->I = 6000;
-	conductor1->permeability = 2.5 * 1.0e-1;
-	conductor1->l = (Vector) { 4, 0.6, 0.6 };
-	arrayAppend(_conductors, conductor1);
-
-	Conductor* conductor2 = (Conductor*) malloc(sizeof(Conductor));
-	conductor2->position = (Vector) { 12, 12, -12 };
-	conductor2->I = 3000;
-	conductor2->permeability = 2.5 * 1.0e-1;
-	conductor2->l = (Vector) { 4, 0.4, 0.4 };
-	arrayAppend(_conductors, conductor2);
-
-	Conductor* conductor3 = (Conductor*) malloc(sizeof(Conductor));
-	conductor3->position = (Vector) { 12, 12, 12 };
-	conductor3->I = 9000;
-	conductor3->permeability = 2.5 * 1.0e-1;
-	conductor3->l = (Vector) { 4, 0.9, 0.9 };
-	arrayAppend(_conductors, conductor3);
-
-	Conductor* conductor4 = (Conductor*) malloc(sizeof(Conductor));
-	conductor4->position = (Vector) { 12, -12, 12 };
-	conductor4->I = 1000;
-	conductor4->permeability = 2.5 * 1.0e-1;
-	conductor4->l = (Vector) { 4, 0.3, 0.3 };
-	arrayAppend(_conductors, conductor4);
+	pthread_mutex_lock(&_fieldPointsMutex);
+	updateSceneHash();
+	++_fieldGeneration;
+	pthread_mutex_unlock(&_fieldPointsMutex);
 
 	return 1;
 }
 
-void updateMagneticField(const RenderContext* context) {
-	static const Vector minCellPosRel = { -48, -48, -48 };
-	static const Vector maxCellPosRel = { 48, 48, 48 };
-	static const int cellStep = 8;
-	Vector minCellPos = vectorSum(context->camera.position, minCellPosRel);
-	Vector maxCellPos = vectorSum(context->camera.position, maxCellPosRel);
-	size_t i, count;
+static int fieldPointExists(int x, int y, int z) {
+	unsigned int index;
+	pthread_mutex_lock(&_fieldPointsMutex);
+	const FieldPointChunk* chunk = findFieldPointChunk(x / FIELD_CELL_STEP, y / FIELD_CELL_STEP, z / FIELD_CELL_STEP, &index, 0);
+	const int result = chunk && (chunk->mask & ~chunk->stale & (1ULL << index));
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return result;
+}
 
-	// remove points which is too far from camera
-	for (i = 0, count = arrayGetLength(_fieldPoints); i < count; ++i) {
-		pthread_mutex_lock(&_fieldPointsMutex);
-		VectorFieldPoint* point = (VectorFieldPoint*) arrayGetAt(_fieldPoints, i);
-		if (point->position.x < minCellPos.x + minCellPosRel.x || point->position.x > maxCellPos.x + maxCellPosRel.x ||
-			point->position.y < minCellPos.y + minCellPosRel.y || point->position.y > maxCellPos.y + maxCellPosRel.y ||
-			point->position.z < minCellPos.z + minCellPosRel.z || point->position.z > maxCellPos.z + maxCellPosRel.z) {
-			arrayDestroy(_fieldPoints, i);
-			--i;
-			--count;
+// samples served by the daemon, returns 0 while the chunk is still being computed there
+static int readSharedFieldPoint(int cellX, int cellY, int cellZ, Vector* result) {
+	if (sharedFieldRead(_sharedField, cellX, cellY, cellZ, result)) {
+		return 1;
+	}
+	unsigned int index;
+	const uint64_t chunkKey = fieldChunkLocate(cellX, cellY, cellZ, &index);
+	const double now = getTimeDetailed();
+	if (now - _requestedChunksResetTime > FIELD_REQUEST_INTERVAL) {
+		mapRemoveAll(_requestedChunks);
+		_requestedChunksResetTime = now;
+	}
+	if (!mapContains(_requestedChunks, chunkKey) && sharedFieldRequest(_sharedField, chunkKey)) {
+		mapPut(_requestedChunks, chunkKey, _requestedChunks);
+	}
+	return 0;
+}
+
+static int computeFieldPoint(Vector position) {
+	Vector direction = vectorZero;
+
+	// sources can be edited meanwhile so hold the lock
+	const int cellX = (int) position.x / FIELD_CELL_STEP;
+	const int cellY = (int) position.y / FIELD_CELL_STEP;
+	const int cellZ = (int) position.z / FIELD_CELL_STEP;
+	pthread_mutex_lock(&_fieldPointsMutex);
+	if (_sharedField && _sharedField->header->sceneHash == _sceneHash && sharedFieldIsAlive(_sharedField)) {
+		if (!readSharedFieldPoint(cellX, cellY, cellZ, &direction)) {
+			pthread_mutex_unlock(&_fieldPointsMutex);
+			return 0;
 		}
-		pthread_mutex_unlock(&_fieldPointsMutex);
+	} else if (!fieldCacheLookup(_fieldCache, _sceneHash, cellX, cellY, cellZ, &direction)) {
+		fieldSceneEvaluate(_scene, &position, &direction, 1);
+		fieldCacheStore(_fieldCache, _sceneHash, cellX, cellY, cellZ, direction);
+	}
+	// a new chunk is appended out of order, the next update merges it in
+	unsigned int index;
+	FieldPointChunk* chunk = findFieldPointChunk(cellX, cellY, cellZ, &index, 1);
+	if (chunk && !(chunk->mask & (1ULL << index))) {
+		chunk->mask |= 1ULL << index;
+		chunk->samples[index] = fieldSamplePack(direction);
+		++_fieldPointCount;
+	} else if (chunk && (chunk->stale & (1ULL << index))) {
+		chunk->stale &= ~(1ULL << index);
+		chunk->samples[index] = fieldSamplePack(direction);
 	}
+	++_fieldGeneration;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return 1;
+}
 
-	// compute points
-	int x, y, z;
-	for (x = (int) (minCellPos.x / cellStep) * cellStep; x <= maxCellPos.x; x += cellStep) {
-		for (y = (int) (minCellPos.y / cellStep) * cellStep; y <= maxCellPos.y; y += cellStep) {
-			for (z = (int) (minCellPos.z / cellStep) * cellStep; z <= maxCellPos.z; z += cellStep) {
-				const Vector position = { x, y, z };
-
-				// try to find
-				int pointExists = 0;
-				for (i = 0, count = arrayGetLength(_fieldPoints); i < count; ++i) {
-					pthread_mutex_lock(&_fieldPointsMutex);
-					VectorFieldPoint* point = (VectorFieldPoint*) arrayGetAt(_fieldPoints, i);
-					if (point->position.x >= x && point->position.x <= x + cellStep &&
-						point->position.y >= y && point->position.y <= y + cellStep &&
-						point->position.z >= z && point->position.z <= z + cellStep) {
-						pointExists = 1;
-						pthread_mutex_unlock(&_fieldPointsMutex);
-						break;
+int initMagneticField() {
+	return initMagneticFieldScene(NULL);
+}
+
+const char* getMagneticFieldKernelName() {
+	const char* name = fieldSceneGetSpecialization(_scene);
+	return name ? name : "generic";
+}
+
+uint64_t getMagneticFieldSceneHash() {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	const uint64_t result = _sceneHash;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return result;
+}
+
+// lower is sooner: cells inside the view cone ordered by distance, everything else after them; an orthographic view sees
+// its whole window
+static double getCellPriority(const FieldView* view, int x, int y, int z) {
+	const Vector toCell = vectorSubstract(vectorCreate(x, y, z), view->focus);
+	const double distance = vectorGetLength(toCell);
+	if (!view->perspective || distance < FIELD_CELL_STEP || vectorDotProduct(toCell, view->direction) >= view->cosHalfFov * distance) {
+		return distance;
+	}
+	return distance + FIELD_INVISIBLE_PENALTY;
+}
+
+static inline int isInViewWindow(const FieldView* view, int x, int y, int z) {
+	return x >= view->from[0] && x <= view->to[0] && y >= view->from[1] && y <= view->to[1] && z >= view->from[2] && z <= view->to[2];
+}
+
+// drops stale requests and queues every missing cell of the windows once, ordered by the view that wants it soonest
+static void reprioritizePendingCells(const FieldView* views, int viewCount) {
+	int i, j, x, y, z;
+
+	queueDestroyAll(_pendingCells);
+	arrayDestroyAll(_waitingCells);
+	for (i = 0; i < viewCount; ++i) {
+		const FieldView* view = &views[i];
+		for (x = view->from[0]; x <= view->to[0]; x += FIELD_CELL_STEP) {
+			for (y = view->from[1]; y <= view->to[1]; y += FIELD_CELL_STEP) {
+				for (z = view->from[2]; z <= view->to[2]; z += FIELD_CELL_STEP) {
+					for (j = 0; j < i && !isInViewWindow(&views[j], x, y, z); ++j);
+					if (j < i || fieldPointExists(x, y, z)) {
+						continue;
 					}
-					pthread_mutex_unlock(&_fieldPointsMutex);
+					double priority = getCellPriority(view, x, y, z);
+					for (j = i + 1; j < viewCount; ++j) {
+						if (isInViewWindow(&views[j], x, y, z)) {
+							priority = min(priority, getCellPriority(&views[j], x, y, z));
+						}
+					}
+					PendingCell* cell = (PendingCell*) malloc(sizeof(PendingCell));
+					cell->x = x;
+					cell->y = y;
+					cell->z = z;
+					cell->priority = priority;
+					queuePush(_pendingCells, cell, cell->priority);
 				}
-				if (pointExists) {
+			}
+		}
+	}
+}
+
+// the index of the first window holding the code, count when none does
+static inline int findWindow(uint64_t code, const uint64_t* minCodes, const uint64_t* maxCodes, int count) {
+	int i;
+	for (i = 0; i < count && !mortonContains(code, minCodes[i], maxCodes[i]); ++i);
+	return i;
+}
+
+// the point is drawn for the first planned window which holds it
+static inline int isInPlannedWindow(int window, int x, int y, int z) {
+	int i;
+	for (i = 0; i < window && !isInViewWindow(&_plannedViews[i], x, y, z); ++i);
+	return i == window && isInViewWindow(&_plannedViews[window], x, y, z);
+}
+
+static inline StreamVertex* writeStreamVertex(StreamVertex* vertex, Vector position, Color color) {
+	vertex->x = (float) position.x;
+	vertex->y = (float) position.y;
+	vertex->z = (float) position.z;
+	vertex->r = color.r;
+	vertex->g = color.g;
+	vertex->b = color.b;
+	return vertex + 1;
+}
+
+// writes ready-to-draw line vertices of the current field into the render stream
+static void publishFieldVertices() {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	if (!_fieldStream || (_published && _publishedGeneration == _fieldGeneration)) {
+		pthread_mutex_unlock(&_fieldPointsMutex);
+		return;
+	}
+	int slot;
+	StreamVertex* vertices = vertexStreamBeginWrite(_fieldStream, &slot);
+	if (!vertices) {
+		pthread_mutex_unlock(&_fieldPointsMutex);
+		return;
+	}
+	StreamVertex* vertex = vertices;
+	StreamVertex* const end = vertices + _fieldStream->slotCapacity;
+	const size_t count = mortonArrayGetLength(_fieldPoints);
+	size_t i;
+	unsigned int index;
+	int window, x, y, z;
+	// only the planned windows are drawn, the chunks of each walked in storage order; points kept around them for a
+	// camera coming back are skipped, and so are points an earlier window has written already
+	for (window = 0; window < _plannedViewCount; ++window) {
+		for (i = mortonArrayNextInBox(_fieldPoints, 0, _windowMinCodes[window], _windowMaxCodes[window]); i < count;
+				i = mortonArrayNextInBox(_fieldPoints, i + 1, _windowMinCodes[window], _windowMaxCodes[window])) {
+			const FieldPointChunk* chunk = (const FieldPointChunk*) mortonArrayGetAt(_fieldPoints, i);
+			for (index = 0; index < FIELD_CHUNK_CELLS && vertex + 2 <= end; ++index) {
+				if (!(chunk->mask & (1ULL << index))) {
 					continue;
 				}
-
-				// compute if not exist
-				VectorFieldPoint* result = (VectorFieldPoint*) malloc(sizeof(VectorFieldPoint));
-				result->position = position;
-				result->direction = vectorZero;
-				for (i = 0, count = arrayGetLength(_conductors); i < count; ++i) {
-					Conductor* conductor = (Conductor*) arrayGetAt(_conductors, i);
-					result->direction = vectorSum(
-						result->direction,
-						calculateMagneticFieldPoint(conductor->I, conductor->permeability, conductor->l, vectorSubstract(position, conductor->position))
-					);
+				getChunkCellPosition(mortonArrayGetCode(_fieldPoints, i), index, &x, &y, &z);
+				const Vector direction = fieldSampleUnpack(chunk->samples[index]);
+				if (vectorGetLengthSq(direction) < 0.001 || !isInPlannedWindow(window, x, y, z)) {
+					continue;
 				}
-				pthread_mutex_lock(&_fieldPointsMutex);
-				arrayAppend(_fieldPoints, result);
-				pthread_mutex_unlock(&_fieldPointsMutex);
+				const Vector position = vectorCreate(x, y, z);
+				vertex = writeStreamVertex(vertex, position, colorWhite);
+				vertex = writeStreamVertex(vertex, vectorSum(position, direction), colorRed);
 			}
 		}
 	}
+	vertexStreamEndWrite(_fieldStream, slot, (size_t) (vertex - vertices));
+	_publishedGeneration = _fieldGeneration;
+	_published = 1;
+	pthread_mutex_unlock(&_fieldPointsMutex);
 }
 
-void renderMagneticField(const RenderContext* context) {
+static void setViewWindow(FieldView* view) {
+	view->from[0] = (int) ((view->focus.x - FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP) * FIELD_CELL_STEP;
+	view->from[1] = (int) ((view->focus.y - FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP) * FIELD_CELL_STEP;
+	view->from[2] = (int) ((view->focus.z - FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP) * FIELD_CELL_STEP;
+	view->to[0] = (int) (view->focus.x + FIELD_WINDOW_RADIUS);
+	view->to[1] = (int) (view->focus.y + FIELD_WINDOW_RADIUS);
+	view->to[2] = (int) (view->focus.z + FIELD_WINDOW_RADIUS);
+}
+
+static double getCosHalfFov(double aspect) {
+	const double tanHalfFov = tan(M_PI / 6);
+	return cos(atan(tanHalfFov * sqrt(1 + aspect * aspect)));
+}
+
+// one view per viewport, or the camera alone; orthographic views showing the same window are planned once
+static int getFieldViews(const RenderContext* context, FieldView* views) {
+	int count = 0, i, j;
+	if (!context->viewportCount) {
+		views[0].focus = context->camera.position;
+		views[0].direction = vectorNormalize(context->camera.direction);
+		views[0].perspective = 1;
+		views[0].cosHalfFov = getCosHalfFov(context->windowSize.y > 0 ? context->windowSize.x / context->windowSize.y : 1);
+		setViewWindow(&views[0]);
+		return 1;
+	}
+	for (i = 0; i < context->viewportCount && i < RENDER_MAX_VIEWPORTS; ++i) {
+		const Viewport* viewport = &context->viewports[i];
+		FieldView* view = &views[count];
+		view->focus = viewport->focus;
+		view->direction = vectorNormalize(viewport->camera.direction);
+		view->perspective = viewport->orthographicExtent == 0;
+		view->cosHalfFov = getCosHalfFov(viewport->size.y > 0 ? viewport->size.x / viewport->size.y : 1);
+		setViewWindow(view);
+		for (j = 0; j < count && (view->perspective || views[j].perspective || memcmp(view->from, views[j].from, sizeof(view->from))); ++j);
+		if (j == count) {
+			++count;
+		}
+	}
+	return count;
+}
+
+static int isPlanStale(const FieldView* views, int viewCount) {
+	int i;
+	if (viewCount != _plannedViewCount) {
+		return 1;
+	}
+	for (i = 0; i < viewCount; ++i) {
+		const FieldView* planned = &_plannedViews[i];
+		if (memcmp(views[i].from, planned->from, sizeof(planned->from)) || views[i].perspective != planned->perspective ||
+				(views[i].perspective && vectorDotProduct(views[i].direction, planned->direction) < FIELD_REPRIORITIZE_COS)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void invalidateMagneticFieldUpdate(const RenderContext* context) {
+	FieldView views[RENDER_MAX_VIEWPORTS];
+	const int viewCount = getFieldViews(context, views);
+	pthread_mutex_lock(&_fieldPointsMutex);
+	const int stale = _windowJobActive && isPlanStale(views, viewCount);
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	if (stale) {
+		jobSystemAdvance(_updateJobs);
+	}
+}
+
+static size_t computeWindowChunk(Job* job) {
+	size_t done;
+	for (done = 0; done < FIELD_UPDATE_CHUNK && queueGetLength(_pendingCells); ++done) {
+		PendingCell* cell = (PendingCell*) queuePop(_pendingCells);
+		if (!fieldPointExists(cell->x, cell->y, cell->z) && !computeFieldPoint(vectorCreate(cell->x, cell->y, cell->z))) {
+			arrayAppend(_waitingCells, cell);
+			continue;
+		}
+		free(cell);
+	}
+	return done ? done : job->pendingWork;
+}
+
+static size_t publishWindow(Job* job) {
+	publishFieldVertices();
+	return 1;
+}
+
+static void releaseWindowJob(Job* job, int cancelled) {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	_windowJobActive = 0;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+}
+
+// the window is computed chunk by chunk and published once complete, a newer context cancels both
+static void submitWindowJob() {
+	_publishJob = (Job) { publishWindow, NULL, NULL, 1, 0, NULL, NULL };
+	_windowJob = (Job) { computeWindowChunk, releaseWindowJob, NULL, queueGetLength(_pendingCells), 0, &_publishJob, NULL };
+	pthread_mutex_lock(&_fieldPointsMutex);
+	_windowJobActive = 1;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	jobSystemSubmit(_updateJobs, &_windowJob);
+}
+
+int updateMagneticField(const RenderContext* context) {
+	const double startTime = getTimeDetailed();
+	const double deadline = startTime + context->updateBudget;
+	FieldView views[RENDER_MAX_VIEWPORTS];
+	uint64_t keepMinCodes[RENDER_MAX_VIEWPORTS];
+	uint64_t keepMaxCodes[RENDER_MAX_VIEWPORTS];
+	const int viewCount = getFieldViews(context, views);
 	size_t i, count;
+	int view;
+
+	// remove chunks which are too far from every view, then merge the chunks added since the last sort into Morton order
+	for (view = 0; view < viewCount; ++view) {
+		const Vector focus = views[view].focus;
+		keepMinCodes[view] = mortonEncode(
+			getCellChunk(ceil((focus.x - 2 * FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP)),
+			getCellChunk(ceil((focus.y - 2 * FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP)),
+			getCellChunk(ceil((focus.z - 2 * FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP))
+		);
+		keepMaxCodes[view] = mortonEncode(
+			getCellChunk(floor((focus.x + 2 * FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP)),
+			getCellChunk(floor((focus.y + 2 * FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP)),
+			getCellChunk(floor((focus.z + 2 * FIELD_WINDOW_RADIUS) / FIELD_CELL_STEP))
+		);
+	}
 	pthread_mutex_lock(&_fieldPointsMutex);
-	for (i = 0, count = arrayGetLength(_fieldPoints); i < count; ++i) {
-		VectorFieldPoint* point = (VectorFieldPoint*) arrayGetAt(_fieldPoints, i);
-		drawVector(point->position, point->direction, colorWhite, colorRed);
+	for (i = 0, count = mortonArrayGetLength(_fieldPoints); i < count; ++i) {
+		if (findWindow(mortonArrayGetCode(_fieldPoints, i), keepMinCodes, keepMaxCodes, viewCount) == viewCount) {
+			_fieldPointCount -= countChunkPoints((const FieldPointChunk*) mortonArrayGetAt(_fieldPoints, i));
+		}
+	}
+	if (mortonArrayRetain(_fieldPoints, keepMinCodes, keepMaxCodes, (size_t) viewCount)) {
+		++_fieldGeneration;
+	}
+	if (mortonArrayNeedsSort(_fieldPoints)) {
+		mortonArraySort(_fieldPoints);
+	}
+	pthread_mutex_unlock(&_fieldPointsMutex);
+
+	// plan the windows again when one has moved to another cell, a camera has turned, the viewports have changed, an edit
+	// has left stale points, or the last plan was cancelled or left cells waiting for the daemon
+	pthread_mutex_lock(&_fieldPointsMutex);
+	const int replan = isPlanStale(views, viewCount) || _planEdited ||
+		(!_windowJobActive && (queueGetLength(_pendingCells) || arrayGetLength(_waitingCells)));
+	if (replan) {
+		_planEdited = 0;
+		for (view = 0; view < viewCount; ++view) {
+			const FieldView* planned = &views[view];
+			_plannedViews[view] = *planned;
+			_windowMinCodes[view] = mortonEncode(
+				getCellChunk(planned->from[0] / FIELD_CELL_STEP),
+				getCellChunk(planned->from[1] / FIELD_CELL_STEP),
+				getCellChunk(planned->from[2] / FIELD_CELL_STEP)
+			);
+			_windowMaxCodes[view] = mortonEncode(
+				getCellChunk(floor((double) planned->to[0] / FIELD_CELL_STEP)),
+				getCellChunk(floor((double) planned->to[1] / FIELD_CELL_STEP)),
+				getCellChunk(floor((double) planned->to[2] / FIELD_CELL_STEP))
+			);
+		}
+		_plannedViewCount = viewCount;
+	}
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	if (replan) {
+		// whatever is queued for an older plan is dropped before it runs
+		jobSystemAdvance(_updateJobs);
+		jobSystemRun(_updateJobs, 0);
+		reprioritizePendingCells(views, viewCount);
+		if (queueGetLength(_pendingCells)) {
+			submitWindowJob();
+		}
 	}
+
+	// compute the most visible points until the budget is spent or a newer context makes them stale
+	jobSystemRun(_updateJobs, deadline);
+
+	publishFieldVertices();
+
+	// report the tick
+	const float duration = (float) (getTimeDetailed() - startTime);
+	pthread_mutex_lock(&_fieldPointsMutex);
+	++_updateStats.ticks;
+	_updateStats.lastDuration = duration;
+	_updateStats.pendingCells = queueGetLength(_pendingCells) + arrayGetLength(_waitingCells);
+	const JobSystemStats jobStats = jobSystemGetStats(_updateJobs);
+	_updateStats.computedCells = jobStats.workDone;
+	_updateStats.cancelledCells = jobStats.workCancelled;
+	_updateStats.staleCells = jobStats.workStale;
+	if (duration > context->updateBudget) {
+		++_updateStats.overruns;
+		_updateStats.maxOverrun = max(_updateStats.maxOverrun, duration - context->updateBudget);
+	}
+	_updateStats.daemonAttached = _sharedField && _sharedField->header->sceneHash == _sceneHash && sharedFieldIsAlive(_sharedField);
+	if (_fieldCache) {
+		_updateStats.cacheHits = _fieldCache->hits;
+		_updateStats.cacheMisses = _fieldCache->misses;
+		if (startTime - _lastCacheSyncTime > FIELD_CACHE_SYNC_INTERVAL) {
+			fieldCacheSync(_fieldCache);
+			_lastCacheSyncTime = startTime;
+		}
+	}
+	pthread_mutex_unlock(&_fieldPointsMutex);
+
+	return !queueGetLength(_pendingCells) && !arrayGetLength(_waitingCells);
+}
+
+int openMagneticFieldCache(const char* path, size_t maxBytes) {
+	FieldCache* cache = fieldCacheOpen(path, maxBytes);
+	pthread_mutex_lock(&_fieldPointsMutex);
+	fieldCacheClose(_fieldCache);
+	_fieldCache = cache;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return cache != NULL;
+}
+
+void closeMagneticFieldCache() {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	fieldCacheClose(_fieldCache);
+	_fieldCache = NULL;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+}
+
+int attachMagneticFieldDaemon() {
+	SharedField* field = sharedFieldAttach(getMagneticFieldSceneHash());
+	pthread_mutex_lock(&_fieldPointsMutex);
+	sharedFieldClose(_sharedField);
+	_sharedField = field;
 	pthread_mutex_unlock(&_fieldPointsMutex);
-	for (i = 0, count = arrayGetLength(_conductors); i < count; ++i) {
-		Conductor* conductor = (Conductor*) arrayGetAt(_conductors, i);
-		renderParallelepiped(conductor->position, vectorSum(conductor->position, conductor->l), colorBlue);
+	return field != NULL;
+}
+
+void detachMagneticFieldDaemon() {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	sharedFieldClose(_sharedField);
+	_sharedField = NULL;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+}
+
+MagneticFieldUpdateStats getMagneticFieldUpdateStats() {
+	pthread_mutex_lock(&_fieldPointsMutex);
+	const MagneticFieldUpdateStats result = _updateStats;
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	return result;
+}
+
+void renderMagneticField(const RenderContext* context) {
+	size_t i, count;
+	unsigned int index;
+	int window, x, y, z;
+	if (!_fieldStreamChecked) {
+		VertexStream* stream = vertexStreamNew(FIELD_STREAM_MAX_POINTS * 2);
+		pthread_mutex_lock(&_fieldPointsMutex);
+		_fieldStream = stream;
+		pthread_mutex_unlock(&_fieldPointsMutex);
+		_fieldStreamChecked = 1;
+	}
+
+	// the update thread has already written the vertices, without buffer storage fall back to immediate mode
+	if (_fieldStream) {
+		vertexStreamDraw(_fieldStream, GL_LINES);
+		pthread_mutex_lock(&_fieldPointsMutex);
+	} else {
+		pthread_mutex_lock(&_fieldPointsMutex);
+		for (window = 0, count = mortonArrayGetLength(_fieldPoints); window < _plannedViewCount; ++window) {
+			for (i = mortonArrayNextInBox(_fieldPoints, 0, _windowMinCodes[window], _windowMaxCodes[window]); i < count;
+					i = mortonArrayNextInBox(_fieldPoints, i + 1, _windowMinCodes[window], _windowMaxCodes[window])) {
+				const FieldPointChunk* chunk = (const FieldPointChunk*) mortonArrayGetAt(_fieldPoints, i);
+				for (index = 0; index < FIELD_CHUNK_CELLS; ++index) {
+					getChunkCellPosition(mortonArrayGetCode(_fieldPoints, i), index, &x, &y, &z);
+					if ((chunk->mask & (1ULL << index)) && isInPlannedWindow(window, x, y, z)) {
+						drawVector(vectorCreate(x, y, z), fieldSampleUnpack(chunk->samples[index]), colorWhite, colorRed);
+					}
+				}
+			}
+		}
 	}
+	pthread_mutex_unlock(&_fieldPointsMutex);
+	FieldSourceSet* sources = fieldSceneCopySources(_scene);
+	renderFieldSources(sources);
+	fieldSourceSetFree(sources);
 }
@@ -22,24 +22,60 @@
 #include "test/graphics/RenderEngine.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <math.h>
 #include <pthread.h>
+#include <signal.h>
 
 #include <GL/glew.h>
 #include <GL/glut.h>
+#ifdef FREEGLUT
+#include <GL/freeglut_ext.h>
+#endif
 
 #include "test/graphics/RenderContext.h"
 #include "test/graphics/MagneticFieldRenderer.h"
+#include "test/graphics/VolumeRenderer.h"
+#include "test/graphics/IsosurfaceRenderer.h"
+#include "test/graphics/AdaptiveFieldRenderer.h"
+#include "test/graphics/SliceRenderer.h"
+#include "test/graphics/FrameCapture.h"
 #include "test/tools/TimeTools.h"
 #include "test/tools/RenderTools.h"
+#include "test/tools/ThreadPool.h"
+#include "test/tools/MemoryStats.h"
+#include "test/tools/LatencyTracker.h"
+#include "test/math/MathFunctions.h"
 
-#define MAX_FPS 60
-#define MAX_DELTA_MS 1000 / MAX_FPS
+#define DEFAULT_MAX_FPS 60
+#define DEFAULT_UPDATE_BUDGET 0.008
+#define DEFAULT_FIELD_CACHE_SIZE_MB 64
+#define DEFAULT_ISOSURFACE_LEVEL 1.0
+#define LATENCY_GRAPH_WIDTH 240
+#define LATENCY_GRAPH_HEIGHT 64
+#define MULTI_VIEW_EXTENT 48 // half the height the top and side views show, as much as the field window around them
+#define MULTI_VIEW_DISTANCE 64
+#define VIEW_DEPTH 128
+#define SLICE_PLACE_DISTANCE 16
+#define SLICE_MOVE_SPEED 0.5
+#define SLICE_ROTATE_SPEED 0.05
+#define ON_DEMAND_IDLE_MS 250 // how often an idle on-demand viewer looks for work it didn't start itself
+
+// why an on-demand viewer draws a frame
+#define REDRAW_INPUT 0x01 // a key or a new window size
+#define REDRAW_CAMERA 0x02
+#define REDRAW_FIELD 0x04 // new field points or an edited scene
+#define REDRAW_HUD 0x08
+#define REDRAW_WORK 0x10 // the field update has cells left
+#define REDRAW_CAPTURE 0x20
+#define REDRAW_REASON_COUNT 6
 
 static RenderContext _context = {
 	.updateDelta = 0.0000001,
 	.renderDelta = 0.0000001,
+	.updateBudget = DEFAULT_UPDATE_BUDGET,
 	.windowSize = { 0, 0, 0 },
 	.camera = {
 		.position = { -1, 0, -1 },
@@ -50,8 +86,96 @@ static double _lastUpdateDeltaUpdateTime = 0;
 static double _lastRenderDeltaUpdateTime = 0;
 static pthread_t _updateThread;
 static pthread_mutex_t _updateThreadMutex;
+static pthread_cond_t _updateThreadWake;
 static int _updateRequested = 0;
 static int _updateThreadRunning = 0;
+static int _fieldPending = 1; // the last update left cells, or a newer one is on its way
+static int _maxFps = DEFAULT_MAX_FPS;
+static char _fieldCachePath[1024] = "";
+static size_t _fieldCacheSize = (size_t) DEFAULT_FIELD_CACHE_SIZE_MB << 20;
+static int _attachDaemon = 1;
+static const char* _scenePath = NULL;
+static int _volumeMode = 0;
+static FieldSourceType _placeType = FIELD_SOURCE_ELEMENT;
+static int _isosurfaceMode = 0;
+static int _adaptiveMode = 0;
+static int _multiView = 0;
+static int _sliceMode = 0;
+static double _isosurfaceLevel = DEFAULT_ISOSURFACE_LEVEL;
+static ThreadPool* _pool = NULL;
+static MemoryStats _memoryStats;
+static volatile sig_atomic_t _memoryDumpRequested = 0;
+static LatencyTracker* _frameLatency = NULL;
+static LatencyTracker* _updateLatency = NULL;
+static const char* _latencyStatsPath = NULL;
+static FrameCapture* _capture = NULL;
+static int _captureRequested = 0;
+static const char* _capturePath = NULL;
+static char _captureName[64];
+static const char* const _redrawReasonNames[REDRAW_REASON_COUNT] = { "input", "camera", "field", "hud", "work", "capture" };
+static int _onDemand = 0;
+static unsigned int _damage = 0;
+static unsigned int _lastDamage = 0;
+static unsigned long _redrawCounts[REDRAW_REASON_COUNT];
+static unsigned long _redraws = 0;
+static unsigned long _idleTicks = 0;
+static int _timerEpoch = 0; // a timer of an older epoch stops instead of rescheduling itself
+static int _timerIdle = 0;
+static int _lastTickRedrew = 0;
+static int _frameTimed = 0;
+static unsigned long _drawnGeneration = 0;
+static uint64_t _drawnSceneHash = 0;
+static MagneticFieldUpdateStats _drawnUpdateStats;
+static FrameCaptureStats _drawnCaptureStats;
+
+// what 'c' places in front of the camera
+static FieldSource createSource(FieldSourceType type, Vector position) {
+	FieldSource source = { .type = type };
+	switch (type) {
+		case FIELD_SOURCE_ELEMENT:
+			source.element = (Conductor) { .position = position, .I = 3000, .permeability = 2.5 * 1.0e-1, .l = { 4, 0.4, 0.4 } };
+			break;
+		case FIELD_SOURCE_SEGMENT:
+			source.segment = (FieldSegment) { .start = position, .end = vectorSum(position, vectorCreate(0, 8, 0)), .I = 3000, .permeability = 2.5 * 1.0e-1 };
+			break;
+		case FIELD_SOURCE_LOOP:
+			source.loop = (FieldLoop) { .center = position, .normal = { 0, 1, 0 }, .radius = 3, .I = 3000, .permeability = 2.5 * 1.0e-1 };
+			break;
+		case FIELD_SOURCE_DIPOLE:
+			source.dipole = (FieldDipole) { .position = position, .moment = { 0, 20000, 0 }, .permeability = 2.5 * 1.0e-1 };
+			break;
+		default:
+			source.charge = (FieldCharge) { .position = position, .velocity = { 2, 0, 0 }, .q = 2000, .permeability = 2.5 * 1.0e-1 };
+			break;
+	}
+	return source;
+}
+
+static FieldSource moveSource(FieldSource source, Vector position) {
+	switch (source.type) {
+		case FIELD_SOURCE_ELEMENT:
+			source.element.position = position;
+			break;
+		case FIELD_SOURCE_SEGMENT:
+			source.segment.end = vectorSum(position, vectorSubstract(source.segment.end, source.segment.start));
+			source.segment.start = position;
+			break;
+		case FIELD_SOURCE_LOOP:
+			source.loop.center = position;
+			break;
+		case FIELD_SOURCE_DIPOLE:
+			source.dipole.position = position;
+			break;
+		default:
+			source.charge.position = position;
+			break;
+	}
+	return source;
+}
+
+static inline unsigned int getMaxDeltaMs() {
+	return 1000 / _maxFps;
+}
 
 static inline float updateDelta(double* lastUpdateTime) {
 	const double now = getTimeDetailed();
@@ -61,6 +185,7 @@ static inline float updateDelta(double* lastUpdateTime) {
 }
 
 static inline void go2D() {
+	glViewport(0, 0, (GLsizei) _context.windowSize.x, (GLsizei) _context.windowSize.y);
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	gluOrtho2D(0, _context.windowSize.x, 0, _context.windowSize.y);
@@ -69,27 +194,130 @@ static inline void go2D() {
 	glLoadIdentity();
 }
 
-static inline void go3D() {
+static inline void goView(const Viewport* viewport) {
+	const Camera* camera = &viewport->camera;
+	const double aspect = viewport->size.y > 0 ? viewport->size.x / viewport->size.y : 1;
+	glViewport((GLint) viewport->origin.x, (GLint) viewport->origin.y, (GLsizei) viewport->size.x, (GLsizei) viewport->size.y);
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
-	gluPerspective(60, _context.windowSize.x / _context.windowSize.y, 0.00001, 128);
-	_context.windowSize.z = 128;
+	if (viewport->orthographicExtent) {
+		const double extent = viewport->orthographicExtent;
+		glOrtho(-extent * aspect, extent * aspect, -extent, extent, 0, VIEW_DEPTH);
+		glDisable(GL_FOG);
+	} else {
+		gluPerspective(60, aspect, 0.00001, VIEW_DEPTH);
+		glEnable(GL_FOG);
+	}
+	_context.windowSize.z = VIEW_DEPTH;
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
+	// looking straight down or up, the up vector can't be y
+	const int vertical = fabs(camera->direction.y) > 0.99 * vectorGetLength(camera->direction);
 	gluLookAt(
-		_context.camera.position.x, _context.camera.position.y, _context.camera.position.z,
-		_context.camera.position.x + _context.camera.direction.x, _context.camera.position.y + _context.camera.direction.y, _context.camera.position.z + _context.camera.direction.z,
-		0, 1, 0
+		camera->position.x, camera->position.y, camera->position.z,
+		camera->position.x + camera->direction.x, camera->position.y + camera->direction.y, camera->position.z + camera->direction.z,
+		0, vertical ? 0 : 1, vertical ? -1 : 0
 	);
 }
 
+static inline Viewport createOrthographicViewport(Vector direction, Vector origin, Vector size) {
+	return (Viewport) {
+		.camera = { .position = vectorMultiply(direction, -MULTI_VIEW_DISTANCE), .direction = direction },
+		.focus = vectorZero,
+		.orthographicExtent = MULTI_VIEW_EXTENT,
+		.origin = origin,
+		.size = size
+	};
+}
+
+// the camera fills the window, or takes its left two thirds next to a top and a side view of the origin; call with the
+// update mutex held
+static void layoutViewports() {
+	const double width = _context.windowSize.x;
+	const double height = _context.windowSize.y;
+	const double mainWidth = _multiView ? floor(width * 2 / 3) : width;
+	const double topHeight = floor(height / 2);
+	_context.viewports[0] = (Viewport) {
+		.camera = _context.camera,
+		.focus = _context.camera.position,
+		.orthographicExtent = 0,
+		.origin = { 0, 0, 0 },
+		.size = { mainWidth, height, 0 }
+	};
+	_context.viewportCount = 1;
+	if (_multiView) {
+		_context.viewports[1] = createOrthographicViewport(vectorCreate(0, -1, 0), vectorCreate(mainWidth, height - topHeight, 0), vectorCreate(width - mainWidth, topHeight, 0));
+		_context.viewports[2] = createOrthographicViewport(vectorCreate(-1, 0, 0), vectorCreate(mainWidth, 0, 0), vectorCreate(width - mainWidth, height - topHeight, 0));
+		_context.viewportCount = 3;
+	}
+}
+
+static inline void renderViewportBorders() {
+	int i;
+	glDisable(GL_DEPTH_TEST);
+	glColor3f(0.5f, 0.5f, 0.5f);
+	glBegin(GL_LINES);
+		for (i = 1; i < _context.viewportCount; ++i) {
+			const Viewport* viewport = &_context.viewports[i];
+			glVertex2d(viewport->origin.x + 0.5, viewport->origin.y);
+			glVertex2d(viewport->origin.x + 0.5, viewport->origin.y + viewport->size.y);
+			glVertex2d(viewport->origin.x, viewport->origin.y + viewport->size.y - 0.5);
+			glVertex2d(viewport->origin.x + viewport->size.x, viewport->origin.y + viewport->size.y - 0.5);
+		}
+	glEnd();
+	glColor3f(1, 1, 1);
+	glEnable(GL_DEPTH_TEST);
+}
+
+// a frame is janky once it shows up half a frame late, timer jitter alone stays below that
+static inline double getFrameBudget() {
+	return 1.5 / _maxFps;
+}
+
+// the latest frame times as bars in the bottom right corner, the line is the jank budget at a third of the height
+static inline void renderLatencyGraph() {
+	static double samples[LATENCY_GRAPH_WIDTH];
+	const double budget = getFrameBudget();
+	const double scale = LATENCY_GRAPH_HEIGHT / (3 * budget);
+	const double left = _context.windowSize.x - LATENCY_GRAPH_WIDTH - 8;
+	const double bottom = 8;
+	const size_t count = latencyTrackerGetHistory(_frameLatency, samples, LATENCY_GRAPH_WIDTH);
+	size_t i;
+	glDisable(GL_DEPTH_TEST);
+	glBegin(GL_LINES);
+		for (i = 0; i < count; ++i) {
+			const double height = min(samples[i] * scale, (double) LATENCY_GRAPH_HEIGHT);
+			if (samples[i] > budget) {
+				glColor3f(1, 0.2f, 0.2f);
+			} else {
+				glColor3f(0.2f, 0.8f, 0.2f);
+			}
+			glVertex2d(left + LATENCY_GRAPH_WIDTH - count + i, bottom);
+			glVertex2d(left + LATENCY_GRAPH_WIDTH - count + i, bottom + height);
+		}
+		glColor3f(1, 1, 1);
+		glVertex2d(left, bottom + budget * scale);
+		glVertex2d(left + LATENCY_GRAPH_WIDTH, bottom + budget * scale);
+	glEnd();
+	glEnable(GL_DEPTH_TEST);
+}
+
 static inline void renderInfo() {
 	static const Vector textPos = { 8, 8, 1 };
+	static const Vector fieldTextPos = { 8, 24, 1 };
+	static const Vector cacheTextPos = { 8, 40, 1 };
+	static const Vector memoryTextPos = { 8, 56, 1 };
+	static const Vector isosurfaceTextPos = { 8, 72, 1 };
+	static const Vector adaptiveTextPos = { 8, 88, 1 };
+	static const Vector latencyTextPos = { 8, 104, 1 };
+	static const Vector captureTextPos = { 8, 120, 1 };
+	static const Vector redrawTextPos = { 8, 136, 1 };
+	static const Vector sliceTextPos = { 8, 152, 1 };
 	static const Color textColor = { 1, 1, 1 };
-	char text[128];
+	char text[512];
 	sprintf(text, "FPS: %hd, maxFPS: %hd, rendDt: %dms, updDt: %dms, camPos: (%.1f, %.1f, %.1f), camDir: (%.1f, %.1f, %.1f)",
 		(int) (1 / _context.renderDelta),
-		MAX_FPS,
+		_maxFps,
 		(int) (_context.renderDelta * 1000),
 		(int) (_context.updateDelta * 1000),
 		_context.camera.position.x,
@@ -100,6 +328,153 @@ static inline void renderInfo() {
 		_context.camera.direction.z
 	);
 	renderText(GLUT_BITMAP_HELVETICA_12, text, textPos, textColor);
+	const MagneticFieldUpdateStats updateStats = getMagneticFieldUpdateStats();
+	sprintf(text, "sources: %lu (placing %s), points: %lu, fieldGen: %lu, updBudget: %dms, lastUpd: %dms, overruns: %lu (max +%dms), pending: %lu, cancelled: %.1f%%, stale: %llu",
+		(unsigned long) getMagneticFieldSourceCount(FIELD_SOURCE_TYPE_COUNT),
+		fieldSourceGetTypeName(_placeType),
+		(unsigned long) getMagneticFieldPointCount(),
+		getMagneticFieldGeneration(),
+		(int) (_context.updateBudget * 1000),
+		(int) (updateStats.lastDuration * 1000),
+		updateStats.overruns,
+		(int) (updateStats.maxOverrun * 1000),
+		(unsigned long) updateStats.pendingCells,
+		updateStats.computedCells + updateStats.cancelledCells ? 100.0 * updateStats.cancelledCells / (updateStats.computedCells + updateStats.cancelledCells) : 0.0,
+		updateStats.staleCells
+	);
+	renderText(GLUT_BITMAP_HELVETICA_12, text, fieldTextPos, textColor);
+	sprintf(text, "cache: %.160s, hits: %lu, misses: %lu, daemon: %s, volume: %s (%dms), kernel: %s, views: %d",
+		_fieldCachePath[0] ? _fieldCachePath : "off",
+		updateStats.cacheHits,
+		updateStats.cacheMisses,
+		updateStats.daemonAttached ? "on" : "off",
+		_volumeMode ? "on" : "off",
+		(int) (getVolumeRenderTime() * 1000),
+		getMagneticFieldKernelName(),
+		_context.viewportCount
+	);
+	renderText(GLUT_BITMAP_HELVETICA_12, text, cacheTextPos, textColor);
+	memoryGetStats(&_memoryStats);
+	if (_memoryStats.enabled) {
+		int tag, length = snprintf(text, sizeof(text), "memory:");
+		for (tag = 0; tag < MEMORY_TAG_COUNT && length < (int) sizeof(text); ++tag) {
+			const MemoryTagStats* stats = _memoryStats.tags + tag;
+			length += snprintf(text + length, sizeof(text) - length, " %s %.1f/%.1fMB %.0f/s%s",
+				memoryGetTagName((MemoryTag) tag),
+				stats->currentBytes / 1048576.0,
+				stats->peakBytes / 1048576.0,
+				stats->allocationRate,
+				tag + 1 < MEMORY_TAG_COUNT ? "," : ""
+			);
+		}
+	} else {
+		snprintf(text, sizeof(text), "memory: accounting disabled at build time");
+	}
+	renderText(GLUT_BITMAP_HELVETICA_12, text, memoryTextPos, textColor);
+	if (_isosurfaceMode) {
+		const IsosurfaceStats isosurfaceStats = getIsosurfaceStats();
+		sprintf(text, "isosurface: |B| = %.3g, chunks: %lu (re-extracted %lu), triangles: %lu, %.1f Mvoxels/s",
+			isosurfaceStats.level,
+			(unsigned long) isosurfaceStats.chunks,
+			(unsigned long) isosurfaceStats.extractedChunks,
+			(unsigned long) isosurfaceStats.triangles,
+			isosurfaceStats.voxelsPerSecond / 1.0e6
+		);
+		renderText(GLUT_BITMAP_HELVETICA_12, text, isosurfaceTextPos, textColor);
+	}
+	if (_adaptiveMode) {
+		const AdaptiveFieldStats adaptiveStats = getAdaptiveFieldStats();
+		sprintf(text, "octree: leaves: %lu, samples: %lu (uniform %.0f, %.1fx fewer), build: %dms",
+			(unsigned long) adaptiveStats.leaves,
+			(unsigned long) adaptiveStats.samples,
+			adaptiveStats.uniformSamples,
+			adaptiveStats.samples ? adaptiveStats.uniformSamples / adaptiveStats.samples : 0.0,
+			(int) (adaptiveStats.buildTime * 1000)
+		);
+		renderText(GLUT_BITMAP_HELVETICA_12, text, adaptiveTextPos, textColor);
+	}
+	LatencyStats frameLatencyStats, updateLatencyStats;
+	latencyTrackerSetBudget(_frameLatency, getFrameBudget());
+	latencyTrackerSetBudget(_updateLatency, _context.updateBudget);
+	latencyTrackerGetStats(_frameLatency, &frameLatencyStats);
+	latencyTrackerGetStats(_updateLatency, &updateLatencyStats);
+	sprintf(text, "frame p50/p95/p99/max: %.1f/%.1f/%.1f/%.1fms, janky: %lu (%.2f%%), update p50/p95/p99/max: %.1f/%.1f/%.1f/%.1fms, over budget: %lu",
+		frameLatencyStats.p50 * 1000,
+		frameLatencyStats.p95 * 1000,
+		frameLatencyStats.p99 * 1000,
+		frameLatencyStats.max * 1000,
+		frameLatencyStats.overBudget,
+		frameLatencyStats.count ? 100.0 * frameLatencyStats.overBudget / frameLatencyStats.count : 0.0,
+		updateLatencyStats.p50 * 1000,
+		updateLatencyStats.p95 * 1000,
+		updateLatencyStats.p99 * 1000,
+		updateLatencyStats.max * 1000,
+		updateLatencyStats.overBudget
+	);
+	renderText(GLUT_BITMAP_HELVETICA_12, text, latencyTextPos, textColor);
+	if (_capture) {
+		const FrameCaptureStats captureStats = frameCaptureGetStats(_capture);
+		sprintf(text, "capture: %.60s, frames: %lu, written: %lu, dropped: %lu, cost: %.2fms (max %.2fms)%s",
+			_captureName,
+			captureStats.captured,
+			captureStats.written,
+			captureStats.dropped,
+			captureStats.lastCost * 1000,
+			captureStats.maxCost * 1000,
+			captureStats.failed ? ", write failed" : ""
+		);
+		renderText(GLUT_BITMAP_HELVETICA_12, text, captureTextPos, textColor);
+	}
+	int reason, length = snprintf(text, sizeof(text), "redraw: %s, frames: %lu, idle ticks: %lu, reasons:",
+		_onDemand ? "on demand" : "every tick",
+		_redraws,
+		_idleTicks
+	);
+	for (reason = 0; reason < REDRAW_REASON_COUNT && length < (int) sizeof(text); ++reason) {
+		length += snprintf(text + length, sizeof(text) - length, " %s%s %lu",
+			_lastDamage & (1u << reason) ? "*" : "",
+			_redrawReasonNames[reason],
+			_redrawCounts[reason]
+		);
+	}
+	renderText(GLUT_BITMAP_HELVETICA_12, text, redrawTextPos, textColor);
+	if (_sliceMode) {
+		const FieldSliceStats sliceStats = getSliceStats();
+		sprintf(text, "slice: tiles: %lu, sampled: %lu, lic: %lu, pending: %lu, update: %dms, |B|: 1e%.1f..1e%.1f",
+			(unsigned long) sliceStats.tiles,
+			(unsigned long) sliceStats.sampledTiles,
+			(unsigned long) sliceStats.licTiles,
+			(unsigned long) sliceStats.pendingTiles,
+			(int) (sliceStats.updateTime * 1000),
+			sliceStats.minLevel,
+			sliceStats.maxLevel
+		);
+		renderText(GLUT_BITMAP_HELVETICA_12, text, sliceTextPos, textColor);
+	}
+}
+
+static void startCapture() {
+	if (_capturePath) {
+		snprintf(_captureName, sizeof(_captureName), "%s", _capturePath);
+	} else {
+		snprintf(_captureName, sizeof(_captureName), "magnetictest-%lu.y4m", getTime());
+	}
+	_capture = frameCaptureStart(_captureName, (int) _context.windowSize.x, (int) _context.windowSize.y, _maxFps);
+	if (_capture) {
+		printf("capturing %dx%d to %s\n", (int) _context.windowSize.x, (int) _context.windowSize.y, _captureName);
+	} else {
+		fprintf(stderr, "warning: Can't capture to %s%s\n", _captureName, frameCaptureIsSupported() ? "" : ", persistent buffers are not supported");
+		_captureRequested = 0;
+	}
+}
+
+static void stopCapture(int hasContext) {
+	if (!_capture) {
+		return;
+	}
+	const FrameCaptureStats stats = frameCaptureStop(_capture, hasContext);
+	_capture = NULL;
+	printf("captured %lu frames to %s, %lu dropped\n", stats.written, _captureName, stats.dropped);
 }
 
 static inline void renderOrigin() {
@@ -109,47 +484,184 @@ static inline void renderOrigin() {
 	renderCubeFrame(vectorZero, frameSize, colorWhite);
 }
 
+static void requestUpdate() {
+	_updateRequested = 1;
+	_fieldPending = 1;
+	pthread_cond_signal(&_updateThreadWake);
+}
+
+// what changed on screen since the last frame, besides input which marks itself; call with the update mutex held
+static unsigned int collectDamage() {
+	unsigned int damage = 0;
+	const unsigned long generation = getMagneticFieldGeneration();
+	const uint64_t sceneHash = getMagneticFieldSceneHash();
+	if (generation != _drawnGeneration || sceneHash != _drawnSceneHash) {
+		damage |= REDRAW_FIELD;
+	}
+	const MagneticFieldUpdateStats updateStats = getMagneticFieldUpdateStats();
+	if (updateStats.pendingCells != _drawnUpdateStats.pendingCells || updateStats.overruns != _drawnUpdateStats.overruns ||
+			updateStats.cacheHits != _drawnUpdateStats.cacheHits || updateStats.cacheMisses != _drawnUpdateStats.cacheMisses ||
+			updateStats.daemonAttached != _drawnUpdateStats.daemonAttached) {
+		damage |= REDRAW_HUD;
+	}
+	if (_capture) {
+		damage |= REDRAW_CAPTURE;
+	} else if (_captureRequested || _drawnCaptureStats.captured) {
+		damage |= REDRAW_HUD;
+	}
+	if (_fieldPending || (_sliceMode && isSlicePending())) {
+		damage |= REDRAW_WORK;
+	}
+	return damage;
+}
+
 static void onUpdate(int value) {
-	glutPostRedisplay();
-	glutTimerFunc(MAX_DELTA_MS, onUpdate, 0);
+	if (value != _timerEpoch) {
+		return;
+	}
+	if (_memoryDumpRequested) {
+		_memoryDumpRequested = 0;
+		memoryDumpStats(stdout);
+	}
 
 	pthread_mutex_lock(&_updateThreadMutex);
-	_updateRequested = 1;
+	int redraw = 1;
+	if (_onDemand) {
+		_damage |= collectDamage();
+		redraw = _damage != 0;
+		if (_fieldPending) {
+			requestUpdate();
+		}
+	} else {
+		requestUpdate();
+	}
 	pthread_mutex_unlock(&_updateThreadMutex);
+
+	// an idle viewer only wakes up now and then, a key brings the full rate back right away
+	_frameTimed = redraw && _lastTickRedrew;
+	_lastTickRedrew = redraw;
+	_timerIdle = !redraw;
+	if (redraw) {
+		glutPostRedisplay();
+	} else {
+		++_idleTicks;
+	}
+	glutTimerFunc(redraw ? getMaxDeltaMs() : ON_DEMAND_IDLE_MS, onUpdate, _timerEpoch);
+}
+
+// called on input, redraws at once and restarts a timer which is waiting out an idle tick
+static void wakeRedraw(unsigned int damage) {
+	_damage |= damage;
+	glutPostRedisplay();
+	if (_timerIdle) {
+		_timerIdle = 0;
+		glutTimerFunc(getMaxDeltaMs(), onUpdate, ++_timerEpoch);
+	}
 }
 
 static void* onBackgroundUpdate(void* arg) {
 	while (1) {
 		pthread_mutex_lock(&_updateThreadMutex);
+		while (_updateThreadRunning && !_updateRequested) {
+			pthread_cond_wait(&_updateThreadWake, &_updateThreadMutex);
+		}
 		if (!_updateThreadRunning) {
 			pthread_mutex_unlock(&_updateThreadMutex);
 			break;
 		}
 		_context.updateDelta = updateDelta(&_lastUpdateDeltaUpdateTime);
-		if (!_updateRequested) {
-			pthread_mutex_unlock(&_updateThreadMutex);
-			usleep((__useconds_t) 1.0e5);
-			continue;
-		}
 		_updateRequested = 0;
+		const RenderContext context = _context;
 		pthread_mutex_unlock(&_updateThreadMutex);
 
-		updateMagneticField(&_context);
+		const double updateStart = getTimeDetailed();
+		const int done = updateMagneticField(&context);
+		latencyTrackerRecord(_updateLatency, getTimeDetailed() - updateStart);
+
+		// a request which came in meanwhile is for a newer context, so it keeps the work pending
+		pthread_mutex_lock(&_updateThreadMutex);
+		if (!_updateRequested) {
+			_fieldPending = !done;
+		}
+		pthread_mutex_unlock(&_updateThreadMutex);
 	}
+	return NULL;
+}
+
+static void onMemoryDumpSignal(int signal) {
+	_memoryDumpRequested = 1;
 }
 
 static void onRender() {
+	const int firstFrame = !_lastRenderDeltaUpdateTime;
 	_context.renderDelta = updateDelta(&_lastRenderDeltaUpdateTime);
+	// on demand, only frames following a frame are timed, the gap after an idle spell isn't a frame time
+	if (!firstFrame && (!_onDemand || _frameTimed)) {
+		latencyTrackerRecord(_frameLatency, _context.renderDelta);
+	}
+	_frameTimed = 0;
+
+	// whatever this frame shows is drawn, so the next tick compares against it
+	pthread_mutex_lock(&_updateThreadMutex);
+	int reason;
+	for (reason = 0; reason < REDRAW_REASON_COUNT; ++reason) {
+		if (_damage & (1u << reason)) {
+			++_redrawCounts[reason];
+		}
+	}
+	_lastDamage = _damage;
+	_damage = 0;
+	++_redraws;
+	_drawnGeneration = getMagneticFieldGeneration();
+	_drawnSceneHash = getMagneticFieldSceneHash();
+	_drawnUpdateStats = getMagneticFieldUpdateStats();
+	pthread_mutex_unlock(&_updateThreadMutex);
+	// capture starts and stops on the GL thread, at the window size of that moment
+	if (_captureRequested && !_capture) {
+		startCapture();
+	} else if (!_captureRequested && _capture) {
+		stopCapture(1);
+	}
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glColor3f(1, 1, 1);
 
-	go3D();
-	renderOrigin();
-	renderMagneticField(&_context);
+	if (_volumeMode) {
+		go2D();
+		renderVolume(&_context);
+	} else {
+		// the slice gets a third of the frame budget, tiles it doesn't reach show their old samples until the next frame
+		if (_sliceMode) {
+			updateSlice(getFrameBudget() / 3);
+		}
+		// every view draws the same field store, planned by the update thread for all of them
+		int i;
+		for (i = 0; i < _context.viewportCount; ++i) {
+			goView(&_context.viewports[i]);
+			renderOrigin();
+			if (_adaptiveMode) {
+				renderAdaptiveField(&_context);
+			} else {
+				renderMagneticField(&_context);
+			}
+			if (_isosurfaceMode) {
+				renderIsosurface(&_context);
+			}
+			if (_sliceMode) {
+				renderSlice();
+			}
+		}
+		go2D();
+		renderViewportBorders();
+	}
+	// the scene without the HUD
+	frameCaptureFrame(_capture);
 
 	go2D();
+	renderLatencyGraph();
 	renderInfo();
 
+	_drawnCaptureStats = _capture ? frameCaptureGetStats(_capture) : (FrameCaptureStats) { 0, 0, 0, 0, 0, 0 };
+
 	glutSwapBuffers();
 }
 
@@ -157,6 +669,8 @@ static void onResize(int width, int height) {
 	pthread_mutex_lock(&_updateThreadMutex);
 	_context.windowSize.x = width;
 	_context.windowSize.y = height;
+	layoutViewports();
+	_damage |= REDRAW_INPUT;
 	pthread_mutex_unlock(&_updateThreadMutex);
 	glViewport(0, 0, width, height);
 }
@@ -164,7 +678,12 @@ static void onResize(int width, int height) {
 static void onKeyboard(unsigned char key, int x, int y) {
 	static const float moveSpeed = 0.16;
 	static const float rotateSpeed = 0.04;
+	static const float placeDistance = 4;
 	pthread_mutex_lock(&_updateThreadMutex);
+	const Camera camera = _context.camera;
+	const Vector placePosition = vectorSum(_context.camera.position, vectorMultiply(vectorNormalize(_context.camera.direction), placeDistance));
+	const size_t sourceCount = getMagneticFieldSourceCount(_placeType);
+	FieldSource source;
 	switch (key) {
 		case 'w':
 			_context.camera.position = vectorSum(_context.camera.position, vectorMultiply(_context.camera.direction, moveSpeed));
@@ -196,8 +715,101 @@ static void onKeyboard(unsigned char key, int x, int y) {
 				.direction = { 1, 0, 1 }
 			};
 			break;
+		case 'c':
+			addMagneticFieldSource(createSource(_placeType, placePosition));
+			break;
+		case 'm':
+			if (sourceCount && getMagneticFieldSource(_placeType, sourceCount - 1, &source)) {
+				updateMagneticFieldSource(sourceCount - 1, moveSource(source, placePosition));
+			}
+			break;
+		case 'x':
+			if (sourceCount) {
+				removeMagneticFieldSource(_placeType, sourceCount - 1);
+			}
+			break;
+		case 'u':
+			_memoryDumpRequested = 1;
+			break;
+		case 'p':
+			_placeType = (FieldSourceType) ((_placeType + 1) % FIELD_SOURCE_TYPE_COUNT);
+			break;
+		case 'v':
+			_volumeMode = !_volumeMode;
+			break;
+		case 'i':
+			_isosurfaceMode = !_isosurfaceMode;
+			break;
+		case 'o':
+			_adaptiveMode = !_adaptiveMode;
+			break;
+		case 'f':
+			_captureRequested = !_captureRequested;
+			break;
+		case 'b':
+			_multiView = !_multiView;
+			break;
+		case 'n':
+			_onDemand = !_onDemand;
+			break;
+		case 'g':
+			_sliceMode = !_sliceMode;
+			break;
+		case 't':
+			placeSlice(_context.camera, SLICE_PLACE_DISTANCE);
+			break;
+		case '1':
+			moveSlice(-SLICE_MOVE_SPEED, 0);
+			break;
+		case '2':
+			moveSlice(SLICE_MOVE_SPEED, 0);
+			break;
+		case '3':
+			rotateSlice(-SLICE_ROTATE_SPEED, 0);
+			break;
+		case '4':
+			rotateSlice(SLICE_ROTATE_SPEED, 0);
+			break;
+		case '5':
+			rotateSlice(0, -SLICE_ROTATE_SPEED);
+			break;
+		case '6':
+			rotateSlice(0, SLICE_ROTATE_SPEED);
+			break;
+		case '7':
+			moveSlice(0, -SLICE_MOVE_SPEED);
+			break;
+		case '8':
+			moveSlice(0, SLICE_MOVE_SPEED);
+			break;
+		case ',':
+			_isosurfaceLevel /= 1.25;
+			setIsosurfaceLevel(_isosurfaceLevel);
+			break;
+		case '.':
+			_isosurfaceLevel *= 1.25;
+			setIsosurfaceLevel(_isosurfaceLevel);
+			break;
+		case '-':
+			_maxFps = max(_maxFps - 10, 10);
+			break;
+		case '=':
+			_maxFps = min(_maxFps + 10, 240);
+			break;
+		case '[':
+			_context.updateBudget = max(_context.updateBudget - 0.001f, 0.001f);
+			break;
+		case ']':
+			_context.updateBudget = min(_context.updateBudget + 0.001f, 0.1f);
+			break;
 	}
+	// a moved camera or a new layout cancels the update which is computing the old windows and starts the next one right away
+	layoutViewports();
+	invalidateMagneticFieldUpdate(&_context);
+	requestUpdate();
+	const int cameraMoved = memcmp(&camera, &_context.camera, sizeof(camera)) != 0;
 	pthread_mutex_unlock(&_updateThreadMutex);
+	wakeRedraw(REDRAW_INPUT | (cameraMoved ? REDRAW_CAMERA : 0));
 }
 
 static int onInit() {
@@ -210,19 +822,62 @@ static int onInit() {
 	glFogf(GL_FOG_END, 120);
 	glEnable(GL_FOG);
 
+	// latency, before the update thread starts recording
+	_frameLatency = latencyTrackerNew("frame", getFrameBudget());
+	_updateLatency = latencyTrackerNew("update", _context.updateBudget);
+	if (!_frameLatency || !_updateLatency) {
+		return 0;
+	}
+
 	// update thread
 	_updateThreadRunning = 1;
 	pthread_mutex_init(&_updateThreadMutex, NULL);
+	pthread_cond_init(&_updateThreadWake, NULL);
+	layoutViewports();
 	pthread_create(&_updateThread, NULL, onBackgroundUpdate, NULL);
 
 	// user
-	return initMagneticField();
+	_pool = threadPoolNew(0);
+	if (!_pool || !initMagneticFieldScene(_scenePath) || !initVolume(_pool) || !initIsosurface(_pool) || !initAdaptiveField() || !initSlice(_pool)) {
+		return 0;
+	}
+	setIsosurfaceLevel(_isosurfaceLevel);
+	if (_fieldCachePath[0] && !openMagneticFieldCache(_fieldCachePath, _fieldCacheSize)) {
+		fprintf(stderr, "warning: Can't open field cache %s\n", _fieldCachePath);
+		_fieldCachePath[0] = '\0';
+	}
+	if (_attachDaemon && attachMagneticFieldDaemon()) {
+		printf("attached to field daemon\n");
+	}
+	return 1;
+}
+
+// freeglut calls this while the window and its context still exist, so a capture gets its last frames
+static void onClose() {
+	stopCapture(1);
 }
 
 static void onDeinit() {
+	stopCapture(0);
 	pthread_mutex_lock(&_updateThreadMutex);
 	_updateThreadRunning = 0;
+	pthread_cond_signal(&_updateThreadWake);
 	pthread_mutex_unlock(&_updateThreadMutex);
+	closeMagneticFieldCache();
+	detachMagneticFieldDaemon();
+	if (_latencyStatsPath) {
+		FILE* file = strcmp(_latencyStatsPath, "-") ? fopen(_latencyStatsPath, "w") : stdout;
+		if (file) {
+			latencyTrackerDump(_frameLatency, file);
+			latencyTrackerDump(_updateLatency, file);
+			if (file != stdout) {
+				fclose(file);
+			}
+		} else {
+			fprintf(stderr, "warning: Can't write latency stats to %s\n", _latencyStatsPath);
+		}
+		_latencyStatsPath = NULL;
+	}
 }
 
 
@@ -233,6 +888,46 @@ int renderEngineMain(int argc, char **argv) {
 	glutInitWindowPosition(100, 100);
 	glutCreateWindow("MagneticTest by Reo_SP");
 
+	const char* cacheHome = getenv("XDG_CACHE_HOME");
+	const char* home = getenv("HOME");
+	if (cacheHome && cacheHome[0]) {
+		snprintf(_fieldCachePath, sizeof(_fieldCachePath), "%s/magnetictest-field.cache", cacheHome);
+	} else if (home && home[0]) {
+		snprintf(_fieldCachePath, sizeof(_fieldCachePath), "%s/.cache/magnetictest-field.cache", home);
+	}
+
+	int i;
+	for (i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--max-fps") && i + 1 < argc) {
+			const int maxFps = atoi(argv[++i]);
+			_maxFps = clamp(maxFps, 1, 1000);
+		} else if (!strcmp(argv[i], "--update-budget") && i + 1 < argc) {
+			const double budgetMs = atof(argv[++i]);
+			_context.updateBudget = (float) (clamp(budgetMs, 0.1, 1000.0) / 1000);
+		} else if (!strcmp(argv[i], "--field-cache") && i + 1 < argc) {
+			snprintf(_fieldCachePath, sizeof(_fieldCachePath), "%s", argv[++i]);
+		} else if (!strcmp(argv[i], "--field-cache-size") && i + 1 < argc) {
+			_fieldCacheSize = (size_t) atol(argv[++i]) << 20;
+		} else if (!strcmp(argv[i], "--no-field-cache")) {
+			_fieldCachePath[0] = '\0';
+		} else if (!strcmp(argv[i], "--no-daemon")) {
+			_attachDaemon = 0;
+		} else if (!strcmp(argv[i], "--scene") && i + 1 < argc) {
+			_scenePath = argv[++i];
+		} else if (!strcmp(argv[i], "--latency-stats") && i + 1 < argc) {
+			_latencyStatsPath = argv[++i];
+		} else if (!strcmp(argv[i], "--capture") && i + 1 < argc) {
+			_capturePath = argv[++i];
+			_captureRequested = 1;
+		} else if (!strcmp(argv[i], "--multi-view")) {
+			_multiView = 1;
+		} else if (!strcmp(argv[i], "--on-demand")) {
+			_onDemand = 1;
+		} else if (!strcmp(argv[i], "--slice")) {
+			_sliceMode = 1;
+		}
+	}
+
 	GLenum glewStatus = glewInit();
 	if (glewStatus != GLEW_OK) {
 		fprintf(stderr, "error: %s\n", glewGetErrorString(glewStatus));
@@ -240,10 +935,15 @@ int renderEngineMain(int argc, char **argv) {
 	}
 
 	if (onInit()) {
-		glutTimerFunc(MAX_DELTA_MS, onUpdate, 0);
+		atexit(onDeinit);
+		signal(SIGUSR1, onMemoryDumpSignal);
+		glutTimerFunc(getMaxDeltaMs(), onUpdate, 0);
 		glutDisplayFunc(onRender);
 		glutReshapeFunc(onResize);
 		glutKeyboardFunc(onKeyboard);
+#ifdef FREEGLUT
+		glutCloseFunc(onClose);
+#endif
 		glutMainLoop();
 	} else {
 		fprintf(stderr, "error: Can't init renderer\n");
@@ -0,0 +1,149 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/graphics/SliceRenderer.h"
+
+#include <string.h>
+#include <math.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+
+#include "test/graphics/MagneticFieldRenderer.h"
+#include "test/physics/FieldSource.h"
+#include "test/tools/TimeTools.h"
+
+#define SLICE_RESOLUTION 1024
+#define SLICE_SIZE 64.0
+
+static FieldSlice* _slice = NULL;
+static FieldSlicePlane _plane = {
+	.center = { 0, 0, 0 },
+	.normal = { 0, 0, 1 },
+	.up = { 0, 1, 0 },
+	.size = SLICE_SIZE
+};
+static FieldSlicePlane _drawnPlane;
+static uint64_t _drawnSceneHash = 0;
+static int _drawn = 0;
+static int _pending = 0;
+static GLuint _texture = 0;
+
+// the horizontal and vertical axes of the plane, as the slice lays its pixels out
+static void getPlaneAxes(Vector* u, Vector* v) {
+	const Vector normal = vectorNormalize(_plane.normal);
+	Vector axis = vectorCrossProduct(_plane.up, normal);
+	if (vectorGetLengthSq(axis) < 1.0e-12) {
+		axis = vectorCrossProduct(fabs(normal.x) < 0.5 ? vectorCreate(1, 0, 0) : vectorCreate(0, 1, 0), normal);
+	}
+	*u = vectorNormalize(axis);
+	*v = vectorCrossProduct(normal, *u);
+}
+
+int initSlice(ThreadPool* pool) {
+	_slice = fieldSliceNew(SLICE_RESOLUTION, pool);
+	return _slice != NULL;
+}
+
+void updateSlice(double budget) {
+	const uint64_t sceneHash = getMagneticFieldSceneHash();
+	if (_drawn && !_pending && sceneHash == _drawnSceneHash && !memcmp(&_plane, &_drawnPlane, sizeof(_plane))) {
+		return;
+	}
+	FieldSourceSet* sources = copyMagneticFieldSources();
+	if (!sources) {
+		return;
+	}
+	const int pending = fieldSliceUpdate(_slice, sources, sceneHash, _plane, getTimeDetailed() + budget);
+	fieldSourceSetFree(sources);
+	if (pending < 0) {
+		return;
+	}
+	_pending = pending > 0;
+	_drawnPlane = _plane;
+	_drawnSceneHash = sceneHash;
+	_drawn = 1;
+
+	if (!_texture) {
+		glGenTextures(1, &_texture);
+		glBindTexture(GL_TEXTURE_2D, _texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, _texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SLICE_RESOLUTION, SLICE_RESOLUTION, 0, GL_RGBA, GL_UNSIGNED_BYTE, _slice->image);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// the image on its plane in the scene, so the field lines pass through it
+void renderSlice() {
+	static const float texCoords[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	int i;
+	if (!_drawn) {
+		return;
+	}
+	glBindTexture(GL_TEXTURE_2D, _texture);
+	glEnable(GL_TEXTURE_2D);
+	glColor3f(1, 1, 1);
+	glBegin(GL_QUADS);
+		for (i = 0; i < 4; ++i) {
+			const Vector corner = fieldSliceGetCorner(_slice, i);
+			glTexCoord2f(texCoords[i][0], texCoords[i][1]);
+			glVertex3d(corner.x, corner.y, corner.z);
+		}
+	glEnd();
+	glDisable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void placeSlice(Camera camera, double distance) {
+	const Vector direction = vectorNormalize(camera.direction);
+	_plane.center = vectorSum(camera.position, vectorMultiply(direction, distance));
+	_plane.normal = vectorGetOpposite(direction);
+}
+
+void moveSlice(double distance, double sideways) {
+	Vector u, v;
+	getPlaneAxes(&u, &v);
+	_plane.center = vectorSum(_plane.center, vectorSum(vectorMultiply(vectorNormalize(_plane.normal), distance), vectorMultiply(u, sideways)));
+}
+
+void rotateSlice(double yaw, double pitch) {
+	Vector u, v;
+	const Vector normal = vectorNormalize(_plane.normal);
+	getPlaneAxes(&u, &v);
+	const Vector pitched = vectorSum(vectorMultiply(normal, cos(pitch)), vectorMultiply(v, sin(pitch)));
+	_plane.normal = vectorCreate(
+		pitched.x * cos(yaw) - pitched.z * sin(yaw),
+		pitched.y,
+		pitched.x * sin(yaw) + pitched.z * cos(yaw)
+	);
+}
+
+int isSlicePending() {
+	return _pending;
+}
+
+FieldSliceStats getSliceStats() {
+	return _slice->stats;
+}
@@ -0,0 +1,164 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/graphics/VertexStream.h"
+
+#include <stdlib.h>
+
+int vertexStreamIsSupported() {
+	return GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+}
+
+VertexStream* vertexStreamNew(size_t slotCapacity) {
+	if (!vertexStreamIsSupported() || !slotCapacity) {
+		return NULL;
+	}
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr size = (GLsizeiptr) (sizeof(StreamVertex) * slotCapacity * VERTEX_STREAM_SLOTS);
+
+	VertexStream* result = (VertexStream*) calloc(1, sizeof(VertexStream));
+	glGenBuffers(1, &result->buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, result->buffer);
+	glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+	result->mapping = (StreamVertex*) glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (!result->mapping) {
+		glDeleteBuffers(1, &result->buffer);
+		free(result);
+		return NULL;
+	}
+	result->slotCapacity = slotCapacity;
+	pthread_mutex_init(&result->mutex, NULL);
+	return result;
+}
+
+void vertexStreamFree(VertexStream* stream) {
+	if (!stream) {
+		return;
+	}
+	int i;
+	for (i = 0; i < VERTEX_STREAM_SLOTS; ++i) {
+		if (stream->fences[i]) {
+			glDeleteSync(stream->fences[i]);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &stream->buffer);
+	pthread_mutex_destroy(&stream->mutex);
+	free(stream);
+}
+
+StreamVertex* vertexStreamBeginWrite(VertexStream* stream, int* slot) {
+	if (!stream) {
+		return NULL;
+	}
+	StreamVertex* result = NULL;
+	int i;
+	pthread_mutex_lock(&stream->mutex);
+	for (i = 0; i < VERTEX_STREAM_SLOTS; ++i) {
+		if (stream->states[i] == VERTEX_STREAM_FREE) {
+			stream->states[i] = VERTEX_STREAM_WRITING;
+			result = stream->mapping + stream->slotCapacity * i;
+			*slot = i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&stream->mutex);
+	return result;
+}
+
+void vertexStreamEndWrite(VertexStream* stream, int slot, size_t count) {
+	if (!stream || slot < 0 || slot >= VERTEX_STREAM_SLOTS) {
+		return;
+	}
+	int i;
+	pthread_mutex_lock(&stream->mutex);
+
+	// a newer frame supersedes one which has never been drawn
+	for (i = 0; i < VERTEX_STREAM_SLOTS; ++i) {
+		if (stream->states[i] == VERTEX_STREAM_READY) {
+			stream->states[i] = VERTEX_STREAM_FREE;
+		}
+	}
+	stream->states[slot] = VERTEX_STREAM_READY;
+	stream->counts[slot] = count < stream->slotCapacity ? count : stream->slotCapacity;
+	pthread_mutex_unlock(&stream->mutex);
+}
+
+void vertexStreamDraw(VertexStream* stream, GLenum mode) {
+	if (!stream) {
+		return;
+	}
+	int i, drawing = -1;
+	pthread_mutex_lock(&stream->mutex);
+
+	// slots the GPU has finished reading can be written again
+	for (i = 0; i < VERTEX_STREAM_SLOTS; ++i) {
+		if (stream->states[i] == VERTEX_STREAM_RETIRED &&
+			glClientWaitSync(stream->fences[i], 0, 0) != GL_TIMEOUT_EXPIRED) {
+			glDeleteSync(stream->fences[i]);
+			stream->fences[i] = NULL;
+			stream->states[i] = VERTEX_STREAM_FREE;
+		}
+	}
+
+	// switch to the newest ready slot, the previous one is retired behind its last fence
+	for (i = 0; i < VERTEX_STREAM_SLOTS; ++i) {
+		if (stream->states[i] == VERTEX_STREAM_DRAWING) {
+			drawing = i;
+		}
+	}
+	for (i = 0; i < VERTEX_STREAM_SLOTS; ++i) {
+		if (stream->states[i] == VERTEX_STREAM_READY) {
+			if (drawing >= 0) {
+				stream->states[drawing] = stream->fences[drawing] ? VERTEX_STREAM_RETIRED : VERTEX_STREAM_FREE;
+			}
+			stream->states[i] = VERTEX_STREAM_DRAWING;
+			drawing = i;
+			break;
+		}
+	}
+	const size_t count = drawing >= 0 ? stream->counts[drawing] : 0;
+	pthread_mutex_unlock(&stream->mutex);
+	if (drawing < 0) {
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(StreamVertex), (const GLvoid*) 0);
+	glColorPointer(3, GL_FLOAT, sizeof(StreamVertex), (const GLvoid*) (3 * sizeof(float)));
+	glDrawArrays(mode, (GLint) (stream->slotCapacity * drawing), (GLsizei) count);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// only the GL thread touches fences, the writer just sees the slot state
+	pthread_mutex_lock(&stream->mutex);
+	if (stream->fences[drawing]) {
+		glDeleteSync(stream->fences[drawing]);
+	}
+	stream->fences[drawing] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pthread_mutex_unlock(&stream->mutex);
+}
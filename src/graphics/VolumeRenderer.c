@@ -0,0 +1,337 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/graphics/VolumeRenderer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <GL/glew.h>
+#include <GL/glut.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "test/graphics/Color.h"
+#include "test/graphics/MagneticFieldRenderer.h"
+#include "test/physics/FieldSource.h"
+#include "test/math/MathFunctions.h"
+#include "test/tools/MemoryStats.h"
+#include "test/tools/ThreadPool.h"
+#include "test/tools/TimeTools.h"
+
+#define VOLUME_GRID_SIZE 64
+#define VOLUME_GRID_EXTENT 96.0
+#define VOLUME_GRID_SNAP 12.0
+#define VOLUME_TILE_SIZE 16
+#define VOLUME_IMAGE_SCALE 2
+#define VOLUME_OPACITY 0.06f
+#define VOLUME_OPAQUE 0.98f
+#define VOLUME_TRANSFER_SIZE 256
+
+typedef struct TransferEntry {
+	float r;
+	float g;
+	float b;
+	float a;
+} TransferEntry;
+
+typedef struct VolumeGrid {
+	float* levels;
+	Vector origin;
+	double spacing;
+	uint64_t sceneHash;
+	int valid;
+} VolumeGrid;
+
+typedef struct VolumeFrame {
+	const VolumeGrid* grid;
+	unsigned char* pixels;
+	int width;
+	int height;
+	int tilesX;
+	Vector eye;
+	Vector forward;
+	Vector right;
+	Vector up;
+} VolumeFrame;
+
+typedef struct VolumeSlab {
+	VolumeGrid* grid;
+	const FieldSourceSet* sources;
+} VolumeSlab;
+
+static ThreadPool* _pool;
+static VolumeGrid _grid;
+static unsigned char* _pixels = NULL;
+static int _pixelsWidth = 0;
+static int _pixelsHeight = 0;
+static GLuint _texture = 0;
+static float _renderTime = 0;
+static TransferEntry _transfer[VOLUME_TRANSFER_SIZE];
+
+// one x slab of the grid per task, evaluated with the batch kernel
+static void computeSlab(void* arg, size_t index) {
+	VolumeSlab* slab = (VolumeSlab*) arg;
+	VolumeGrid* grid = slab->grid;
+	Vector positions[VOLUME_GRID_SIZE * VOLUME_GRID_SIZE];
+	Vector results[VOLUME_GRID_SIZE * VOLUME_GRID_SIZE];
+	size_t y, z, i;
+	for (y = 0; y < VOLUME_GRID_SIZE; ++y) {
+		for (z = 0; z < VOLUME_GRID_SIZE; ++z) {
+			positions[y * VOLUME_GRID_SIZE + z] = vectorSum(grid->origin, vectorCreate(index * grid->spacing, y * grid->spacing, z * grid->spacing));
+			results[y * VOLUME_GRID_SIZE + z] = vectorZero;
+		}
+	}
+	fieldSourceSetEvaluate(slab->sources, positions, results, VOLUME_GRID_SIZE * VOLUME_GRID_SIZE);
+	float* levels = grid->levels + index * VOLUME_GRID_SIZE * VOLUME_GRID_SIZE;
+	for (i = 0; i < VOLUME_GRID_SIZE * VOLUME_GRID_SIZE; ++i) {
+		levels[i] = log10f(max((float) vectorGetLength(results[i]), 1.0e-6f));
+	}
+}
+
+static void updateGrid(const RenderContext* context) {
+	const double halfExtent = VOLUME_GRID_EXTENT / 2;
+	const Vector origin = {
+		floor(context->camera.position.x / VOLUME_GRID_SNAP) * VOLUME_GRID_SNAP - halfExtent,
+		floor(context->camera.position.y / VOLUME_GRID_SNAP) * VOLUME_GRID_SNAP - halfExtent,
+		floor(context->camera.position.z / VOLUME_GRID_SNAP) * VOLUME_GRID_SNAP - halfExtent
+	};
+	const uint64_t sceneHash = getMagneticFieldSceneHash();
+	if (_grid.valid && _grid.sceneHash == sceneHash && vectorIsEqual(_grid.origin, origin)) {
+		return;
+	}
+
+	FieldSourceSet* sources = copyMagneticFieldSources();
+	VolumeSlab slab = { &_grid, sources };
+	size_t i;
+	_grid.origin = origin;
+	_grid.spacing = VOLUME_GRID_EXTENT / (VOLUME_GRID_SIZE - 1);
+	threadPoolParallelFor(_pool, VOLUME_GRID_SIZE, computeSlab, &slab);
+	fieldSourceSetFree(sources);
+
+	// the transfer function spans the magnitudes actually present, in log scale
+	float logMin = 1.0e30f, logMax = -1.0e30f;
+	const size_t gridLength = VOLUME_GRID_SIZE * VOLUME_GRID_SIZE * VOLUME_GRID_SIZE;
+	for (i = 0; i < gridLength; ++i) {
+		logMin = min(logMin, _grid.levels[i]);
+		logMax = max(logMax, _grid.levels[i]);
+	}
+	const float logScale = 1 / max(logMax - logMin, 1.0e-3f);
+	for (i = 0; i < gridLength; ++i) {
+		_grid.levels[i] = (_grid.levels[i] - logMin) * logScale;
+	}
+	_grid.sceneHash = sceneHash;
+	_grid.valid = 1;
+}
+
+static inline float sampleGrid(const VolumeGrid* grid, float x, float y, float z) {
+	const int ix = clamp((int) x, 0, VOLUME_GRID_SIZE - 2);
+	const int iy = clamp((int) y, 0, VOLUME_GRID_SIZE - 2);
+	const int iz = clamp((int) z, 0, VOLUME_GRID_SIZE - 2);
+	const float fx = x - ix;
+	const float fy = y - iy;
+	const float fz = z - iz;
+	const float* p = grid->levels + ((size_t) ix * VOLUME_GRID_SIZE + iy) * VOLUME_GRID_SIZE + iz;
+	const size_t dy = VOLUME_GRID_SIZE;
+	const size_t dx = VOLUME_GRID_SIZE * VOLUME_GRID_SIZE;
+#ifdef __SSE2__
+	// the four x edges are interpolated at once, then y and z on the remaining lanes
+	const __m128 from = _mm_set_ps(p[dy + 1], p[dy], p[1], p[0]);
+	const __m128 to = _mm_set_ps(p[dx + dy + 1], p[dx + dy], p[dx + 1], p[dx]);
+	const __m128 alongX = _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), _mm_set1_ps(fx)));
+	const __m128 upperY = _mm_movehl_ps(alongX, alongX);
+	const __m128 alongY = _mm_add_ps(alongX, _mm_mul_ps(_mm_sub_ps(upperY, alongX), _mm_set1_ps(fy)));
+	float lanes[4];
+	_mm_storeu_ps(lanes, alongY);
+	return lanes[0] + (lanes[1] - lanes[0]) * fz;
+#else
+	const float c00 = lerp(p[0], p[dx], fx);
+	const float c01 = lerp(p[1], p[dx + 1], fx);
+	const float c10 = lerp(p[dy], p[dx + dy], fx);
+	const float c11 = lerp(p[dy + 1], p[dx + dy + 1], fx);
+	return lerp(lerp(c00, c10, fy), lerp(c01, c11, fy), fz);
+#endif
+}
+
+// weak field is transparent blue, strong field is opaque red; stored premultiplied
+static void initTransfer() {
+	static const Color* gradient[] = { &colorBlue, &colorCyan, &colorGreen, &colorYellow, &colorRed };
+	static const int gradientLength = sizeof(gradient) / sizeof(gradient[0]);
+	int i;
+	for (i = 0; i < VOLUME_TRANSFER_SIZE; ++i) {
+		const float t = (float) i / (VOLUME_TRANSFER_SIZE - 1);
+		const float position = t * (gradientLength - 1);
+		const int index = clamp((int) position, 0, gradientLength - 2);
+		const float f = position - index;
+		const float alpha = t * t * VOLUME_OPACITY;
+		_transfer[i].r = lerp(gradient[index]->r, gradient[index + 1]->r, f) * alpha;
+		_transfer[i].g = lerp(gradient[index]->g, gradient[index + 1]->g, f) * alpha;
+		_transfer[i].b = lerp(gradient[index]->b, gradient[index + 1]->b, f) * alpha;
+		_transfer[i].a = alpha;
+	}
+}
+
+static inline int intersectGrid(const VolumeGrid* grid, Vector origin, Vector direction, double* tNear, double* tFar) {
+	const double size = (VOLUME_GRID_SIZE - 1) * grid->spacing;
+	const double from[3] = { origin.x - grid->origin.x, origin.y - grid->origin.y, origin.z - grid->origin.z };
+	const double along[3] = { direction.x, direction.y, direction.z };
+	int i;
+	*tNear = 0;
+	*tFar = 1.0e30;
+	for (i = 0; i < 3; ++i) {
+		if (fabs(along[i]) < 1.0e-12) {
+			if (from[i] < 0 || from[i] > size) {
+				return 0;
+			}
+			continue;
+		}
+		double t1 = -from[i] / along[i];
+		double t2 = (size - from[i]) / along[i];
+		if (t1 > t2) {
+			const double t = t1;
+			t1 = t2;
+			t2 = t;
+		}
+		*tNear = max(*tNear, t1);
+		*tFar = min(*tFar, t2);
+	}
+	return *tNear < *tFar;
+}
+
+static void renderTile(void* arg, size_t index) {
+	const VolumeFrame* frame = (const VolumeFrame*) arg;
+	const VolumeGrid* grid = frame->grid;
+	const int fromX = (int) (index % frame->tilesX) * VOLUME_TILE_SIZE;
+	const int fromY = (int) (index / frame->tilesX) * VOLUME_TILE_SIZE;
+	const int toX = min(fromX + VOLUME_TILE_SIZE, frame->width);
+	const int toY = min(fromY + VOLUME_TILE_SIZE, frame->height);
+	const double tanHalfFov = tan(M_PI / 6);
+	const double aspect = (double) frame->width / frame->height;
+	int x, y;
+	for (y = fromY; y < toY; ++y) {
+		for (x = fromX; x < toX; ++x) {
+			const double u = (2 * (x + 0.5) / frame->width - 1) * tanHalfFov * aspect;
+			const double v = (2 * (y + 0.5) / frame->height - 1) * tanHalfFov;
+			const Vector direction = vectorNormalize(vectorSum(frame->forward, vectorSum(vectorMultiply(frame->right, u), vectorMultiply(frame->up, v))));
+			float r = 0, g = 0, b = 0, a = 0;
+			double tNear, tFar;
+			if (intersectGrid(grid, frame->eye, direction, &tNear, &tFar)) {
+				const Vector start = vectorDivide(vectorSubstract(vectorSum(frame->eye, vectorMultiply(direction, tNear)), grid->origin), grid->spacing);
+				float px = (float) start.x;
+				float py = (float) start.y;
+				float pz = (float) start.z;
+				const float dx = (float) direction.x;
+				const float dy = (float) direction.y;
+				const float dz = (float) direction.z;
+				int steps = (int) ((tFar - tNear) / grid->spacing);
+
+				// one cell per step, front to back, stopping once the ray is practically opaque
+				for (; steps >= 0 && a < VOLUME_OPAQUE; --steps) {
+					const float level = sampleGrid(grid, px, py, pz);
+					const TransferEntry* entry = _transfer + clamp((int) (level * (VOLUME_TRANSFER_SIZE - 1)), 0, VOLUME_TRANSFER_SIZE - 1);
+					const float weight = 1 - a;
+					r += entry->r * weight;
+					g += entry->g * weight;
+					b += entry->b * weight;
+					a += entry->a * weight;
+					px += dx;
+					py += dy;
+					pz += dz;
+				}
+			}
+			unsigned char* pixel = frame->pixels + ((size_t) y * frame->width + x) * 4;
+			pixel[0] = (unsigned char) (min(r, 1.0f) * 255);
+			pixel[1] = (unsigned char) (min(g, 1.0f) * 255);
+			pixel[2] = (unsigned char) (min(b, 1.0f) * 255);
+			pixel[3] = 255;
+		}
+	}
+}
+
+int initVolume(ThreadPool* pool) {
+	_pool = pool;
+	_grid.levels = (float*) memoryAlloc(MEMORY_TAG_RENDERING, sizeof(float) * VOLUME_GRID_SIZE * VOLUME_GRID_SIZE * VOLUME_GRID_SIZE);
+	_grid.valid = 0;
+	initTransfer();
+	return _pool && _grid.levels;
+}
+
+void renderVolume(const RenderContext* context) {
+	const double startTime = getTimeDetailed();
+	const int width = max((int) context->windowSize.x / VOLUME_IMAGE_SCALE, 1);
+	const int height = max((int) context->windowSize.y / VOLUME_IMAGE_SCALE, 1);
+	if (width != _pixelsWidth || height != _pixelsHeight) {
+		_pixels = (unsigned char*) memoryRealloc(MEMORY_TAG_RENDERING, _pixels, (size_t) width * height * 4);
+		_pixelsWidth = width;
+		_pixelsHeight = height;
+	}
+	updateGrid(context);
+
+	VolumeFrame frame;
+	frame.grid = &_grid;
+	frame.pixels = _pixels;
+	frame.width = width;
+	frame.height = height;
+	frame.tilesX = (width + VOLUME_TILE_SIZE - 1) / VOLUME_TILE_SIZE;
+	frame.eye = context->camera.position;
+	frame.forward = vectorNormalize(context->camera.direction);
+	frame.right = vectorNormalize(vectorCrossProduct(frame.forward, vectorCreate(0, 1, 0)));
+	frame.up = vectorCrossProduct(frame.right, frame.forward);
+	const size_t tilesY = (height + VOLUME_TILE_SIZE - 1) / VOLUME_TILE_SIZE;
+	threadPoolParallelFor(_pool, frame.tilesX * tilesY, renderTile, &frame);
+
+	// upload and stretch over the window
+	if (!_texture) {
+		glGenTextures(1, &_texture);
+		glBindTexture(GL_TEXTURE_2D, _texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, _texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, _pixels);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_FOG);
+	glEnable(GL_TEXTURE_2D);
+	glColor3f(1, 1, 1);
+	glBegin(GL_QUADS);
+		glTexCoord2f(0, 0);
+		glVertex2d(0, 0);
+		glTexCoord2f(1, 0);
+		glVertex2d(context->windowSize.x, 0);
+		glTexCoord2f(1, 1);
+		glVertex2d(context->windowSize.x, context->windowSize.y);
+		glTexCoord2f(0, 1);
+		glVertex2d(0, context->windowSize.y);
+	glEnd();
+	glDisable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glEnable(GL_FOG);
+	glEnable(GL_DEPTH_TEST);
+	_renderTime = (float) (getTimeDetailed() - startTime);
+}
+
+float getVolumeRenderTime() {
+	return _renderTime;
+}
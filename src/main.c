@@ -19,8 +19,21 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "test/graphics/RenderEngine.h"
+#include "test/tools/FieldDaemon.h"
+#include "test/tools/FieldQuery.h"
+#include "test/physics/SceneKernel.h"
 
 int main(int argc, char **argv) {
+	int i;
+	for (i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--daemon")) {
+			return fieldDaemonMain(argc, argv, sceneKernelGetSpecialization());
+		} else if (!strcmp(argv[i], "--query")) {
+			return fieldQueryMain(argc, argv, sceneKernelGetSpecialization());
+		}
+	}
 	return renderEngineMain(argc, argv);
 }
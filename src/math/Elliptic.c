@@ -0,0 +1,77 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/math/Elliptic.h"
+
+#include <math.h>
+
+#define ELLIPTIC_MAX_ITERATIONS 16
+#define ELLIPTIC_TOLERANCE 1.0e-15
+#define ELLIPTIC_BLOCK 16
+
+// arithmetic-geometric mean, all lanes of a block step together so the loop bodies vectorize
+static void ellipticBlock(const double* m, double* K, double* D, size_t count) {
+	double a[ELLIPTIC_BLOCK], b[ELLIPTIC_BLOCK], sum[ELLIPTIC_BLOCK];
+	double power = 0.5;
+	size_t i;
+	int iteration;
+	for (i = 0; i < count; ++i) {
+		a[i] = 1;
+		b[i] = sqrt(1 - m[i]);
+		sum[i] = 0.5 * m[i];
+	}
+	for (iteration = 0; iteration < ELLIPTIC_MAX_ITERATIONS; ++iteration) {
+		double worst = 0;
+		power *= 2;
+		for (i = 0; i < count; ++i) {
+			const double c = 0.5 * (a[i] - b[i]);
+			const double nextA = 0.5 * (a[i] + b[i]);
+			b[i] = sqrt(a[i] * b[i]);
+			a[i] = nextA;
+			sum[i] += power * c * c;
+			worst = fmax(worst, fabs(c));
+		}
+		if (worst < ELLIPTIC_TOLERANCE) {
+			break;
+		}
+	}
+	// the sum is (K - E) / K, so D comes without the cancellation of subtracting E from K
+	for (i = 0; i < count; ++i) {
+		K[i] = M_PI_2 / a[i];
+		D[i] = K[i] * sum[i];
+	}
+}
+
+void ellipticIntegralsKD(const double* m, double* K, double* D, size_t count) {
+	size_t i;
+	for (i = 0; i < count; i += ELLIPTIC_BLOCK) {
+		const size_t blockCount = count - i < ELLIPTIC_BLOCK ? count - i : ELLIPTIC_BLOCK;
+		ellipticBlock(m + i, K + i, D + i, blockCount);
+	}
+}
+
+void ellipticIntegralsKE(const double* m, double* K, double* E, size_t count) {
+	size_t i;
+	ellipticIntegralsKD(m, K, E, count);
+	for (i = 0; i < count; ++i) {
+		E[i] = K[i] - E[i];
+	}
+}
@@ -0,0 +1,116 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/math/Fft.h"
+
+#include <math.h>
+
+#include "test/math/MathFunctions.h"
+#include "test/tools/MemoryStats.h"
+
+size_t fftGetPaddedLength(size_t length) {
+	size_t result = 1;
+	while (result < length) {
+		result <<= 1;
+	}
+	return result;
+}
+
+FftPlan* fftPlanNew(size_t length) {
+	size_t i, bits = 0;
+	if (!length || (length & (length - 1))) {
+		return NULL;
+	}
+	FftPlan* plan = (FftPlan*) memoryCalloc(MEMORY_TAG_FIELD_POINTS, 1, sizeof(FftPlan));
+	if (!plan) {
+		return NULL;
+	}
+	plan->length = length;
+	plan->twiddles = (double*) memoryAlloc(MEMORY_TAG_FIELD_POINTS, sizeof(double) * max(length, 2));
+	plan->reversed = (size_t*) memoryAlloc(MEMORY_TAG_FIELD_POINTS, sizeof(size_t) * length);
+	if (!plan->twiddles || !plan->reversed) {
+		fftPlanFree(plan);
+		return NULL;
+	}
+	for (i = 0; i < length / 2; ++i) {
+		plan->twiddles[2 * i] = cos(-2 * M_PI * i / length);
+		plan->twiddles[2 * i + 1] = sin(-2 * M_PI * i / length);
+	}
+	while (((size_t) 1 << bits) < length) {
+		++bits;
+	}
+	for (i = 0; i < length; ++i) {
+		size_t bit, reversed = 0;
+		for (bit = 0; bit < bits; ++bit) {
+			reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+		}
+		plan->reversed[i] = reversed;
+	}
+	return plan;
+}
+
+void fftPlanFree(FftPlan* plan) {
+	if (!plan) {
+		return;
+	}
+	memoryFree(MEMORY_TAG_FIELD_POINTS, plan->twiddles);
+	memoryFree(MEMORY_TAG_FIELD_POINTS, plan->reversed);
+	memoryFree(MEMORY_TAG_FIELD_POINTS, plan);
+}
+
+// iterative radix 2, every butterfly runs over all count sequences at once so strided passes walk memory in order
+void fftTransform(const FftPlan* plan, double* data, size_t stride, size_t count, int inverse) {
+	const size_t n = plan->length;
+	const double sign = inverse ? -1 : 1;
+	size_t i, j, half, start, k;
+	for (i = 0; i < n; ++i) {
+		const size_t reversed = plan->reversed[i];
+		if (reversed <= i) {
+			continue;
+		}
+		double* a = data + 2 * i * stride;
+		double* b = data + 2 * reversed * stride;
+		for (j = 0; j < 2 * count; ++j) {
+			const double t = a[j];
+			a[j] = b[j];
+			b[j] = t;
+		}
+	}
+	for (half = 1; half < n; half <<= 1) {
+		const size_t twiddleStep = n / (2 * half);
+		for (start = 0; start < n; start += 2 * half) {
+			for (k = 0; k < half; ++k) {
+				const double wr = plan->twiddles[2 * k * twiddleStep];
+				const double wi = sign * plan->twiddles[2 * k * twiddleStep + 1];
+				double* a = data + 2 * (start + k) * stride;
+				double* b = data + 2 * (start + k + half) * stride;
+				for (j = 0; j < count; ++j) {
+					const double br = b[2 * j] * wr - b[2 * j + 1] * wi;
+					const double bi = b[2 * j] * wi + b[2 * j + 1] * wr;
+					b[2 * j] = a[2 * j] - br;
+					b[2 * j + 1] = a[2 * j + 1] - bi;
+					a[2 * j] += br;
+					a[2 * j + 1] += bi;
+				}
+			}
+		}
+	}
+}
@@ -109,8 +109,8 @@ Vector vectorRotate(Vector a, Vector rotation) {
 Vector vectorLerp(Vector from, Vector to, double time) {
 	Vector result = {
 			lerp(from.x, to.x, time),
-			lerp(from.x, to.y, time),
-			lerp(from.x, to.z, time)
+			lerp(from.y, to.y, time),
+			lerp(from.z, to.z, time)
 	};
 	return result;
 }
\ No newline at end of file
@@ -0,0 +1,339 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/physics/FieldScene.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "test/tools/FieldCache.h"
+#include "test/tools/FieldChunk.h"
+#include "test/tools/MemoryStats.h"
+
+#define FIELD_SCENE_LINE 1024
+
+struct FieldScene {
+	FieldSourceSet* sources;
+	unsigned long generation;
+	const FieldSceneSpecialization* specialization;
+	int specialized;
+	pthread_rwlock_t lock;
+};
+
+// must be called with the scene locked for writing
+static void onSourcesChanged(FieldScene* scene) {
+	++scene->generation;
+	scene->specialized = scene->specialization && scene->specialization->matches(scene->sources);
+}
+
+FieldScene* fieldSceneNew() {
+	FieldScene* scene = (FieldScene*) memoryAlloc(MEMORY_TAG_SOURCES, sizeof(FieldScene));
+	if (scene == NULL) {
+		return NULL;
+	}
+	scene->sources = fieldSourceSetNew();
+	if (scene->sources == NULL) {
+		memoryFree(MEMORY_TAG_SOURCES, scene);
+		return NULL;
+	}
+	scene->generation = 0;
+	scene->specialization = NULL;
+	scene->specialized = 0;
+	pthread_rwlock_init(&scene->lock, NULL);
+	return scene;
+}
+
+void fieldSceneFree(FieldScene* scene) {
+	if (scene == NULL) {
+		return;
+	}
+	pthread_rwlock_destroy(&scene->lock);
+	fieldSourceSetFree(scene->sources);
+	memoryFree(MEMORY_TAG_SOURCES, scene);
+}
+
+void fieldSceneAddDefaultSources(FieldScene* scene) {
+	static const Conductor conductors[] = {
+		{ .position = { 12, -12, -12 }, .I = 6000, .permeability = 2.5 * 1.0e-1, .l = { 4, 0.6, 0.6 } },
+		{ .position = { 12, 12, -12 }, .I = 3000, .permeability = 2.5 * 1.0e-1, .l = { 4, 0.4, 0.4 } },
+		{ .position = { 12, 12, 12 }, .I = 9000, .permeability = 2.5 * 1.0e-1, .l = { 4, 0.9, 0.9 } },
+		{ .position = { 12, -12, 12 }, .I = 1000, .permeability = 2.5 * 1.0e-1, .l = { 4, 0.3, 0.3 } }
+	};
+	size_t i;
+	for (i = 0; i < sizeof(conductors) / sizeof(conductors[0]); ++i) {
+		FieldSource source = { .type = FIELD_SOURCE_ELEMENT };
+		source.element = conductors[i];
+		fieldSceneAddSource(scene, &source);
+	}
+}
+
+// parses every source of the file into loaded, returns 0 after printing the first offending line
+static int parseSources(FieldSourceSet* loaded, FILE* file, const char* name) {
+	char line[FIELD_SCENE_LINE];
+	unsigned long lineNumber = 0;
+	while (fgets(line, sizeof(line), file)) {
+		++lineNumber;
+		line[strcspn(line, "\r\n")] = '\0';
+		char* comment = strchr(line, '#');
+		if (comment) {
+			*comment = '\0';
+		}
+		char* cursor = line + strspn(line, " \t\r\n");
+		if (!*cursor) {
+			continue;
+		}
+		const size_t nameLength = strcspn(cursor, " \t\r\n");
+		FieldSource source;
+		int type;
+		memset(&source, 0, sizeof(source));
+		for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+			const char* typeName = fieldSourceGetTypeName((FieldSourceType) type);
+			if (strlen(typeName) == nameLength && !strncmp(cursor, typeName, nameLength)) {
+				break;
+			}
+		}
+		if (type == FIELD_SOURCE_TYPE_COUNT) {
+			fprintf(stderr, "error: %s:%lu: unknown source type %.*s: %s\n",
+				name ? name : "scene", lineNumber, (int) nameLength, cursor, line);
+			return 0;
+		}
+
+		// every source struct is a run of doubles, so the numbers fill it in declaration order
+		double* values = (double*) &source.element;
+		const size_t valueCount = fieldSourceGetTypeSize((FieldSourceType) type) / sizeof(double);
+		size_t i;
+		cursor += nameLength;
+		for (i = 0; i < valueCount; ++i) {
+			char* end;
+			values[i] = strtod(cursor, &end);
+			if (end == cursor) {
+				break;
+			}
+			cursor = end;
+		}
+		if (i < valueCount || cursor[strspn(cursor, " \t\r\n")]) {
+			fprintf(stderr, "error: %s:%lu: expected %s and %lu numbers: %s\n",
+				name ? name : "scene", lineNumber, fieldSourceGetTypeName((FieldSourceType) type), (unsigned long) valueCount, line);
+			return 0;
+		}
+		source.type = (FieldSourceType) type;
+		fieldSourceSetAdd(loaded, &source);
+	}
+	return 1;
+}
+
+int fieldSceneLoad(FieldScene* scene, FILE* file, const char* name) {
+	FieldSource source;
+	int type;
+	size_t i;
+	if (scene == NULL || file == NULL) {
+		return -1;
+	}
+	FieldSourceSet* loaded = fieldSourceSetNew();
+	if (loaded == NULL) {
+		return -1;
+	}
+	// nothing reaches the scene unless the whole file parses
+	if (!parseSources(loaded, file, name)) {
+		fieldSourceSetFree(loaded);
+		return -1;
+	}
+	const int added = (int) fieldSourceSetGetTotalCount(loaded);
+	pthread_rwlock_wrlock(&scene->lock);
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		for (i = 0; fieldSourceSetGet(loaded, (FieldSourceType) type, i, &source); ++i) {
+			fieldSourceSetAdd(scene->sources, &source);
+		}
+	}
+	onSourcesChanged(scene);
+	pthread_rwlock_unlock(&scene->lock);
+	fieldSourceSetFree(loaded);
+	return added;
+}
+
+int fieldSceneLoadFile(FieldScene* scene, const char* path) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "error: Can't open %s\n", path);
+		return -1;
+	}
+	const int result = fieldSceneLoad(scene, file, path);
+	fclose(file);
+	return result;
+}
+
+void fieldSceneSetSpecialization(FieldScene* scene, const FieldSceneSpecialization* specialization) {
+	if (scene == NULL) {
+		return;
+	}
+	pthread_rwlock_wrlock(&scene->lock);
+	scene->specialization = specialization;
+	scene->specialized = specialization && specialization->matches(scene->sources);
+	pthread_rwlock_unlock(&scene->lock);
+}
+
+const char* fieldSceneGetSpecialization(FieldScene* scene) {
+	if (scene == NULL) {
+		return NULL;
+	}
+	pthread_rwlock_rdlock(&scene->lock);
+	const char* result = scene->specialized ? scene->specialization->name : NULL;
+	pthread_rwlock_unlock(&scene->lock);
+	return result;
+}
+
+size_t fieldSceneAddSource(FieldScene* scene, const FieldSource* source) {
+	if (scene == NULL || source == NULL) {
+		return 0;
+	}
+	pthread_rwlock_wrlock(&scene->lock);
+	const size_t result = fieldSourceSetAdd(scene->sources, source);
+	onSourcesChanged(scene);
+	pthread_rwlock_unlock(&scene->lock);
+	return result;
+}
+
+int fieldSceneUpdateSource(FieldScene* scene, size_t index, const FieldSource* source, FieldSource* previous) {
+	FieldSource stored;
+	if (scene == NULL || source == NULL) {
+		return 0;
+	}
+	pthread_rwlock_wrlock(&scene->lock);
+	const int found = fieldSourceSetGet(scene->sources, source->type, index, &stored) && fieldSourceSetUpdate(scene->sources, index, source);
+	if (found) {
+		onSourcesChanged(scene);
+		if (previous) {
+			*previous = stored;
+		}
+	}
+	pthread_rwlock_unlock(&scene->lock);
+	return found;
+}
+
+int fieldSceneRemoveSource(FieldScene* scene, FieldSourceType type, size_t index, FieldSource* previous) {
+	FieldSource stored;
+	if (scene == NULL) {
+		return 0;
+	}
+	pthread_rwlock_wrlock(&scene->lock);
+	const int found = fieldSourceSetGet(scene->sources, type, index, &stored) && fieldSourceSetRemove(scene->sources, type, index);
+	if (found) {
+		onSourcesChanged(scene);
+		if (previous) {
+			*previous = stored;
+		}
+	}
+	pthread_rwlock_unlock(&scene->lock);
+	return found;
+}
+
+int fieldSceneGetSource(FieldScene* scene, FieldSourceType type, size_t index, FieldSource* result) {
+	if (scene == NULL) {
+		return 0;
+	}
+	pthread_rwlock_rdlock(&scene->lock);
+	const int found = fieldSourceSetGet(scene->sources, type, index, result);
+	pthread_rwlock_unlock(&scene->lock);
+	return found;
+}
+
+size_t fieldSceneGetSourceCount(FieldScene* scene, FieldSourceType type) {
+	if (scene == NULL) {
+		return 0;
+	}
+	pthread_rwlock_rdlock(&scene->lock);
+	const size_t result = type < FIELD_SOURCE_TYPE_COUNT ? fieldSourceSetGetCount(scene->sources, type) : fieldSourceSetGetTotalCount(scene->sources);
+	pthread_rwlock_unlock(&scene->lock);
+	return result;
+}
+
+FieldSourceSet* fieldSceneCopySources(FieldScene* scene) {
+	if (scene == NULL) {
+		return NULL;
+	}
+	pthread_rwlock_rdlock(&scene->lock);
+	FieldSourceSet* result = fieldSourceSetCopy(scene->sources);
+	pthread_rwlock_unlock(&scene->lock);
+	return result;
+}
+
+unsigned long fieldSceneGetGeneration(FieldScene* scene) {
+	if (scene == NULL) {
+		return 0;
+	}
+	pthread_rwlock_rdlock(&scene->lock);
+	const unsigned long result = scene->generation;
+	pthread_rwlock_unlock(&scene->lock);
+	return result;
+}
+
+uint64_t fieldSceneGetHash(FieldScene* scene, uint64_t seed) {
+	int type;
+	if (scene == NULL) {
+		return seed;
+	}
+	pthread_rwlock_rdlock(&scene->lock);
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		seed = fieldCacheHash(seed, &type, sizeof(type));
+		seed = fieldCacheHash(seed, scene->sources->sources[type], fieldSourceGetTypeSize((FieldSourceType) type) * scene->sources->counts[type]);
+	}
+	pthread_rwlock_unlock(&scene->lock);
+	return seed;
+}
+
+uint64_t fieldSceneGetChunkHash(FieldScene* scene) {
+	static const int cellStep = FIELD_CELL_STEP;
+	return fieldSceneGetHash(scene, fieldCacheHash(0, &cellStep, sizeof(cellStep)));
+}
+
+void fieldSceneEvaluate(FieldScene* scene, const Vector* positions, Vector* results, size_t count) {
+	if (scene == NULL) {
+		return;
+	}
+	pthread_rwlock_rdlock(&scene->lock);
+	if (scene->specialized) {
+		scene->specialization->evaluate(positions, results, count);
+	} else {
+		fieldSourceSetEvaluate(scene->sources, positions, results, count);
+	}
+	pthread_rwlock_unlock(&scene->lock);
+}
+
+void fieldSceneEvaluateChunk(FieldScene* scene, uint64_t chunkKey, Vector* results) {
+	Vector positions[FIELD_CHUNK_CELLS];
+	int chunkX, chunkY, chunkZ, x, y, z;
+	fieldChunkFromKey(chunkKey, &chunkX, &chunkY, &chunkZ);
+	for (x = 0; x < FIELD_CHUNK_SIZE; ++x) {
+		for (y = 0; y < FIELD_CHUNK_SIZE; ++y) {
+			for (z = 0; z < FIELD_CHUNK_SIZE; ++z) {
+				const size_t index = (x * FIELD_CHUNK_SIZE + y) * FIELD_CHUNK_SIZE + z;
+				positions[index] = vectorCreate(
+					(chunkX * FIELD_CHUNK_SIZE + x) * FIELD_CELL_STEP,
+					(chunkY * FIELD_CHUNK_SIZE + y) * FIELD_CELL_STEP,
+					(chunkZ * FIELD_CHUNK_SIZE + z) * FIELD_CELL_STEP
+				);
+				results[index] = vectorZero;
+			}
+		}
+	}
+	fieldSceneEvaluate(scene, positions, results, FIELD_CHUNK_CELLS);
+}
@@ -0,0 +1,321 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/physics/FieldSource.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "test/physics/electromagnetism.h"
+#include "test/math/Elliptic.h"
+#include "test/math/MathFunctions.h"
+#include "test/tools/MemoryStats.h"
+
+#define FIELD_LOOP_BLOCK 64
+#define FIELD_SINGULAR_EPSILON 1.0e-12
+
+typedef struct FieldSourceKind {
+	const char* name;
+	size_t size;
+	FieldSourceKernel kernel;
+} FieldSourceKind;
+
+static void evaluateElements(const void* sources, size_t sourceCount, double scale, const Vector* positions, Vector* results, size_t count) {
+	const Conductor* elements = (const Conductor*) sources;
+	size_t i;
+	for (i = 0; i < sourceCount; ++i) {
+		calculateMagneticFieldPoints(scale * elements[i].I, elements[i].permeability, elements[i].l, elements[i].position, positions, results, count);
+	}
+}
+
+// B = mu I / 4pi * (r1 x r2) (|r1| + |r2|) / (|r1| |r2| (|r1| |r2| + r1 . r2)), r1 and r2 point from the ends to the sample
+static inline void accumulateSegment(double ax, double ay, double az, double bx, double by, double bz, double constant, const Vector* positions, Vector* results, size_t count) {
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		const double r1x = positions[i].x - ax;
+		const double r1y = positions[i].y - ay;
+		const double r1z = positions[i].z - az;
+		const double r2x = positions[i].x - bx;
+		const double r2y = positions[i].y - by;
+		const double r2z = positions[i].z - bz;
+		const double r1Len = sqrt(r1x * r1x + r1y * r1y + r1z * r1z);
+		const double r2Len = sqrt(r2x * r2x + r2y * r2y + r2z * r2z);
+		const double denominator = r1Len * r2Len * (r1Len * r2Len + r1x * r2x + r1y * r2y + r1z * r2z);
+		if (denominator < FIELD_SINGULAR_EPSILON) {
+			continue; // on the wire
+		}
+		const double k = constant * (r1Len + r2Len) / denominator;
+		results[i].x += (r1y * r2z - r1z * r2y) * k;
+		results[i].y += (r1z * r2x - r1x * r2z) * k;
+		results[i].z += (r1x * r2y - r1y * r2x) * k;
+	}
+}
+
+static void evaluateSegments(const void* sources, size_t sourceCount, double scale, const Vector* positions, Vector* results, size_t count) {
+	const FieldSegment* segments = (const FieldSegment*) sources;
+	size_t i;
+	for (i = 0; i < sourceCount; ++i) {
+		const FieldSegment* s = segments + i;
+		accumulateSegment(s->start.x, s->start.y, s->start.z, s->end.x, s->end.y, s->end.z, scale * s->permeability / (4 * M_PI) * s->I, positions, results, count);
+	}
+}
+
+// exact field of a circular loop in its cylindrical frame (rho, z), with alpha^2 = a^2 + rho^2 + z^2 - 2 a rho,
+// beta^2 = a^2 + rho^2 + z^2 + 2 a rho and m = 1 - alpha^2 / beta^2:
+// B_rho = mu I / pi * z / (2 alpha^2 beta rho) * ((a^2 + rho^2 + z^2) E(m) - alpha^2 K(m))
+// B_z = mu I / pi / (2 alpha^2 beta) * ((a^2 - rho^2 - z^2) E(m) + alpha^2 K(m))
+// Both brackets cancel to leading order near the axis and far away, so they are rewritten with D = K - E:
+// (a^2 + rho^2 + z^2) E - alpha^2 K = 2 a rho K - (a^2 + rho^2 + z^2) D
+// (a^2 - rho^2 - z^2) E + alpha^2 K = 2 a (a - rho) K - (a^2 - rho^2 - z^2) D
+static void evaluateLoops(const void* sources, size_t sourceCount, double scale, const Vector* positions, Vector* results, size_t count) {
+	const FieldLoop* loops = (const FieldLoop*) sources;
+	double rho[FIELD_LOOP_BLOCK], z[FIELD_LOOP_BLOCK], alphaSq[FIELD_LOOP_BLOCK], beta[FIELD_LOOP_BLOCK];
+	double m[FIELD_LOOP_BLOCK], K[FIELD_LOOP_BLOCK], D[FIELD_LOOP_BLOCK];
+	Vector radial[FIELD_LOOP_BLOCK];
+	size_t i, from, j;
+	for (i = 0; i < sourceCount; ++i) {
+		const FieldLoop* loop = loops + i;
+		const Vector normal = vectorNormalize(loop->normal);
+		const double a = loop->radius;
+		const double constant = scale * loop->permeability * loop->I / M_PI;
+		for (from = 0; from < count; from += FIELD_LOOP_BLOCK) {
+			const size_t blockCount = min(count - from, FIELD_LOOP_BLOCK);
+			for (j = 0; j < blockCount; ++j) {
+				const double dx = positions[from + j].x - loop->center.x;
+				const double dy = positions[from + j].y - loop->center.y;
+				const double dz = positions[from + j].z - loop->center.z;
+				z[j] = dx * normal.x + dy * normal.y + dz * normal.z;
+				radial[j].x = dx - normal.x * z[j];
+				radial[j].y = dy - normal.y * z[j];
+				radial[j].z = dz - normal.z * z[j];
+				rho[j] = sqrt(radial[j].x * radial[j].x + radial[j].y * radial[j].y + radial[j].z * radial[j].z);
+				const double common = a * a + rho[j] * rho[j] + z[j] * z[j];
+				alphaSq[j] = common - 2 * a * rho[j];
+				const double betaSq = common + 2 * a * rho[j];
+				beta[j] = sqrt(betaSq);
+				// beta^2 - alpha^2 = 4 a rho, which keeps m accurate near the axis
+				m[j] = alphaSq[j] > FIELD_SINGULAR_EPSILON ? 4 * a * rho[j] / betaSq : 0;
+			}
+			ellipticIntegralsKD(m, K, D, blockCount);
+			for (j = 0; j < blockCount; ++j) {
+				if (alphaSq[j] < FIELD_SINGULAR_EPSILON) {
+					continue; // on the wire
+				}
+				const double common = a * a + rho[j] * rho[j] + z[j] * z[j];
+				const double k = constant / (2 * alphaSq[j] * beta[j]);
+				const double bz = k * (2 * a * (a - rho[j]) * K[j] - (a * a - rho[j] * rho[j] - z[j] * z[j]) * D[j]);
+				// radial is rho long, so the 1 / rho of B_rho turns into 1 / rho^2
+				const double bRho = rho[j] > FIELD_SINGULAR_EPSILON ? k * z[j] * (2 * a * rho[j] * K[j] - common * D[j]) / (rho[j] * rho[j]) : 0;
+				results[from + j].x += normal.x * bz + radial[j].x * bRho;
+				results[from + j].y += normal.y * bz + radial[j].y * bRho;
+				results[from + j].z += normal.z * bz + radial[j].z * bRho;
+			}
+		}
+	}
+}
+
+// B = mu / 4pi * (3 r (m . r) / r^5 - m / r^3)
+static void evaluateDipoles(const void* sources, size_t sourceCount, double scale, const Vector* positions, Vector* results, size_t count) {
+	const FieldDipole* dipoles = (const FieldDipole*) sources;
+	size_t i, j;
+	for (i = 0; i < sourceCount; ++i) {
+		const FieldDipole* d = dipoles + i;
+		const double constant = scale * d->permeability / (4 * M_PI);
+		for (j = 0; j < count; ++j) {
+			const double rx = positions[j].x - d->position.x;
+			const double ry = positions[j].y - d->position.y;
+			const double rz = positions[j].z - d->position.z;
+			const double rLenSq = rx * rx + ry * ry + rz * rz;
+			if (rLenSq < FIELD_SINGULAR_EPSILON) {
+				continue;
+			}
+			const double rInv3 = 1 / (rLenSq * sqrt(rLenSq));
+			const double k = 3 * (d->moment.x * rx + d->moment.y * ry + d->moment.z * rz) / rLenSq;
+			results[j].x += constant * rInv3 * (k * rx - d->moment.x);
+			results[j].y += constant * rInv3 * (k * ry - d->moment.y);
+			results[j].z += constant * rInv3 * (k * rz - d->moment.z);
+		}
+	}
+}
+
+// B = mu / 4pi * q (v x r) / r^3
+static void evaluateCharges(const void* sources, size_t sourceCount, double scale, const Vector* positions, Vector* results, size_t count) {
+	const FieldCharge* charges = (const FieldCharge*) sources;
+	size_t i, j;
+	for (i = 0; i < sourceCount; ++i) {
+		const FieldCharge* c = charges + i;
+		const double constant = scale * c->permeability / (4 * M_PI) * c->q;
+		const Vector v = c->velocity;
+		for (j = 0; j < count; ++j) {
+			const double rx = positions[j].x - c->position.x;
+			const double ry = positions[j].y - c->position.y;
+			const double rz = positions[j].z - c->position.z;
+			const double rLenSq = rx * rx + ry * ry + rz * rz;
+			if (rLenSq < FIELD_SINGULAR_EPSILON) {
+				continue;
+			}
+			const double k = constant / (rLenSq * sqrt(rLenSq));
+			results[j].x += (v.y * rz - v.z * ry) * k;
+			results[j].y += (v.z * rx - v.x * rz) * k;
+			results[j].z += (v.x * ry - v.y * rx) * k;
+		}
+	}
+}
+
+static const FieldSourceKind _kinds[FIELD_SOURCE_TYPE_COUNT] = {
+	{ "element", sizeof(Conductor), evaluateElements },
+	{ "segment", sizeof(FieldSegment), evaluateSegments },
+	{ "loop", sizeof(FieldLoop), evaluateLoops },
+	{ "dipole", sizeof(FieldDipole), evaluateDipoles },
+	{ "charge", sizeof(FieldCharge), evaluateCharges }
+};
+
+static inline const void* getSourceData(const FieldSource* source) {
+	return &source->element; // every member of the union starts at the same address
+}
+
+const char* fieldSourceGetTypeName(FieldSourceType type) {
+	return type < FIELD_SOURCE_TYPE_COUNT ? _kinds[type].name : NULL;
+}
+
+size_t fieldSourceGetTypeSize(FieldSourceType type) {
+	return type < FIELD_SOURCE_TYPE_COUNT ? _kinds[type].size : 0;
+}
+
+FieldSourceKernel fieldSourceGetKernel(FieldSourceType type) {
+	return type < FIELD_SOURCE_TYPE_COUNT ? _kinds[type].kernel : NULL;
+}
+
+void fieldSourceEvaluate(const FieldSource* source, double scale, const Vector* positions, Vector* results, size_t count) {
+	if (source == NULL || source->type >= FIELD_SOURCE_TYPE_COUNT) {
+		return;
+	}
+	_kinds[source->type].kernel(getSourceData(source), 1, scale, positions, results, count);
+}
+
+FieldSourceSet* fieldSourceSetNew() {
+	FieldSourceSet* set = (FieldSourceSet*) memoryCalloc(MEMORY_TAG_SOURCES, 1, sizeof(FieldSourceSet));
+	return set;
+}
+
+void fieldSourceSetFree(FieldSourceSet* set) {
+	if (set == NULL) {
+		return;
+	}
+	size_t type;
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		memoryFree(MEMORY_TAG_SOURCES, set->sources[type]);
+	}
+	memoryFree(MEMORY_TAG_SOURCES, set);
+}
+
+FieldSourceSet* fieldSourceSetCopy(const FieldSourceSet* set) {
+	if (set == NULL) {
+		return NULL;
+	}
+	FieldSourceSet* result = fieldSourceSetNew();
+	size_t type;
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		if (!set->counts[type]) {
+			continue;
+		}
+		result->sources[type] = memoryAlloc(MEMORY_TAG_SOURCES, _kinds[type].size * set->counts[type]);
+		memcpy(result->sources[type], set->sources[type], _kinds[type].size * set->counts[type]);
+		result->counts[type] = set->counts[type];
+		result->capacities[type] = set->counts[type];
+	}
+	return result;
+}
+
+size_t fieldSourceSetGetCount(const FieldSourceSet* set, FieldSourceType type) {
+	if (set == NULL || type >= FIELD_SOURCE_TYPE_COUNT) {
+		return 0;
+	}
+	return set->counts[type];
+}
+
+size_t fieldSourceSetGetTotalCount(const FieldSourceSet* set) {
+	if (set == NULL) {
+		return 0;
+	}
+	size_t type, result = 0;
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		result += set->counts[type];
+	}
+	return result;
+}
+
+size_t fieldSourceSetAdd(FieldSourceSet* set, const FieldSource* source) {
+	if (set == NULL || source == NULL || source->type >= FIELD_SOURCE_TYPE_COUNT) {
+		return 0;
+	}
+	const FieldSourceType type = source->type;
+	const size_t size = _kinds[type].size;
+	if (set->counts[type] == set->capacities[type]) {
+		set->capacities[type] = set->capacities[type] * 2 + 4;
+		set->sources[type] = memoryRealloc(MEMORY_TAG_SOURCES, set->sources[type], size * set->capacities[type]);
+	}
+	memcpy((char*) set->sources[type] + size * set->counts[type], getSourceData(source), size);
+	return set->counts[type]++;
+}
+
+int fieldSourceSetGet(const FieldSourceSet* set, FieldSourceType type, size_t index, FieldSource* result) {
+	if (set == NULL || type >= FIELD_SOURCE_TYPE_COUNT || index >= set->counts[type]) {
+		return 0;
+	}
+	result->type = type;
+	memcpy(&result->element, (const char*) set->sources[type] + _kinds[type].size * index, _kinds[type].size);
+	return 1;
+}
+
+int fieldSourceSetUpdate(FieldSourceSet* set, size_t index, const FieldSource* source) {
+	if (set == NULL || source == NULL || source->type >= FIELD_SOURCE_TYPE_COUNT || index >= set->counts[source->type]) {
+		return 0;
+	}
+	const size_t size = _kinds[source->type].size;
+	memcpy((char*) set->sources[source->type] + size * index, getSourceData(source), size);
+	return 1;
+}
+
+int fieldSourceSetRemove(FieldSourceSet* set, FieldSourceType type, size_t index) {
+	if (set == NULL || type >= FIELD_SOURCE_TYPE_COUNT || index >= set->counts[type]) {
+		return 0;
+	}
+	// keeps the order, so indices of the other sources of this type stay meaningful to the caller
+	const size_t size = _kinds[type].size;
+	char* data = (char*) set->sources[type];
+	memmove(data + size * index, data + size * (index + 1), size * (set->counts[type] - index - 1));
+	--set->counts[type];
+	return 1;
+}
+
+void fieldSourceSetEvaluate(const FieldSourceSet* set, const Vector* positions, Vector* results, size_t count) {
+	if (set == NULL) {
+		return;
+	}
+	size_t type;
+	for (type = 0; type < FIELD_SOURCE_TYPE_COUNT; ++type) {
+		if (set->counts[type]) {
+			_kinds[type].kernel(set->sources[type], set->counts[type], 1, positions, results, count);
+		}
+	}
+}
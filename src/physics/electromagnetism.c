@@ -42,3 +42,22 @@ Vector calculateMagneticFieldPoint(double I, double permeability, Vector l, Vect
 	const double r1Len = sqrt(r1LenSq);
 	return vectorMultiply(vectorCrossProduct(l, r1), constant * I / r1LenSq / r1Len);
 }
+
+void calculateMagneticFieldPoints(double I, double permeability, Vector l, Vector origin, const Vector* positions, Vector* results, size_t count) {
+	// accumulates into results, so pass -I to take the contribution away
+	const double constant = permeability / (4 * M_PI) * I;
+	const double ox = origin.x + l.x;
+	const double oy = origin.y + l.y;
+	const double oz = origin.z + l.z;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		const double rx = positions[i].x - ox;
+		const double ry = positions[i].y - oy;
+		const double rz = positions[i].z - oz;
+		const double rLenSq = rx * rx + ry * ry + rz * rz;
+		const double k = constant / (rLenSq * sqrt(rLenSq));
+		results[i].x += (l.y * rz - l.z * ry) * k;
+		results[i].y += (l.z * rx - l.x * rz) * k;
+		results[i].z += (l.x * ry - l.y * rx) * k;
+	}
+}
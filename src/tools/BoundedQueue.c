@@ -0,0 +1,105 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/BoundedQueue.h"
+
+#include "test/tools/MemoryStats.h"
+
+BoundedQueue* boundedQueueNew(size_t capacity) {
+	if (!capacity) {
+		return NULL;
+	}
+	BoundedQueue* queue = (BoundedQueue*) memoryCalloc(MEMORY_TAG_COLLECTIONS, 1, sizeof(BoundedQueue));
+	if (queue == NULL) {
+		return NULL;
+	}
+	queue->items = (void**) memoryAlloc(MEMORY_TAG_COLLECTIONS, sizeof(void*) * capacity);
+	if (queue->items == NULL) {
+		memoryFree(MEMORY_TAG_COLLECTIONS, queue);
+		return NULL;
+	}
+	queue->capacity = capacity;
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->notEmpty, NULL);
+	pthread_cond_init(&queue->notFull, NULL);
+	return queue;
+}
+
+void boundedQueueFree(BoundedQueue* queue) {
+	if (queue == NULL) {
+		return;
+	}
+	pthread_cond_destroy(&queue->notFull);
+	pthread_cond_destroy(&queue->notEmpty);
+	pthread_mutex_destroy(&queue->mutex);
+	memoryFree(MEMORY_TAG_COLLECTIONS, queue->items);
+	memoryFree(MEMORY_TAG_COLLECTIONS, queue);
+}
+
+int boundedQueuePush(BoundedQueue* queue, void* item) {
+	if (queue == NULL) {
+		return 0;
+	}
+	pthread_mutex_lock(&queue->mutex);
+	while (queue->count == queue->capacity && !queue->closed) {
+		pthread_cond_wait(&queue->notFull, &queue->mutex);
+	}
+	if (queue->closed) {
+		pthread_mutex_unlock(&queue->mutex);
+		return 0;
+	}
+	queue->items[(queue->head + queue->count) % queue->capacity] = item;
+	++queue->count;
+	pthread_cond_signal(&queue->notEmpty);
+	pthread_mutex_unlock(&queue->mutex);
+	return 1;
+}
+
+int boundedQueuePop(BoundedQueue* queue, void** item) {
+	if (queue == NULL) {
+		return 0;
+	}
+	pthread_mutex_lock(&queue->mutex);
+	while (!queue->count && !queue->closed) {
+		pthread_cond_wait(&queue->notEmpty, &queue->mutex);
+	}
+	if (!queue->count) {
+		pthread_mutex_unlock(&queue->mutex);
+		return 0;
+	}
+	*item = queue->items[queue->head];
+	queue->head = (queue->head + 1) % queue->capacity;
+	--queue->count;
+	pthread_cond_signal(&queue->notFull);
+	pthread_mutex_unlock(&queue->mutex);
+	return 1;
+}
+
+void boundedQueueClose(BoundedQueue* queue) {
+	if (queue == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&queue->mutex);
+	queue->closed = 1;
+	pthread_cond_broadcast(&queue->notEmpty);
+	pthread_cond_broadcast(&queue->notFull);
+	pthread_mutex_unlock(&queue->mutex);
+}
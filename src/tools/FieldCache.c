@@ -0,0 +1,199 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/FieldCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "test/tools/MemoryStats.h"
+
+#define FIELD_CACHE_VERSION 2
+#define FIELD_CACHE_PROBES 8
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static const char _magic[4] = { 'M', 'T', 'F', 'C' };
+
+static inline uint64_t getRecordChecksum(const FieldCacheRecord* record) {
+	uint64_t hash = fieldCacheHash(FNV_OFFSET, &record->sceneHash, sizeof(uint64_t) * 3);
+	return fieldCacheHash(hash, record->samples, sizeof(record->samples));
+}
+
+uint64_t fieldCacheHash(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*) data;
+	size_t i;
+	if (!hash) {
+		hash = FNV_OFFSET;
+	}
+	for (i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+FieldCache* fieldCacheOpen(const char* path, size_t maxBytes) {
+	const size_t recordCount = maxBytes > sizeof(FieldCacheHeader) ? (maxBytes - sizeof(FieldCacheHeader)) / sizeof(FieldCacheRecord) : 0;
+	if (!path || !recordCount) {
+		return NULL;
+	}
+	const size_t size = sizeof(FieldCacheHeader) + recordCount * sizeof(FieldCacheRecord);
+
+	// another instance owns the file, run without the cache
+	const int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (flock(fd, LOCK_EX | LOCK_NB)) {
+		close(fd);
+		return NULL;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) || ((size_t) fileStat.st_size != size && ftruncate(fd, (off_t) size))) {
+		close(fd);
+		return NULL;
+	}
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+
+	memoryTrack(MEMORY_TAG_MAPPED, (int64_t) size);
+	FieldCache* result = (FieldCache*) calloc(1, sizeof(FieldCache));
+	result->fd = fd;
+	result->size = size;
+	result->header = (FieldCacheHeader*) data;
+	result->records = (FieldCacheRecord*) ((char*) data + sizeof(FieldCacheHeader));
+	result->dirty = (unsigned char*) calloc(recordCount, 1);
+
+	// start over when the layout differs, otherwise drop every record which fails its checksum
+	FieldCacheHeader* header = result->header;
+	if (memcmp(header->magic, _magic, sizeof(_magic)) || header->version != FIELD_CACHE_VERSION ||
+		header->recordSize != sizeof(FieldCacheRecord) || header->recordCount != recordCount) {
+		memset(data, 0, size);
+		memcpy(header->magic, _magic, sizeof(_magic));
+		header->version = FIELD_CACHE_VERSION;
+		header->recordSize = sizeof(FieldCacheRecord);
+		header->recordCount = (uint32_t) recordCount;
+	} else {
+		size_t i;
+		for (i = 0; i < recordCount; ++i) {
+			FieldCacheRecord* record = result->records + i;
+			if (record->mask && record->checksum != getRecordChecksum(record)) {
+				memset(record, 0, sizeof(FieldCacheRecord));
+				++result->corrupted;
+			}
+		}
+	}
+	return result;
+}
+
+void fieldCacheSync(FieldCache* cache) {
+	if (!cache) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < cache->header->recordCount; ++i) {
+		if (cache->dirty[i]) {
+			cache->records[i].checksum = getRecordChecksum(cache->records + i);
+			cache->dirty[i] = 0;
+		}
+	}
+	msync(cache->header, cache->size, MS_ASYNC);
+}
+
+void fieldCacheClose(FieldCache* cache) {
+	if (!cache) {
+		return;
+	}
+	fieldCacheSync(cache);
+	munmap(cache->header, cache->size);
+	memoryTrack(MEMORY_TAG_MAPPED, -(int64_t) cache->size);
+	flock(cache->fd, LOCK_UN);
+	close(cache->fd);
+	free(cache->dirty);
+	free(cache);
+}
+
+static FieldCacheRecord* findRecord(FieldCache* cache, uint64_t sceneHash, uint64_t chunkKey, int create) {
+	const uint32_t recordCount = cache->header->recordCount;
+	const uint64_t hash = fieldCacheHash(fieldCacheHash(FNV_OFFSET, &sceneHash, sizeof(sceneHash)), &chunkKey, sizeof(chunkKey));
+	FieldCacheRecord* victim = NULL;
+	size_t i;
+	for (i = 0; i < FIELD_CACHE_PROBES; ++i) {
+		FieldCacheRecord* record = cache->records + (hash + i) % recordCount;
+		if (record->mask && record->sceneHash == sceneHash && record->chunkKey == chunkKey) {
+			record->stamp = ++cache->header->stamp;
+			return record;
+		}
+		if (!victim || (victim->mask && (!record->mask || record->stamp < victim->stamp))) {
+			victim = record;
+		}
+	}
+	if (!create) {
+		return NULL;
+	}
+	if (victim->mask) {
+		++cache->evictions;
+	}
+	memset(victim, 0, sizeof(FieldCacheRecord));
+	victim->sceneHash = sceneHash;
+	victim->chunkKey = chunkKey;
+	victim->stamp = ++cache->header->stamp;
+	return victim;
+}
+
+int fieldCacheLookup(FieldCache* cache, uint64_t sceneHash, int cellX, int cellY, int cellZ, Vector* result) {
+	if (!cache) {
+		return 0;
+	}
+	unsigned int index;
+	const uint64_t chunkKey = fieldChunkLocate(cellX, cellY, cellZ, &index);
+	FieldCacheRecord* record = findRecord(cache, sceneHash, chunkKey, 0);
+	if (!record || !(record->mask & (1ULL << index))) {
+		++cache->misses;
+		return 0;
+	}
+	*result = fieldSampleUnpack(record->samples[index]);
+	++cache->hits;
+	return 1;
+}
+
+void fieldCacheStore(FieldCache* cache, uint64_t sceneHash, int cellX, int cellY, int cellZ, Vector value) {
+	if (!cache) {
+		return;
+	}
+	unsigned int index;
+	const uint64_t chunkKey = fieldChunkLocate(cellX, cellY, cellZ, &index);
+	FieldCacheRecord* record = findRecord(cache, sceneHash, chunkKey, 1);
+	record->samples[index] = fieldSamplePack(value);
+	record->mask |= 1ULL << index;
+	cache->dirty[record - cache->records] = 1;
+}
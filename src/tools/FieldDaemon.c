@@ -0,0 +1,105 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/FieldDaemon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test/tools/FieldChunk.h"
+#include "test/tools/MemoryStats.h"
+#include "test/tools/SharedField.h"
+
+#define FIELD_DAEMON_IDLE_US 1000
+#define FIELD_DAEMON_HEARTBEAT_CHUNKS 64
+
+static volatile sig_atomic_t _running = 1;
+static volatile sig_atomic_t _dumpRequested = 0;
+
+static void onSignal(int signal) {
+	_running = 0;
+}
+
+static void onDumpSignal(int signal) {
+	_dumpRequested = 1;
+}
+
+int fieldDaemonMain(int argc, char **argv, const FieldSceneSpecialization* specialization) {
+	const char* scenePath = NULL;
+	int i;
+	for (i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--scene") && i + 1 < argc) {
+			scenePath = argv[++i];
+		}
+	}
+	FieldScene* scene = fieldSceneNew();
+	if (!scene) {
+		fprintf(stderr, "error: Can't create scene\n");
+		return EXIT_FAILURE;
+	}
+	fieldSceneSetSpecialization(scene, specialization);
+	if (!scenePath) {
+		fieldSceneAddDefaultSources(scene);
+	} else if (fieldSceneLoadFile(scene, scenePath) < 0) {
+		fieldSceneFree(scene);
+		return EXIT_FAILURE;
+	}
+	SharedField* field = sharedFieldCreate(fieldSceneGetChunkHash(scene));
+	if (!field) {
+		fprintf(stderr, "error: Can't create shared field\n");
+		fieldSceneFree(scene);
+		return EXIT_FAILURE;
+	}
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	signal(SIGUSR1, onDumpSignal);
+	printf("serving field as %s\n", field->name);
+
+	// viewers may ask for the same chunk several times, it is computed once
+	Vector samples[FIELD_CHUNK_CELLS];
+	unsigned long served = 0;
+	while (_running) {
+		uint64_t chunkKey;
+		sharedFieldHeartbeat(field);
+		while (_running && sharedFieldNextRequest(field, &chunkKey)) {
+			if (!sharedFieldContains(field, chunkKey)) {
+				fieldSceneEvaluateChunk(scene, chunkKey, samples);
+				sharedFieldPublish(field, chunkKey, samples);
+			}
+			if (++served % FIELD_DAEMON_HEARTBEAT_CHUNKS == 0) {
+				sharedFieldHeartbeat(field);
+			}
+		}
+		if (_dumpRequested) {
+			_dumpRequested = 0;
+			memoryDumpStats(stdout);
+		}
+		usleep(FIELD_DAEMON_IDLE_US);
+	}
+
+	printf("served %lu requests, computed %lu chunks\n", served, (unsigned long) field->header->computedChunks);
+	sharedFieldClose(field);
+	fieldSceneFree(scene);
+	return EXIT_SUCCESS;
+}
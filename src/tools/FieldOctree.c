@@ -0,0 +1,213 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/FieldOctree.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "test/tools/MemoryStats.h"
+
+// where the interpolation is checked, in half cells: the center and the six face centers
+static const int _probes[7][3] = {
+	{ 1, 1, 1 }, { 0, 1, 1 }, { 2, 1, 1 }, { 1, 0, 1 }, { 1, 2, 1 }, { 1, 1, 0 }, { 1, 1, 2 }
+};
+
+static inline uint64_t latticeKey(int x, int y, int z) {
+	return (uint64_t) x << 42 | (uint64_t) y << 21 | (uint64_t) z;
+}
+
+// index of the sample at a lattice point, queued for evaluation when it is new
+static int getSample(FieldOctree* tree, int x, int y, int z) {
+	const uint64_t key = latticeKey(x, y, z);
+	const uintptr_t found = (uintptr_t) mapGet(tree->sampleIndex, key);
+	if (found) {
+		return (int) (found - 1);
+	}
+	if (tree->sampleCount == tree->sampleCapacity) {
+		tree->sampleCapacity = tree->sampleCapacity * 2 + 1024;
+		tree->samplePositions = (Vector*) memoryRealloc(MEMORY_TAG_FIELD_POINTS, tree->samplePositions, sizeof(Vector) * tree->sampleCapacity);
+		tree->samples = (Vector*) memoryRealloc(MEMORY_TAG_FIELD_POINTS, tree->samples, sizeof(Vector) * tree->sampleCapacity);
+	}
+	tree->samplePositions[tree->sampleCount] = vectorSum(tree->origin, vectorCreate(x * tree->step, y * tree->step, z * tree->step));
+	tree->samples[tree->sampleCount] = vectorZero;
+	mapPut(tree->sampleIndex, key, (void*) (uintptr_t) (tree->sampleCount + 1));
+	return (int) tree->sampleCount++;
+}
+
+static int addNode(FieldOctree* tree, int x, int y, int z, int size, int depth) {
+	if (tree->nodeCount == tree->nodeCapacity) {
+		tree->nodeCapacity = tree->nodeCapacity * 2 + 64;
+		tree->nodes = (FieldOctreeNode*) memoryRealloc(MEMORY_TAG_FIELD_POINTS, tree->nodes, sizeof(FieldOctreeNode) * tree->nodeCapacity);
+	}
+	FieldOctreeNode* node = tree->nodes + tree->nodeCount;
+	int i;
+	node->x = x;
+	node->y = y;
+	node->z = z;
+	node->size = size;
+	node->depth = depth;
+	node->firstChild = -1;
+	for (i = 0; i < 8; ++i) {
+		node->corners[i] = getSample(tree, x + (i & 1) * size, y + (i >> 1 & 1) * size, z + (i >> 2 & 1) * size);
+	}
+	return (int) tree->nodeCount++;
+}
+
+static inline Vector interpolate(const Vector* corners, double fx, double fy, double fz) {
+	const Vector x00 = vectorLerp(corners[0], corners[1], fx);
+	const Vector x10 = vectorLerp(corners[2], corners[3], fx);
+	const Vector x01 = vectorLerp(corners[4], corners[5], fx);
+	const Vector x11 = vectorLerp(corners[6], corners[7], fx);
+	return vectorLerp(vectorLerp(x00, x10, fy), vectorLerp(x01, x11, fy), fz);
+}
+
+static inline void getCornerFields(const FieldOctree* tree, const FieldOctreeNode* node, Vector* result) {
+	int i;
+	for (i = 0; i < 8; ++i) {
+		result[i] = tree->samples[node->corners[i]];
+	}
+}
+
+FieldOctree* fieldOctreeBuild(const FieldSourceSet* sources, Vector center, double halfSize, double tolerance, int minDepth, int maxDepth) {
+	if (maxDepth < 0 || maxDepth > FIELD_OCTREE_MAX_DEPTH || halfSize <= 0) {
+		return NULL;
+	}
+	FieldOctree* tree = (FieldOctree*) memoryCalloc(MEMORY_TAG_FIELD_POINTS, 1, sizeof(FieldOctree));
+	const int rootSize = 1 << maxDepth;
+	tree->origin = vectorSubstract(center, vectorCreate(halfSize, halfSize, halfSize));
+	tree->step = 2 * halfSize / rootSize;
+	tree->maxDepth = maxDepth;
+	tree->tolerance = tolerance;
+	tree->sampleIndex = mapNew(4096);
+
+	// one level at a time, so each level's new samples go through the batch kernels together
+	size_t levelFrom = 0, levelTo, i, evaluated = 0;
+	int child, probe;
+	addNode(tree, 0, 0, 0, rootSize, 0);
+	while (levelFrom < tree->nodeCount) {
+		levelTo = tree->nodeCount;
+		// probes at the center and the face centers of the cells, all of them are corners of the children too
+		for (i = levelFrom; i < levelTo; ++i) {
+			const FieldOctreeNode* node = tree->nodes + i;
+			if (node->size > 1 && node->depth >= minDepth) {
+				for (probe = 0; probe < 7; ++probe) {
+					getSample(tree, node->x + _probes[probe][0] * node->size / 2, node->y + _probes[probe][1] * node->size / 2, node->z + _probes[probe][2] * node->size / 2);
+				}
+			}
+		}
+		fieldSourceSetEvaluate(sources, tree->samplePositions + evaluated, tree->samples + evaluated, tree->sampleCount - evaluated);
+		evaluated = tree->sampleCount;
+
+		for (i = levelFrom; i < levelTo; ++i) {
+			FieldOctreeNode node = tree->nodes[i];
+			if (node.size <= 1) {
+				++tree->leafCount;
+				continue;
+			}
+			const int half = node.size / 2;
+			if (node.depth >= minDepth) {
+				Vector corners[8];
+				int accurate = 1;
+				getCornerFields(tree, &node, corners);
+				for (probe = 0; probe < 7 && accurate; ++probe) {
+					const Vector actual = tree->samples[getSample(tree, node.x + _probes[probe][0] * half, node.y + _probes[probe][1] * half, node.z + _probes[probe][2] * half)];
+					const Vector interpolated = interpolate(corners, _probes[probe][0] * 0.5, _probes[probe][1] * 0.5, _probes[probe][2] * 0.5);
+					accurate = vectorGetLength(vectorSubstract(interpolated, actual)) <= tolerance * vectorGetLength(actual);
+				}
+				if (accurate) {
+					++tree->leafCount;
+					continue;
+				}
+			}
+			tree->nodes[i].firstChild = (int) tree->nodeCount;
+			for (child = 0; child < 8; ++child) {
+				addNode(tree, node.x + (child & 1) * half, node.y + (child >> 1 & 1) * half, node.z + (child >> 2 & 1) * half, half, node.depth + 1);
+			}
+			if (node.depth + 1 > tree->deepestDepth) {
+				tree->deepestDepth = node.depth + 1;
+			}
+		}
+		levelFrom = levelTo;
+	}
+	return tree;
+}
+
+void fieldOctreeFree(FieldOctree* tree) {
+	if (!tree) {
+		return;
+	}
+	mapFree(tree->sampleIndex);
+	memoryFree(MEMORY_TAG_FIELD_POINTS, tree->nodes);
+	memoryFree(MEMORY_TAG_FIELD_POINTS, tree->samplePositions);
+	memoryFree(MEMORY_TAG_FIELD_POINTS, tree->samples);
+	memoryFree(MEMORY_TAG_FIELD_POINTS, tree);
+}
+
+const FieldOctreeNode* fieldOctreeFindLeaf(const FieldOctree* tree, Vector position) {
+	if (!tree || !tree->nodeCount) {
+		return NULL;
+	}
+	const double x = (position.x - tree->origin.x) / tree->step;
+	const double y = (position.y - tree->origin.y) / tree->step;
+	const double z = (position.z - tree->origin.z) / tree->step;
+	const FieldOctreeNode* node = tree->nodes;
+	if (x < 0 || y < 0 || z < 0 || x > node->size || y > node->size || z > node->size) {
+		return NULL;
+	}
+	while (node->firstChild >= 0) {
+		const int half = node->size / 2;
+		const int child = (x >= node->x + half) | (y >= node->y + half) << 1 | (z >= node->z + half) << 2;
+		node = tree->nodes + node->firstChild + child;
+	}
+	return node;
+}
+
+int fieldOctreeSample(const FieldOctree* tree, Vector position, Vector* result) {
+	const FieldOctreeNode* node = fieldOctreeFindLeaf(tree, position);
+	if (!node) {
+		return 0;
+	}
+	Vector corners[8];
+	getCornerFields(tree, node, corners);
+	const double scale = 1 / (node->size * tree->step);
+	*result = interpolate(corners,
+		(position.x - tree->origin.x) * scale - (double) node->x / node->size,
+		(position.y - tree->origin.y) * scale - (double) node->y / node->size,
+		(position.z - tree->origin.z) * scale - (double) node->z / node->size
+	);
+	return 1;
+}
+
+double fieldOctreeGetCellSize(const FieldOctree* tree, const FieldOctreeNode* node) {
+	return node->size * tree->step;
+}
+
+Vector fieldOctreeGetCellCenter(const FieldOctree* tree, const FieldOctreeNode* node) {
+	const double half = node->size * 0.5;
+	return vectorSum(tree->origin, vectorCreate((node->x + half) * tree->step, (node->y + half) * tree->step, (node->z + half) * tree->step));
+}
+
+double fieldOctreeGetUniformSampleCount(const FieldOctree* tree) {
+	const double perAxis = (double) (1 << tree->deepestDepth) + 1;
+	return perAxis * perAxis * perAxis;
+}
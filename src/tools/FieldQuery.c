@@ -0,0 +1,305 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/FieldQuery.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "test/tools/BoundedQueue.h"
+#include "test/tools/MemoryStats.h"
+#include "test/tools/ThreadPool.h"
+#include "test/tools/TimeTools.h"
+
+#define FIELD_QUERY_BATCHES 4
+#define FIELD_QUERY_BLOCK 256
+#define FIELD_QUERY_LINE 512
+
+typedef struct QueryBatch {
+	Vector* positions;
+	Vector* results;
+	size_t count;
+} QueryBatch;
+
+typedef struct QueryPipeline {
+	FieldScene* scene;
+	const FieldQueryOptions* options;
+	BoundedQueue* free;
+	BoundedQueue* parsed;
+	BoundedQueue* computed;
+	QueryBatch* batch;
+	unsigned long line;
+	int parseFailed;
+	int writeFailed;
+	int ended;
+	FieldQueryStats stats;
+} QueryPipeline;
+
+static inline int isSeparator(char c) {
+	return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r' || c == '\n';
+}
+
+// returns 1 for a point, 0 for a blank or comment line and -1 for garbage
+static int parsePoint(const char* line, Vector* result) {
+	double values[3];
+	char* end;
+	int i;
+	while (isSeparator(*line)) {
+		++line;
+	}
+	if (!*line || *line == '#') {
+		return 0;
+	}
+	for (i = 0; i < 3; ++i) {
+		while (isSeparator(*line)) {
+			++line;
+		}
+		values[i] = strtod(line, &end);
+		if (end == line) {
+			return -1;
+		}
+		line = end;
+	}
+	while (isSeparator(*line)) {
+		++line;
+	}
+	if (*line && *line != '#') {
+		return -1;
+	}
+	*result = vectorCreate(values[0], values[1], values[2]);
+	return 1;
+}
+
+static size_t readTextBatch(QueryPipeline* pipeline, QueryBatch* batch) {
+	char line[FIELD_QUERY_LINE];
+	size_t count = 0;
+	while (count < pipeline->options->batchSize) {
+		if (!fgets(line, sizeof(line), pipeline->options->input)) {
+			pipeline->ended = 1;
+			break;
+		}
+		++pipeline->line;
+		if (!strchr(line, '\n') && !feof(pipeline->options->input)) {
+			fprintf(stderr, "error: Line %lu is longer than %d characters\n", pipeline->line, FIELD_QUERY_LINE - 2);
+			pipeline->parseFailed = 1;
+			break;
+		}
+		const int parsed = parsePoint(line, batch->positions + count);
+		if (parsed < 0) {
+			fprintf(stderr, "error: Line %lu is not a point: %s", pipeline->line, line);
+			pipeline->parseFailed = 1;
+			break;
+		}
+		count += parsed;
+	}
+	return count;
+}
+
+static size_t readBinaryBatch(QueryPipeline* pipeline, QueryBatch* batch) {
+	const size_t bytes = fread(batch->positions, 1, sizeof(Vector) * pipeline->options->batchSize, pipeline->options->input);
+	if (bytes < sizeof(Vector) * pipeline->options->batchSize) {
+		pipeline->ended = 1;
+		if (bytes % sizeof(Vector)) {
+			fprintf(stderr, "error: Input ends inside a point\n");
+			pipeline->parseFailed = 1;
+		}
+	}
+	return bytes / sizeof(Vector);
+}
+
+static void* onParse(void* arg) {
+	QueryPipeline* pipeline = (QueryPipeline*) arg;
+	void* item;
+	while (!pipeline->ended && !pipeline->parseFailed && boundedQueuePop(pipeline->free, &item)) {
+		const double startTime = getTimeDetailed();
+		QueryBatch* batch = (QueryBatch*) item;
+		batch->count = pipeline->options->binaryInput ? readBinaryBatch(pipeline, batch) : readTextBatch(pipeline, batch);
+		pipeline->stats.parseTime += getTimeDetailed() - startTime;
+		if (batch->count && !pipeline->parseFailed) {
+			boundedQueuePush(pipeline->parsed, batch);
+		}
+	}
+	boundedQueueClose(pipeline->parsed);
+	return NULL;
+}
+
+static void* onWrite(void* arg) {
+	QueryPipeline* pipeline = (QueryPipeline*) arg;
+	FILE* output = pipeline->options->output;
+	void* item;
+	size_t i;
+	while (boundedQueuePop(pipeline->computed, &item)) {
+		QueryBatch* batch = (QueryBatch*) item;
+		if (!pipeline->writeFailed) {
+			const double startTime = getTimeDetailed();
+			if (pipeline->options->binaryOutput) {
+				fwrite(batch->results, sizeof(Vector), batch->count, output);
+			} else {
+				for (i = 0; i < batch->count; ++i) {
+					fprintf(output, "%.17g %.17g %.17g\n", batch->results[i].x, batch->results[i].y, batch->results[i].z);
+				}
+			}
+			pipeline->stats.points += batch->count;
+			++pipeline->stats.batches;
+			pipeline->stats.writeTime += getTimeDetailed() - startTime;
+			if (ferror(output)) {
+				// the parser stops once it can't get a free batch, the rest of the pipeline drains
+				fprintf(stderr, "error: Can't write results\n");
+				pipeline->writeFailed = 1;
+				boundedQueueClose(pipeline->free);
+			}
+		}
+		boundedQueuePush(pipeline->free, batch);
+	}
+	if (fflush(output) && !pipeline->writeFailed) {
+		fprintf(stderr, "error: Can't write results\n");
+		pipeline->writeFailed = 1;
+	}
+	return NULL;
+}
+
+static void evaluateBlock(void* arg, size_t index) {
+	QueryPipeline* pipeline = (QueryPipeline*) arg;
+	QueryBatch* batch = pipeline->batch;
+	const size_t from = index * FIELD_QUERY_BLOCK;
+	const size_t count = from + FIELD_QUERY_BLOCK < batch->count ? FIELD_QUERY_BLOCK : batch->count - from;
+	memset(batch->results + from, 0, sizeof(Vector) * count);
+	fieldSceneEvaluate(pipeline->scene, batch->positions + from, batch->results + from, count);
+}
+
+int fieldQueryRun(FieldScene* scene, const FieldQueryOptions* options, FieldQueryStats* stats) {
+	if (scene == NULL || options == NULL || options->input == NULL || options->output == NULL || !options->batchSize) {
+		return 0;
+	}
+	QueryPipeline pipeline;
+	QueryBatch batches[FIELD_QUERY_BATCHES];
+	pthread_t parseThread, writeThread;
+	size_t i;
+	void* item;
+	memset(&pipeline, 0, sizeof(pipeline));
+	memset(batches, 0, sizeof(batches));
+	pipeline.scene = scene;
+	pipeline.options = options;
+	const double startTime = getTimeDetailed();
+
+	// every queue can hold all batches, so only taking a free batch ever blocks
+	int ready = (pipeline.free = boundedQueueNew(FIELD_QUERY_BATCHES)) != NULL
+		&& (pipeline.parsed = boundedQueueNew(FIELD_QUERY_BATCHES)) != NULL
+		&& (pipeline.computed = boundedQueueNew(FIELD_QUERY_BATCHES)) != NULL;
+	for (i = 0; ready && i < FIELD_QUERY_BATCHES; ++i) {
+		batches[i].positions = (Vector*) memoryAlloc(MEMORY_TAG_FIELD_POINTS, sizeof(Vector) * options->batchSize);
+		batches[i].results = (Vector*) memoryAlloc(MEMORY_TAG_FIELD_POINTS, sizeof(Vector) * options->batchSize);
+		ready = batches[i].positions && batches[i].results;
+		boundedQueuePush(pipeline.free, batches + i);
+	}
+	ThreadPool* pool = ready ? threadPoolNew(options->threadCount) : NULL;
+	if (pool) {
+		pthread_create(&parseThread, NULL, onParse, &pipeline);
+		pthread_create(&writeThread, NULL, onWrite, &pipeline);
+		while (boundedQueuePop(pipeline.parsed, &item)) {
+			const double computeStartTime = getTimeDetailed();
+			pipeline.batch = (QueryBatch*) item;
+			threadPoolParallelFor(pool, (pipeline.batch->count + FIELD_QUERY_BLOCK - 1) / FIELD_QUERY_BLOCK, evaluateBlock, &pipeline);
+			pipeline.stats.computeTime += getTimeDetailed() - computeStartTime;
+			boundedQueuePush(pipeline.computed, pipeline.batch);
+		}
+		boundedQueueClose(pipeline.computed);
+		pthread_join(parseThread, NULL);
+		pthread_join(writeThread, NULL);
+		threadPoolFree(pool);
+	}
+
+	for (i = 0; i < FIELD_QUERY_BATCHES; ++i) {
+		memoryFree(MEMORY_TAG_FIELD_POINTS, batches[i].positions);
+		memoryFree(MEMORY_TAG_FIELD_POINTS, batches[i].results);
+	}
+	boundedQueueFree(pipeline.computed);
+	boundedQueueFree(pipeline.parsed);
+	boundedQueueFree(pipeline.free);
+	pipeline.stats.seconds = getTimeDetailed() - startTime;
+	if (stats) {
+		*stats = pipeline.stats;
+	}
+	return pool && !pipeline.parseFailed && !pipeline.writeFailed;
+}
+
+int fieldQueryMain(int argc, char **argv, const FieldSceneSpecialization* specialization) {
+	FieldQueryOptions options = { stdin, stdout, 0, 0, FIELD_QUERY_DEFAULT_BATCH_SIZE, 0 };
+	FieldQueryStats stats;
+	const char* scenePath = NULL;
+	int i, quiet = 0;
+	for (i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--input") && i + 1 < argc) {
+			options.input = fopen(argv[++i], "rb");
+			if (!options.input) {
+				fprintf(stderr, "error: Can't open %s\n", argv[i]);
+				return EXIT_FAILURE;
+			}
+		} else if (!strcmp(argv[i], "--binary")) {
+			options.binaryInput = options.binaryOutput = 1;
+		} else if (!strcmp(argv[i], "--binary-input")) {
+			options.binaryInput = 1;
+		} else if (!strcmp(argv[i], "--binary-output")) {
+			options.binaryOutput = 1;
+		} else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			options.threadCount = (size_t) atol(argv[++i]);
+		} else if (!strcmp(argv[i], "--batch") && i + 1 < argc) {
+			const long batchSize = atol(argv[++i]);
+			options.batchSize = batchSize > 0 ? (size_t) batchSize : FIELD_QUERY_DEFAULT_BATCH_SIZE;
+		} else if (!strcmp(argv[i], "--scene") && i + 1 < argc) {
+			scenePath = argv[++i];
+		} else if (!strcmp(argv[i], "--quiet")) {
+			quiet = 1;
+		}
+	}
+
+	FieldScene* scene = fieldSceneNew();
+	if (!scene) {
+		fprintf(stderr, "error: Can't create scene\n");
+		return EXIT_FAILURE;
+	}
+	fieldSceneSetSpecialization(scene, specialization);
+	if (!scenePath) {
+		fieldSceneAddDefaultSources(scene);
+	} else if (fieldSceneLoadFile(scene, scenePath) < 0) {
+		fieldSceneFree(scene);
+		return EXIT_FAILURE;
+	}
+	const int result = fieldQueryRun(scene, &options, &stats);
+	const char* kernel = fieldSceneGetSpecialization(scene);
+	fieldSceneFree(scene);
+	if (options.input != stdin) {
+		fclose(options.input);
+	}
+	if (!quiet) {
+		fprintf(stderr, "queried %llu points in %.3fs (%.0f points/s, %s kernel), busy: parse %.3fs, compute %.3fs, write %.3fs\n",
+			stats.points,
+			stats.seconds,
+			stats.seconds > 0 ? stats.points / stats.seconds : 0.0,
+			kernel ? kernel : "generic",
+			stats.parseTime,
+			stats.computeTime,
+			stats.writeTime
+		);
+	}
+	return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,83 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/FieldSample.h"
+
+#include <math.h>
+
+#define FIELD_SAMPLE_MAGNITUDE_STEPS 65535 // codes 1 to 65535, 0 is a zero field
+
+static inline double getFoldSign(double value) {
+	return value >= 0 ? 1 : -1;
+}
+
+static Vector unpackDirection(unsigned int u, unsigned int v) {
+	const double x = u / 127.5 - 1;
+	const double y = v / 127.5 - 1;
+	const double z = 1 - fabs(x) - fabs(y);
+	if (z < 0) {
+		return vectorNormalize(vectorCreate((1 - fabs(y)) * getFoldSign(x), (1 - fabs(x)) * getFoldSign(y), z));
+	}
+	return vectorNormalize(vectorCreate(x, y, z));
+}
+
+// projects the direction onto the octahedron, unfolds its lower half into the corners of the square, and keeps
+// whichever of the four surrounding codes comes closest, a third less error than rounding
+static unsigned int packDirection(Vector direction) {
+	const double norm = fabs(direction.x) + fabs(direction.y) + fabs(direction.z);
+	double x = direction.x / norm, y = direction.y / norm;
+	if (direction.z < 0) {
+		const double foldedX = (1 - fabs(y)) * getFoldSign(x);
+		y = (1 - fabs(x)) * getFoldSign(y);
+		x = foldedX;
+	}
+	const double u = floor((x + 1) * 127.5), v = floor((y + 1) * 127.5);
+	unsigned int result = 0, i;
+	double best = -2;
+	for (i = 0; i < 4; ++i) {
+		const unsigned int candidateU = (unsigned int) fmin(u + (i & 1), 255), candidateV = (unsigned int) fmin(v + (i >> 1), 255);
+		const double similarity = vectorDotProduct(unpackDirection(candidateU, candidateV), direction);
+		if (similarity > best) {
+			best = similarity;
+			result = candidateV << 8 | candidateU;
+		}
+	}
+	return result;
+}
+
+PackedFieldSample fieldSamplePack(Vector value) {
+	const double length = vectorGetLength(value);
+	if (!(length >= ldexp(1, FIELD_SAMPLE_MIN_LOG2))) {
+		return 0;
+	}
+	const double position = (log2(length) - FIELD_SAMPLE_MIN_LOG2) / (FIELD_SAMPLE_MAX_LOG2 - FIELD_SAMPLE_MIN_LOG2);
+	const uint32_t magnitude = 1 + (uint32_t) fmin(floor(position * (FIELD_SAMPLE_MAGNITUDE_STEPS - 1) + 0.5), FIELD_SAMPLE_MAGNITUDE_STEPS - 1);
+	return magnitude << 16 | packDirection(vectorDivide(value, length));
+}
+
+Vector fieldSampleUnpack(PackedFieldSample sample) {
+	const uint32_t magnitude = sample >> 16;
+	if (!magnitude) {
+		return vectorZero;
+	}
+	const double log2Length = FIELD_SAMPLE_MIN_LOG2 + (double) (magnitude - 1) / (FIELD_SAMPLE_MAGNITUDE_STEPS - 1) * (FIELD_SAMPLE_MAX_LOG2 - FIELD_SAMPLE_MIN_LOG2);
+	return vectorMultiply(unpackDirection(sample & 0xff, sample >> 8 & 0xff), exp2(log2Length));
+}
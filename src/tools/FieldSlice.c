@@ -0,0 +1,516 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/FieldSlice.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "test/math/MathFunctions.h"
+#include "test/tools/FieldChunk.h"
+#include "test/tools/MemoryStats.h"
+#include "test/tools/TimeTools.h"
+
+#define FIELD_SLICE_TILE_PIXELS (FIELD_SLICE_TILE * FIELD_SLICE_TILE)
+#define FIELD_SLICE_MIN_FIELD 1.0e-12
+#define FIELD_SLICE_LIC_CONTRAST 4.0f
+#define FIELD_SLICE_LIC_SHADE 0.35f // how dark the darkest streak gets
+#define FIELD_SLICE_LEVEL_STEPS 256
+#define FIELD_SLICE_LIC_SPREAD 2 // tiles convolved per sampled tile, itself and the neighbours waiting for it
+
+typedef struct SliceRamp {
+	float r;
+	float g;
+	float b;
+} SliceRamp;
+
+// weak field is blue, strong field is red
+static const SliceRamp _ramp[] = { { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 } };
+
+// the ramp color of every level step shaded by every LIC value, rgba
+static void initPalette(unsigned char* palette) {
+	const int rampLength = sizeof(_ramp) / sizeof(_ramp[0]);
+	int level, lic;
+	for (level = 0; level < FIELD_SLICE_LEVEL_STEPS; ++level) {
+		const float position = (float) level / (FIELD_SLICE_LEVEL_STEPS - 1) * (rampLength - 1);
+		const int from = min((int) position, rampLength - 2);
+		const float f = position - from;
+		for (lic = 0; lic < 256; ++lic) {
+			const float shade = 1 - FIELD_SLICE_LIC_SHADE + FIELD_SLICE_LIC_SHADE * lic / 255.0f;
+			unsigned char* entry = palette + (level * 256 + lic) * 4;
+			entry[0] = (unsigned char) (lerp(_ramp[from].r, _ramp[from + 1].r, f) * shade * 255);
+			entry[1] = (unsigned char) (lerp(_ramp[from].g, _ramp[from + 1].g, f) * shade * 255);
+			entry[2] = (unsigned char) (lerp(_ramp[from].b, _ramp[from + 1].b, f) * shade * 255);
+			entry[3] = 255;
+		}
+	}
+}
+
+typedef struct SliceSampling {
+	FieldSliceTile** tiles;
+	const FieldSourceSet* sources;
+	const FieldSlice* slice;
+} SliceSampling;
+
+typedef struct SliceOrder {
+	FieldSliceTile* tile;
+	double distance;
+} SliceOrder;
+
+static inline uint64_t tileKey(int x, int y) {
+	return (uint64_t) (uint32_t) x << 32 | (uint32_t) y;
+}
+
+static FieldSliceTile* tileNew(int x, int y) {
+	FieldSliceTile* tile = (FieldSliceTile*) memoryCalloc(MEMORY_TAG_RENDERING, 1, sizeof(FieldSliceTile));
+	if (!tile) {
+		return NULL;
+	}
+	tile->x = x;
+	tile->y = y;
+	tile->licNeighbours = -1;
+	tile->levels = (float*) memoryCalloc(MEMORY_TAG_RENDERING, FIELD_SLICE_TILE_PIXELS, sizeof(float));
+	tile->directions = (float*) memoryCalloc(MEMORY_TAG_RENDERING, FIELD_SLICE_TILE_PIXELS * 2, sizeof(float));
+	tile->lic = (unsigned char*) memoryCalloc(MEMORY_TAG_RENDERING, FIELD_SLICE_TILE_PIXELS, 1);
+	if (!tile->levels || !tile->directions || !tile->lic) {
+		memoryFree(MEMORY_TAG_RENDERING, tile->levels);
+		memoryFree(MEMORY_TAG_RENDERING, tile->directions);
+		memoryFree(MEMORY_TAG_RENDERING, tile->lic);
+		memoryFree(MEMORY_TAG_RENDERING, tile);
+		return NULL;
+	}
+	return tile;
+}
+
+static void tileFree(FieldSliceTile* tile) {
+	if (!tile) {
+		return;
+	}
+	memoryFree(MEMORY_TAG_RENDERING, tile->levels);
+	memoryFree(MEMORY_TAG_RENDERING, tile->directions);
+	memoryFree(MEMORY_TAG_RENDERING, tile->lic);
+	memoryFree(MEMORY_TAG_RENDERING, tile);
+}
+
+FieldSlice* fieldSliceNew(size_t resolution, ThreadPool* pool) {
+	if (!resolution || resolution % FIELD_SLICE_TILE) {
+		return NULL;
+	}
+	FieldSlice* slice = (FieldSlice*) memoryCalloc(MEMORY_TAG_RENDERING, 1, sizeof(FieldSlice));
+	if (!slice) {
+		return NULL;
+	}
+	const size_t coverSide = resolution / FIELD_SLICE_TILE + 1;
+	slice->resolution = resolution;
+	slice->pool = pool;
+	slice->tiles = mapNew(coverSide * coverSide * 4);
+	slice->cover = (FieldSliceTile**) memoryCalloc(MEMORY_TAG_RENDERING, coverSide * coverSide, sizeof(FieldSliceTile*));
+	slice->image = (unsigned char*) memoryCalloc(MEMORY_TAG_RENDERING, resolution * resolution, 4);
+	slice->palette = (unsigned char*) memoryAlloc(MEMORY_TAG_RENDERING, FIELD_SLICE_LEVEL_STEPS * 256 * 4);
+	if (!slice->tiles || !slice->cover || !slice->image || !slice->palette) {
+		fieldSliceFree(slice);
+		return NULL;
+	}
+	initPalette(slice->palette);
+	return slice;
+}
+
+void fieldSliceFree(FieldSlice* slice) {
+	size_t i;
+	if (!slice) {
+		return;
+	}
+	if (slice->tiles) {
+		for (i = 0; i < slice->tiles->capacity; ++i) {
+			if (slice->tiles->rawArray[i].used) {
+				tileFree((FieldSliceTile*) slice->tiles->rawArray[i].value);
+			}
+		}
+		mapFree(slice->tiles);
+	}
+	memoryFree(MEMORY_TAG_RENDERING, slice->cover);
+	memoryFree(MEMORY_TAG_RENDERING, slice->image);
+	memoryFree(MEMORY_TAG_RENDERING, slice->palette);
+	memoryFree(MEMORY_TAG_RENDERING, slice);
+}
+
+static void parallelFor(const FieldSlice* slice, size_t count, ThreadPoolTask task, void* arg) {
+	size_t i;
+	if (slice->pool) {
+		threadPoolParallelFor(slice->pool, count, task, arg);
+		return;
+	}
+	for (i = 0; i < count; ++i) {
+		task(arg, i);
+	}
+}
+
+static inline FieldSliceTile* getCoverTile(const FieldSlice* slice, int tileX, int tileY) {
+	const int x = tileX - slice->coverX, y = tileY - slice->coverY;
+	if (x < 0 || y < 0 || x >= slice->coverWidth || y >= slice->coverHeight) {
+		return NULL;
+	}
+	return slice->cover[y * slice->coverWidth + x];
+}
+
+// the center of a lattice pixel
+static inline Vector getPixelPosition(const FieldSlice* slice, int x, int y) {
+	return vectorSum(slice->anchor, vectorSum(vectorMultiply(slice->u, (x + 0.5) * slice->step), vectorMultiply(slice->v, (y + 0.5) * slice->step)));
+}
+
+static void sampleTile(void* arg, size_t index) {
+	const SliceSampling* sampling = (const SliceSampling*) arg;
+	const FieldSlice* slice = sampling->slice;
+	FieldSliceTile* tile = sampling->tiles[index];
+	Vector positions[FIELD_SLICE_TILE_PIXELS];
+	Vector results[FIELD_SLICE_TILE_PIXELS];
+	size_t x, y, i;
+	tile->corner = getPixelPosition(slice, tile->x * FIELD_SLICE_TILE, tile->y * FIELD_SLICE_TILE);
+	tile->stepU = vectorMultiply(slice->u, slice->step);
+	tile->stepV = vectorMultiply(slice->v, slice->step);
+	for (y = 0; y < FIELD_SLICE_TILE; ++y) {
+		const Vector rowStart = vectorSum(tile->corner, vectorMultiply(tile->stepV, y));
+		for (x = 0; x < FIELD_SLICE_TILE; ++x) {
+			positions[y * FIELD_SLICE_TILE + x] = vectorSum(rowStart, vectorMultiply(tile->stepU, x));
+			results[y * FIELD_SLICE_TILE + x] = vectorZero;
+		}
+	}
+	fieldSourceSetEvaluate(sampling->sources, positions, results, FIELD_SLICE_TILE_PIXELS);
+	tile->minLevel = 1.0e30f;
+	tile->maxLevel = -1.0e30f;
+	for (i = 0; i < FIELD_SLICE_TILE_PIXELS; ++i) {
+		const double length = vectorGetLength(results[i]);
+		const float level = log10f((float) max(length, FIELD_SLICE_MIN_FIELD));
+		const double alongU = vectorDotProduct(results[i], slice->u);
+		const double alongV = vectorDotProduct(results[i], slice->v);
+		const double inPlane = sqrt(alongU * alongU + alongV * alongV);
+		tile->levels[i] = level;
+		tile->minLevel = min(tile->minLevel, level);
+		tile->maxLevel = max(tile->maxLevel, level);
+		tile->directions[2 * i] = inPlane > FIELD_SLICE_MIN_FIELD ? (float) (alongU / inPlane) : 0;
+		tile->directions[2 * i + 1] = inPlane > FIELD_SLICE_MIN_FIELD ? (float) (alongV / inPlane) : 0;
+	}
+}
+
+// white noise fixed to the lattice, so a panned slice keeps its streaks
+static inline float getNoise(int x, int y) {
+	uint32_t hash = (uint32_t) x * 73856093u ^ (uint32_t) y * 19349663u;
+	hash ^= hash >> 13;
+	hash *= 0x5bd1e995u;
+	hash ^= hash >> 15;
+	return (float) (hash & 1);
+}
+
+// floorf is a library call without SSE4.1, streamlines take two floors a step
+static inline int floorToInt(float value) {
+	const int result = (int) value;
+	return result - (value < result);
+}
+
+// the direction at a lattice pixel, tile is the one the streamline was in and is moved along with it
+static inline const float* getDirection(const FieldSlice* slice, const FieldSliceTile** tile, int x, int y) {
+	int localX = x - (*tile)->x * FIELD_SLICE_TILE, localY = y - (*tile)->y * FIELD_SLICE_TILE;
+	if (localX < 0 || localY < 0 || localX >= FIELD_SLICE_TILE || localY >= FIELD_SLICE_TILE) {
+		const FieldSliceTile* next = getCoverTile(slice, fieldChunkFloorDiv(x, FIELD_SLICE_TILE), fieldChunkFloorDiv(y, FIELD_SLICE_TILE));
+		if (!next) {
+			return NULL;
+		}
+		*tile = next;
+		localX = x - next->x * FIELD_SLICE_TILE;
+		localY = y - next->y * FIELD_SLICE_TILE;
+	}
+	if (!(*tile)->sampled) {
+		return NULL;
+	}
+	const float* direction = (*tile)->directions + 2 * (localY * FIELD_SLICE_TILE + localX);
+	return direction[0] || direction[1] ? direction : NULL;
+}
+
+// averages the noise along the streamline through every pixel, a unit step at a time both ways
+static void convolveTile(void* arg, size_t index) {
+	const SliceSampling* sampling = (const SliceSampling*) arg;
+	const FieldSlice* slice = sampling->slice;
+	FieldSliceTile* tile = sampling->tiles[index];
+	const int originX = tile->x * FIELD_SLICE_TILE, originY = tile->y * FIELD_SLICE_TILE;
+	int x, y, step, way;
+	for (y = 0; y < FIELD_SLICE_TILE; ++y) {
+		for (x = 0; x < FIELD_SLICE_TILE; ++x) {
+			float sum = getNoise(originX + x, originY + y);
+			int count = 1;
+			for (way = -1; way <= 1; way += 2) {
+				const FieldSliceTile* current = tile;
+				float px = originX + x + 0.5f, py = originY + y + 0.5f;
+				int pixelX = originX + x, pixelY = originY + y;
+				for (step = 0; step < FIELD_SLICE_LIC_STEPS; ++step) {
+					const float* direction = getDirection(slice, &current, pixelX, pixelY);
+					if (!direction) {
+						break;
+					}
+					px += way * direction[0];
+					py += way * direction[1];
+					pixelX = floorToInt(px);
+					pixelY = floorToInt(py);
+					sum += getNoise(pixelX, pixelY);
+					++count;
+				}
+			}
+			const float contrast = (sum / count - 0.5f) * FIELD_SLICE_LIC_CONTRAST + 0.5f;
+			tile->lic[y * FIELD_SLICE_TILE + x] = (unsigned char) (clamp(contrast, 0.0f, 1.0f) * 255);
+		}
+	}
+}
+
+// one image row of tiles per task, log |B| between the extremes of the image through the palette; tiles without
+// samples yet stay black
+static void composeRow(void* arg, size_t index) {
+	static const unsigned char black[4] = { 0, 0, 0, 255 };
+	const FieldSlice* slice = (const FieldSlice*) arg;
+	const float scale = (FIELD_SLICE_LEVEL_STEPS - 1) / max(slice->stats.maxLevel - slice->stats.minLevel, 1.0e-3f);
+	const int resolution = (int) slice->resolution;
+	int x, y, i;
+	for (y = (int) index * FIELD_SLICE_TILE; y < ((int) index + 1) * FIELD_SLICE_TILE; ++y) {
+		const int latticeY = slice->pixelY + y;
+		const int tileY = fieldChunkFloorDiv(latticeY, FIELD_SLICE_TILE);
+		unsigned char* pixel = slice->image + (size_t) y * resolution * 4;
+		for (x = 0; x < resolution;) {
+			const int latticeX = slice->pixelX + x;
+			const FieldSliceTile* tile = getCoverTile(slice, fieldChunkFloorDiv(latticeX, FIELD_SLICE_TILE), tileY);
+			const int localX = latticeX - tile->x * FIELD_SLICE_TILE;
+			const int span = min(FIELD_SLICE_TILE - localX, resolution - x);
+			const size_t offset = (size_t) (latticeY - tile->y * FIELD_SLICE_TILE) * FIELD_SLICE_TILE + localX;
+			for (i = 0; i < span; ++i, pixel += 4) {
+				if (!tile->sampled) {
+					memcpy(pixel, black, 4);
+					continue;
+				}
+				const int level = clamp((int) ((tile->levels[offset + i] - slice->stats.minLevel) * scale + 0.5f), 0, FIELD_SLICE_LEVEL_STEPS - 1);
+				memcpy(pixel, slice->palette + (level * 256 + tile->lic[offset + i]) * 4, 4);
+			}
+			x += span;
+		}
+	}
+}
+
+static int compareOrder(const void* a, const void* b) {
+	const double da = ((const SliceOrder*) a)->distance, db = ((const SliceOrder*) b)->distance;
+	return da < db ? -1 : da > db;
+}
+
+// how far the tile's corners move from where they were sampled to where the current plane puts them
+static double getDisplacement(const FieldSlice* slice, const FieldSliceTile* tile) {
+	const double last = FIELD_SLICE_TILE - 1;
+	const Vector corner = getPixelPosition(slice, tile->x * FIELD_SLICE_TILE, tile->y * FIELD_SLICE_TILE);
+	const Vector stepU = vectorMultiply(slice->u, slice->step), stepV = vectorMultiply(slice->v, slice->step);
+	double result = 0;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		const double alongU = i & 1 ? last : 0, alongV = i & 2 ? last : 0;
+		const Vector to = vectorSum(corner, vectorSum(vectorMultiply(stepU, alongU), vectorMultiply(stepV, alongV)));
+		const Vector from = vectorSum(tile->corner, vectorSum(vectorMultiply(tile->stepU, alongU), vectorMultiply(tile->stepV, alongV)));
+		result = max(result, vectorGetLength(vectorSubstract(to, from)));
+	}
+	return result;
+}
+
+static void setPlane(FieldSlice* slice, FieldSlicePlane plane) {
+	const Vector normal = vectorNormalize(plane.normal);
+	Vector u = vectorCrossProduct(plane.up, normal);
+	if (vectorGetLengthSq(u) < 1.0e-12) {
+		u = vectorCrossProduct(fabs(normal.x) < 0.5 ? vectorCreate(1, 0, 0) : vectorCreate(0, 1, 0), normal);
+	}
+	slice->u = vectorNormalize(u);
+	slice->v = vectorCrossProduct(normal, slice->u);
+	slice->anchor = vectorMultiply(normal, vectorDotProduct(plane.center, normal));
+	slice->step = plane.size / slice->resolution;
+	const Vector center = vectorSubstract(plane.center, slice->anchor);
+	slice->pixelX = (int) floor(vectorDotProduct(center, slice->u) / slice->step + 0.5) - (int) slice->resolution / 2;
+	slice->pixelY = (int) floor(vectorDotProduct(center, slice->v) / slice->step + 0.5) - (int) slice->resolution / 2;
+	slice->coverX = fieldChunkFloorDiv(slice->pixelX, FIELD_SLICE_TILE);
+	slice->coverY = fieldChunkFloorDiv(slice->pixelY, FIELD_SLICE_TILE);
+	slice->coverWidth = fieldChunkFloorDiv(slice->pixelX + (int) slice->resolution - 1, FIELD_SLICE_TILE) - slice->coverX + 1;
+	slice->coverHeight = fieldChunkFloorDiv(slice->pixelY + (int) slice->resolution - 1, FIELD_SLICE_TILE) - slice->coverY + 1;
+}
+
+// drops the tiles this update didn't need once the cache holds more than two images worth of them
+static void evictTiles(FieldSlice* slice, uint64_t* keys) {
+	const size_t limit = 2 * (size_t) slice->coverWidth * slice->coverHeight;
+	size_t i, count = 0;
+	if (mapGetLength(slice->tiles) <= limit) {
+		return;
+	}
+	for (i = 0; i < slice->tiles->capacity; ++i) {
+		const HashMapEntry* entry = slice->tiles->rawArray + i;
+		if (entry->used && ((const FieldSliceTile*) entry->value)->lastUsed != slice->epoch) {
+			keys[count++] = entry->key;
+		}
+	}
+	for (i = 0; i < count; ++i) {
+		tileFree((FieldSliceTile*) mapRemove(slice->tiles, keys[i]));
+	}
+}
+
+int fieldSliceUpdate(FieldSlice* slice, const FieldSourceSet* sources, uint64_t sourcesHash, FieldSlicePlane plane, double deadline) {
+	const double startTime = getTimeDetailed();
+	const size_t batch = slice->pool ? 2 * threadPoolGetThreadCount(slice->pool) : 1;
+	size_t i, j, pendingCount = 0, sampledCount = 0, licCount = 0;
+	int x, y, neighbour;
+
+	setPlane(slice, plane);
+	++slice->epoch;
+	const size_t coverCount = (size_t) slice->coverWidth * slice->coverHeight;
+	SliceOrder* order = (SliceOrder*) memoryAlloc(MEMORY_TAG_RENDERING, sizeof(SliceOrder) * coverCount);
+	FieldSliceTile** work = (FieldSliceTile**) memoryAlloc(MEMORY_TAG_RENDERING, sizeof(FieldSliceTile*) * coverCount);
+	uint64_t* keys = (uint64_t*) memoryAlloc(MEMORY_TAG_RENDERING, sizeof(uint64_t) * (mapGetLength(slice->tiles) + coverCount));
+	int ready = order && work && keys;
+
+	// every tile under the image, those sampled for another place or scene are queued nearest to the center first
+	const double centerX = slice->pixelX + slice->resolution / 2.0, centerY = slice->pixelY + slice->resolution / 2.0;
+	for (y = 0; y < slice->coverHeight && ready; ++y) {
+		for (x = 0; x < slice->coverWidth && ready; ++x) {
+			const int tileX = slice->coverX + x, tileY = slice->coverY + y;
+			FieldSliceTile* tile = (FieldSliceTile*) mapGet(slice->tiles, tileKey(tileX, tileY));
+			if (!tile && (tile = tileNew(tileX, tileY))) {
+				mapPut(slice->tiles, tileKey(tileX, tileY), tile);
+			}
+			slice->cover[y * slice->coverWidth + x] = tile;
+			if (!tile) {
+				ready = 0;
+				break;
+			}
+			tile->lastUsed = slice->epoch;
+			tile->resampled = 0;
+			tile->stale = !tile->sampled || tile->sourcesHash != sourcesHash || getDisplacement(slice, tile) > FIELD_SLICE_REUSE_TOLERANCE * slice->step;
+			if (tile->stale) {
+				order[pendingCount].tile = tile;
+				order[pendingCount].distance = hypot((tileX + 0.5) * FIELD_SLICE_TILE - centerX, (tileY + 0.5) * FIELD_SLICE_TILE - centerY);
+				++pendingCount;
+			}
+		}
+	}
+	if (!ready) {
+		memoryFree(MEMORY_TAG_RENDERING, order);
+		memoryFree(MEMORY_TAG_RENDERING, work);
+		memoryFree(MEMORY_TAG_RENDERING, keys);
+		return -1;
+	}
+	qsort(order, pendingCount, sizeof(SliceOrder), compareOrder);
+
+	// a batch at a time while the LIC and the composition of what is sampled still fit before the deadline, at least
+	// one batch so every update makes progress
+	SliceSampling sampling = { work, sources, slice };
+	while (sampledCount < pendingCount) {
+		const size_t count = min(batch, pendingCount - sampledCount);
+		const double finishTime = slice->composeTime + FIELD_SLICE_LIC_SPREAD * (sampledCount + count) * slice->licTime;
+		if (deadline && sampledCount && getTimeDetailed() + finishTime > deadline) {
+			break;
+		}
+		for (i = 0; i < count; ++i) {
+			work[i] = order[sampledCount + i].tile;
+		}
+		parallelFor(slice, count, sampleTile, &sampling);
+		for (i = 0; i < count; ++i) {
+			work[i]->sampled = 1;
+			work[i]->stale = 0;
+			work[i]->resampled = 1;
+			work[i]->sourcesHash = sourcesHash;
+		}
+		sampledCount += count;
+	}
+
+	// streamlines reach into the neighbours, so a tile is convolved again when one of them changed or came or went; a
+	// tile still waiting for its samples keeps its old LIC, it is convolved once they are in
+	for (i = 0; i < coverCount; ++i) {
+		FieldSliceTile* tile = slice->cover[i];
+		int neighbours = 0, changed = tile->resampled;
+		for (neighbour = 0, j = 0; neighbour < 9; ++neighbour) {
+			if (neighbour == 4) {
+				continue;
+			}
+			const FieldSliceTile* other = getCoverTile(slice, tile->x + neighbour % 3 - 1, tile->y + neighbour / 3 - 1);
+			if (other && other->sampled) {
+				neighbours |= 1 << j;
+				changed |= other->resampled;
+			}
+			++j;
+		}
+		if (tile->sampled && !tile->stale && (changed || neighbours != tile->licNeighbours)) {
+			tile->licNeighbours = neighbours;
+			work[licCount++] = tile;
+		}
+	}
+	const double licStartTime = getTimeDetailed();
+	parallelFor(slice, licCount, convolveTile, &sampling);
+	if (licCount) {
+		slice->licTime = (getTimeDetailed() - licStartTime) / licCount;
+	}
+
+	slice->stats.minLevel = 1.0e30f;
+	slice->stats.maxLevel = -1.0e30f;
+	for (i = 0; i < coverCount; ++i) {
+		if (slice->cover[i]->sampled) {
+			slice->stats.minLevel = min(slice->stats.minLevel, slice->cover[i]->minLevel);
+			slice->stats.maxLevel = max(slice->stats.maxLevel, slice->cover[i]->maxLevel);
+		}
+	}
+	const double composeStartTime = getTimeDetailed();
+	parallelFor(slice, slice->resolution / FIELD_SLICE_TILE, composeRow, slice);
+	slice->composeTime = getTimeDetailed() - composeStartTime;
+	evictTiles(slice, keys);
+
+	slice->stats.tiles = coverCount;
+	slice->stats.sampledTiles = sampledCount;
+	slice->stats.licTiles = licCount;
+	slice->stats.pendingTiles = pendingCount - sampledCount;
+	slice->stats.updateTime = getTimeDetailed() - startTime;
+	memoryFree(MEMORY_TAG_RENDERING, order);
+	memoryFree(MEMORY_TAG_RENDERING, work);
+	memoryFree(MEMORY_TAG_RENDERING, keys);
+	return (int) (pendingCount - sampledCount);
+}
+
+Vector fieldSliceGetCorner(const FieldSlice* slice, int corner) {
+	const double alongU = (corner == 1 || corner == 2 ? slice->pixelX + (double) slice->resolution : slice->pixelX) * slice->step;
+	const double alongV = (corner >= 2 ? slice->pixelY + (double) slice->resolution : slice->pixelY) * slice->step;
+	return vectorSum(slice->anchor, vectorSum(vectorMultiply(slice->u, alongU), vectorMultiply(slice->v, alongV)));
+}
+
+static inline const FieldSliceTile* getImageTile(const FieldSlice* slice, size_t x, size_t y, size_t* offset) {
+	const int latticeX = slice->pixelX + (int) x, latticeY = slice->pixelY + (int) y;
+	const FieldSliceTile* tile = getCoverTile(slice, fieldChunkFloorDiv(latticeX, FIELD_SLICE_TILE), fieldChunkFloorDiv(latticeY, FIELD_SLICE_TILE));
+	if (!tile || !tile->sampled || x >= slice->resolution || y >= slice->resolution) {
+		return NULL;
+	}
+	*offset = (size_t) (latticeY - tile->y * FIELD_SLICE_TILE) * FIELD_SLICE_TILE + (latticeX - tile->x * FIELD_SLICE_TILE);
+	return tile;
+}
+
+float fieldSliceGetLevel(const FieldSlice* slice, size_t x, size_t y) {
+	size_t offset;
+	const FieldSliceTile* tile = getImageTile(slice, x, y, &offset);
+	return tile ? tile->levels[offset] : 0;
+}
+
+unsigned char fieldSliceGetLic(const FieldSlice* slice, size_t x, size_t y) {
+	size_t offset;
+	const FieldSliceTile* tile = getImageTile(slice, x, y, &offset);
+	return tile ? tile->lic[offset] : 0;
+}
@@ -0,0 +1,348 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/GridSolver.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "test/math/MathFunctions.h"
+#include "test/tools/MemoryStats.h"
+
+// one pass of a 3d transform along axis, the x pass only transforms the first rows of a plane
+typedef struct GridPass {
+	GridSolver* solver;
+	double* data;
+	int axis;
+	int inverse;
+	size_t rows;
+} GridPass;
+
+static inline size_t getPaddedCount(const GridSolver* solver) {
+	return solver->padded[0] * solver->padded[1] * solver->padded[2];
+}
+
+static void parallelFor(GridSolver* solver, size_t count, ThreadPoolTask task, void* arg) {
+	size_t i;
+	if (solver->pool) {
+		threadPoolParallelFor(solver->pool, count, task, arg);
+		return;
+	}
+	for (i = 0; i < count; ++i) {
+		task(arg, i);
+	}
+}
+
+// x and y passes take a z plane per task, the z pass a y row across all planes; the inner sequences are x, so the
+// strided passes walk memory in order
+static void runPass(void* arg, size_t index) {
+	const GridPass* pass = (const GridPass*) arg;
+	const GridSolver* solver = pass->solver;
+	const size_t px = solver->padded[0], py = solver->padded[1];
+	size_t y;
+	switch (pass->axis) {
+		case 0:
+			for (y = 0; y < pass->rows; ++y) {
+				fftTransform(solver->plans[0], pass->data + 2 * (index * py + y) * px, 1, 1, pass->inverse);
+			}
+			break;
+		case 1:
+			fftTransform(solver->plans[1], pass->data + 2 * index * py * px, px, px, pass->inverse);
+			break;
+		default:
+			fftTransform(solver->plans[2], pass->data + 2 * index * px, px * py, px, pass->inverse);
+			break;
+	}
+}
+
+// data is zero outside the first size nodes along every axis before a forward transform, and only those nodes are read
+// after an inverse one, so the x and y passes skip the planes and rows which stay zero or aren't needed
+static void transform(GridSolver* solver, double* data, int inverse, int full) {
+	const size_t planes = full ? solver->padded[2] : solver->size[2];
+	GridPass pass = { solver, data, 0, inverse, full ? solver->padded[1] : solver->size[1] };
+	int step;
+	for (step = 0; step < 3; ++step) {
+		pass.axis = inverse ? 2 - step : step;
+		parallelFor(solver, pass.axis == 2 ? solver->padded[1] : planes, runPass, &pass);
+	}
+}
+
+static inline long getOffset(size_t index, size_t padded) {
+	return index < padded / 2 ? (long) index : (long) index - (long) padded;
+}
+
+// r / |r|^3 between nodes, wrapped so negative offsets land at the end of the padded grid
+static void fillKernelPlane(void* arg, size_t z) {
+	const GridSolver* solver = (const GridSolver*) arg;
+	const size_t px = solver->padded[0], py = solver->padded[1];
+	const long dz = getOffset(z, solver->padded[2]);
+	size_t x, y;
+	int component;
+	for (y = 0; y < py; ++y) {
+		const long dy = getOffset(y, py);
+		for (x = 0; x < px; ++x) {
+			const long dx = getOffset(x, px);
+			const size_t index = 2 * ((z * py + y) * px + x);
+			const int inside = labs(dx) < (long) solver->size[0] && labs(dy) < (long) solver->size[1] && labs(dz) < (long) solver->size[2];
+			const double rLenSq = (double) (dx * dx + dy * dy + dz * dz) * solver->spacing * solver->spacing;
+			const double k = inside && rLenSq > 0 ? solver->spacing / (rLenSq * sqrt(rLenSq)) : 0;
+			for (component = 0; component < 3; ++component) {
+				solver->moments[component][index] = (component == 0 ? dx : component == 1 ? dy : dz) * k;
+				solver->moments[component][index + 1] = 0;
+			}
+		}
+	}
+}
+
+static void prepareKernel(GridSolver* solver) {
+	const size_t count = getPaddedCount(solver);
+	size_t i;
+	int component;
+	parallelFor(solver, solver->padded[2], fillKernelPlane, solver);
+	for (component = 0; component < 3; ++component) {
+		transform(solver, solver->moments[component], 0, 1);
+		for (i = 0; i < count; ++i) {
+			solver->kernel[component][i] = solver->moments[component][2 * i + 1];
+		}
+	}
+	gridSolverClear(solver);
+	solver->kernelReady = 1;
+}
+
+GridSolver* gridSolverNew(Vector origin, double spacing, size_t sizeX, size_t sizeY, size_t sizeZ, ThreadPool* pool) {
+	const size_t sizes[3] = { sizeX, sizeY, sizeZ };
+	int axis;
+	if (spacing <= 0 || sizeX < 2 || sizeY < 2 || sizeZ < 2) {
+		return NULL;
+	}
+	GridSolver* solver = (GridSolver*) memoryCalloc(MEMORY_TAG_FIELD_POINTS, 1, sizeof(GridSolver));
+	if (!solver) {
+		return NULL;
+	}
+	solver->origin = origin;
+	solver->spacing = spacing;
+	solver->pool = pool;
+	for (axis = 0; axis < 3; ++axis) {
+		solver->size[axis] = sizes[axis];
+		solver->padded[axis] = fftGetPaddedLength(2 * sizes[axis]);
+		solver->plans[axis] = fftPlanNew(solver->padded[axis]);
+	}
+	const size_t count = getPaddedCount(solver);
+	int ready = solver->plans[0] && solver->plans[1] && solver->plans[2];
+	for (axis = 0; axis < 3 && ready; ++axis) {
+		solver->moments[axis] = (double*) memoryAlloc(MEMORY_TAG_FIELD_POINTS, sizeof(double) * 2 * count);
+		solver->kernel[axis] = (double*) memoryAlloc(MEMORY_TAG_FIELD_POINTS, sizeof(double) * count);
+		ready = solver->moments[axis] && solver->kernel[axis];
+	}
+	solver->field = ready ? (Vector*) memoryCalloc(MEMORY_TAG_FIELD_POINTS, sizeX * sizeY * sizeZ, sizeof(Vector)) : NULL;
+	if (!solver->field) {
+		gridSolverFree(solver);
+		return NULL;
+	}
+	prepareKernel(solver);
+	return solver;
+}
+
+void gridSolverFree(GridSolver* solver) {
+	int axis;
+	if (!solver) {
+		return;
+	}
+	for (axis = 0; axis < 3; ++axis) {
+		fftPlanFree(solver->plans[axis]);
+		memoryFree(MEMORY_TAG_FIELD_POINTS, solver->moments[axis]);
+		memoryFree(MEMORY_TAG_FIELD_POINTS, solver->kernel[axis]);
+	}
+	memoryFree(MEMORY_TAG_FIELD_POINTS, solver->field);
+	memoryFree(MEMORY_TAG_FIELD_POINTS, solver);
+}
+
+void gridSolverClear(GridSolver* solver) {
+	int axis;
+	for (axis = 0; axis < 3; ++axis) {
+		memset(solver->moments[axis], 0, sizeof(double) * 2 * getPaddedCount(solver));
+	}
+}
+
+int gridSolverDepositCurrent(GridSolver* solver, Vector position, Vector currentMoment, double permeability) {
+	const double u[3] = {
+		(position.x - solver->origin.x) / solver->spacing,
+		(position.y - solver->origin.y) / solver->spacing,
+		(position.z - solver->origin.z) / solver->spacing
+	};
+	const Vector moment = vectorMultiply(currentMoment, permeability / (4 * M_PI));
+	size_t from[3];
+	double weights[3];
+	int axis, corner;
+	for (axis = 0; axis < 3; ++axis) {
+		if (!(u[axis] >= 0 && u[axis] <= solver->size[axis] - 1)) {
+			return 0;
+		}
+		from[axis] = min((size_t) u[axis], solver->size[axis] - 2);
+		weights[axis] = u[axis] - from[axis];
+	}
+	for (corner = 0; corner < 8; ++corner) {
+		const size_t x = from[0] + (corner & 1), y = from[1] + ((corner >> 1) & 1), z = from[2] + (corner >> 2);
+		const double weight = (corner & 1 ? weights[0] : 1 - weights[0]) * ((corner >> 1) & 1 ? weights[1] : 1 - weights[1]) *
+			(corner >> 2 ? weights[2] : 1 - weights[2]);
+		const size_t index = 2 * ((z * solver->padded[1] + y) * solver->padded[0] + x);
+		solver->moments[0][index] += moment.x * weight;
+		solver->moments[1][index] += moment.y * weight;
+		solver->moments[2][index] += moment.z * weight;
+	}
+	return 1;
+}
+
+static int depositLine(GridSolver* solver, Vector start, Vector end, double I, double permeability) {
+	const Vector length = vectorSubstract(end, start);
+	const size_t pieces = max((size_t) ceil(vectorGetLength(length) / (solver->spacing / 2)), (size_t) 1);
+	const Vector piece = vectorDivide(length, (double) pieces);
+	size_t i;
+	int deposited = 0;
+	for (i = 0; i < pieces; ++i) {
+		deposited |= gridSolverDepositCurrent(solver, vectorSum(start, vectorMultiply(piece, i + 0.5)), vectorMultiply(piece, I), permeability);
+	}
+	return deposited;
+}
+
+static int depositLoop(GridSolver* solver, const FieldLoop* loop) {
+	const Vector normal = vectorNormalize(loop->normal);
+	const Vector axis = fabs(normal.x) < 0.5 ? vectorCreate(1, 0, 0) : vectorCreate(0, 1, 0);
+	const Vector e1 = vectorNormalize(vectorCrossProduct(normal, axis));
+	const Vector e2 = vectorCrossProduct(normal, e1);
+	const size_t pieces = max((size_t) ceil(2 * M_PI * loop->radius / (solver->spacing / 2)), (size_t) 16);
+	const double pieceLength = 2 * M_PI * loop->radius / pieces;
+	size_t i;
+	int deposited = 0;
+	for (i = 0; i < pieces; ++i) {
+		const double angle = 2 * M_PI * (i + 0.5) / pieces;
+		const Vector radial = vectorSum(vectorMultiply(e1, cos(angle)), vectorMultiply(e2, sin(angle)));
+		const Vector tangent = vectorSum(vectorMultiply(e1, -sin(angle)), vectorMultiply(e2, cos(angle)));
+		deposited |= gridSolverDepositCurrent(solver, vectorSum(loop->center, vectorMultiply(radial, loop->radius)),
+			vectorMultiply(tangent, loop->I * pieceLength), loop->permeability);
+	}
+	return deposited;
+}
+
+size_t gridSolverDepositSources(GridSolver* solver, const FieldSourceSet* sources) {
+	const Conductor* elements = (const Conductor*) sources->sources[FIELD_SOURCE_ELEMENT];
+	const FieldSegment* segments = (const FieldSegment*) sources->sources[FIELD_SOURCE_SEGMENT];
+	const FieldLoop* loops = (const FieldLoop*) sources->sources[FIELD_SOURCE_LOOP];
+	const FieldCharge* charges = (const FieldCharge*) sources->sources[FIELD_SOURCE_CHARGE];
+	size_t i, result = 0;
+	for (i = 0; i < sources->counts[FIELD_SOURCE_ELEMENT]; ++i) {
+		const Conductor* c = elements + i;
+		result += gridSolverDepositCurrent(solver, vectorSum(c->position, c->l), vectorMultiply(c->l, c->I), c->permeability);
+	}
+	for (i = 0; i < sources->counts[FIELD_SOURCE_SEGMENT]; ++i) {
+		result += depositLine(solver, segments[i].start, segments[i].end, segments[i].I, segments[i].permeability);
+	}
+	for (i = 0; i < sources->counts[FIELD_SOURCE_LOOP]; ++i) {
+		result += depositLoop(solver, loops + i);
+	}
+	for (i = 0; i < sources->counts[FIELD_SOURCE_CHARGE]; ++i) {
+		result += gridSolverDepositCurrent(solver, charges[i].position, vectorMultiply(charges[i].velocity, charges[i].q), charges[i].permeability);
+	}
+	return result;
+}
+
+// B^ = m^ x (i k), scaled for the unnormalized inverse transform
+static void multiplyPlane(void* arg, size_t z) {
+	GridSolver* solver = (GridSolver*) arg;
+	const size_t planeCount = solver->padded[0] * solver->padded[1];
+	const double scale = 1.0 / getPaddedCount(solver);
+	double* mx = solver->moments[0];
+	double* my = solver->moments[1];
+	double* mz = solver->moments[2];
+	size_t i;
+	for (i = z * planeCount; i < (z + 1) * planeCount; ++i) {
+		const double kx = solver->kernel[0][i] * scale, ky = solver->kernel[1][i] * scale, kz = solver->kernel[2][i] * scale;
+		const double cxr = my[2 * i] * kz - mz[2 * i] * ky, cxi = my[2 * i + 1] * kz - mz[2 * i + 1] * ky;
+		const double cyr = mz[2 * i] * kx - mx[2 * i] * kz, cyi = mz[2 * i + 1] * kx - mx[2 * i + 1] * kz;
+		const double czr = mx[2 * i] * ky - my[2 * i] * kx, czi = mx[2 * i + 1] * ky - my[2 * i + 1] * kx;
+		mx[2 * i] = -cxi;
+		mx[2 * i + 1] = cxr;
+		my[2 * i] = -cyi;
+		my[2 * i + 1] = cyr;
+		mz[2 * i] = -czi;
+		mz[2 * i + 1] = czr;
+	}
+}
+
+static void extractPlane(void* arg, size_t z) {
+	GridSolver* solver = (GridSolver*) arg;
+	size_t x, y;
+	for (y = 0; y < solver->size[1]; ++y) {
+		for (x = 0; x < solver->size[0]; ++x) {
+			const size_t index = 2 * ((z * solver->padded[1] + y) * solver->padded[0] + x);
+			solver->field[(z * solver->size[1] + y) * solver->size[0] + x] = vectorCreate(
+				solver->moments[0][index], solver->moments[1][index], solver->moments[2][index]
+			);
+		}
+	}
+}
+
+// the deposits are used up, the next solve starts from an empty grid
+int gridSolverSolve(GridSolver* solver) {
+	int component;
+	if (!solver || !solver->kernelReady) {
+		return 0;
+	}
+	for (component = 0; component < 3; ++component) {
+		transform(solver, solver->moments[component], 0, 0);
+	}
+	parallelFor(solver, solver->padded[2], multiplyPlane, solver);
+	for (component = 0; component < 3; ++component) {
+		transform(solver, solver->moments[component], 1, 0);
+	}
+	parallelFor(solver, solver->size[2], extractPlane, solver);
+	gridSolverClear(solver);
+	return 1;
+}
+
+Vector gridSolverGetField(const GridSolver* solver, size_t x, size_t y, size_t z) {
+	return solver->field[(z * solver->size[1] + y) * solver->size[0] + x];
+}
+
+int gridSolverSample(const GridSolver* solver, Vector position, Vector* result) {
+	const double u[3] = {
+		(position.x - solver->origin.x) / solver->spacing,
+		(position.y - solver->origin.y) / solver->spacing,
+		(position.z - solver->origin.z) / solver->spacing
+	};
+	size_t from[3];
+	double weights[3];
+	int axis, corner;
+	for (axis = 0; axis < 3; ++axis) {
+		if (!(u[axis] >= 0 && u[axis] <= solver->size[axis] - 1)) {
+			return 0;
+		}
+		from[axis] = min((size_t) u[axis], solver->size[axis] - 2);
+		weights[axis] = u[axis] - from[axis];
+	}
+	*result = vectorZero;
+	for (corner = 0; corner < 8; ++corner) {
+		const double weight = (corner & 1 ? weights[0] : 1 - weights[0]) * ((corner >> 1) & 1 ? weights[1] : 1 - weights[1]) *
+			(corner >> 2 ? weights[2] : 1 - weights[2]);
+		*result = vectorSum(*result, vectorMultiply(gridSolverGetField(solver, from[0] + (corner & 1), from[1] + ((corner >> 1) & 1), from[2] + (corner >> 2)), weight));
+	}
+	return 1;
+}
@@ -0,0 +1,201 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/IsoMesh.h"
+
+#include <stdint.h>
+#include <math.h>
+
+#include "test/math/MathFunctions.h"
+#include "test/tools/MemoryStats.h"
+
+// cube corners, and the six tetrahedra around the 0-6 diagonal which tile the cube without ambiguous cases
+static const int _corners[8][3] = {
+	{ 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+	{ 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 }
+};
+static const int _tetrahedra[6][4] = {
+	{ 0, 5, 1, 6 }, { 0, 1, 2, 6 }, { 0, 2, 3, 6 },
+	{ 0, 3, 7, 6 }, { 0, 7, 4, 6 }, { 0, 4, 5, 6 }
+};
+
+typedef struct IsoGrid {
+	const float* samples;
+	int size;
+	double level;
+	Vector origin;
+	double spacing;
+} IsoGrid;
+
+static inline size_t sampleIndex(const IsoGrid* grid, int x, int y, int z) {
+	return ((size_t) x * grid->size + y) * grid->size + z;
+}
+
+static inline Vector getGradient(const IsoGrid* grid, int x, int y, int z) {
+	const float* s = grid->samples;
+	return vectorCreate(
+		s[sampleIndex(grid, x + 1, y, z)] - s[sampleIndex(grid, x - 1, y, z)],
+		s[sampleIndex(grid, x, y + 1, z)] - s[sampleIndex(grid, x, y - 1, z)],
+		s[sampleIndex(grid, x, y, z + 1)] - s[sampleIndex(grid, x, y, z - 1)]
+	);
+}
+
+// vertices on an edge shared by several tetrahedra or cubes are emitted once
+static unsigned int getEdgeVertex(IsoMesh* mesh, const IsoGrid* grid, const int* a, const int* b) {
+	size_t ia = sampleIndex(grid, a[0], a[1], a[2]);
+	size_t ib = sampleIndex(grid, b[0], b[1], b[2]);
+	if (ia > ib) {
+		const size_t t = ia;
+		const int* p = a;
+		ia = ib;
+		ib = t;
+		a = b;
+		b = p;
+	}
+	const uint64_t key = (uint64_t) ia << 32 | ib;
+	const uintptr_t found = (uintptr_t) mapGet(mesh->edges, key);
+	if (found) {
+		return (unsigned int) (found - 1);
+	}
+
+	const float va = grid->samples[ia];
+	const float vb = grid->samples[ib];
+	const float t = fabsf(vb - va) > 1.0e-12f ? (float) ((grid->level - va) / (vb - va)) : 0.5f;
+	const Vector normal = vectorNormalize(vectorGetOpposite(vectorLerp(getGradient(grid, a[0], a[1], a[2]), getGradient(grid, b[0], b[1], b[2]), t)));
+	if (mesh->vertexCount == mesh->vertexCapacity) {
+		mesh->vertexCapacity = mesh->vertexCapacity * 2 + 256;
+		mesh->vertices = (IsoMeshVertex*) memoryRealloc(MEMORY_TAG_RENDERING, mesh->vertices, sizeof(IsoMeshVertex) * mesh->vertexCapacity);
+	}
+	IsoMeshVertex* vertex = mesh->vertices + mesh->vertexCount;
+	vertex->x = (float) (grid->origin.x + lerp(a[0], b[0], t) * grid->spacing);
+	vertex->y = (float) (grid->origin.y + lerp(a[1], b[1], t) * grid->spacing);
+	vertex->z = (float) (grid->origin.z + lerp(a[2], b[2], t) * grid->spacing);
+	vertex->nx = (float) normal.x;
+	vertex->ny = (float) normal.y;
+	vertex->nz = (float) normal.z;
+	mapPut(mesh->edges, key, (void*) (uintptr_t) (mesh->vertexCount + 1));
+	return (unsigned int) mesh->vertexCount++;
+}
+
+static inline Vector getVertexPosition(const IsoMesh* mesh, unsigned int index) {
+	const IsoMeshVertex* vertex = mesh->vertices + index;
+	return vectorCreate(vertex->x, vertex->y, vertex->z);
+}
+
+// outward is any direction from the higher values to the lower ones, the triangle is turned to face it
+static void addTriangle(IsoMesh* mesh, unsigned int a, unsigned int b, unsigned int c, Vector outward) {
+	const Vector pa = getVertexPosition(mesh, a);
+	const Vector facing = vectorCrossProduct(vectorSubstract(getVertexPosition(mesh, b), pa), vectorSubstract(getVertexPosition(mesh, c), pa));
+	if (mesh->indexCount + 3 > mesh->indexCapacity) {
+		mesh->indexCapacity = mesh->indexCapacity * 2 + 768;
+		mesh->indices = (unsigned int*) memoryRealloc(MEMORY_TAG_RENDERING, mesh->indices, sizeof(unsigned int) * mesh->indexCapacity);
+	}
+	const int flip = vectorDotProduct(facing, outward) < 0;
+	mesh->indices[mesh->indexCount++] = a;
+	mesh->indices[mesh->indexCount++] = flip ? c : b;
+	mesh->indices[mesh->indexCount++] = flip ? b : c;
+}
+
+IsoMesh* isoMeshNew() {
+	IsoMesh* mesh = (IsoMesh*) memoryCalloc(MEMORY_TAG_RENDERING, 1, sizeof(IsoMesh));
+	if (mesh == NULL) {
+		return NULL;
+	}
+	mesh->edges = mapNew(4096);
+	return mesh;
+}
+
+void isoMeshFree(IsoMesh* mesh) {
+	if (mesh == NULL) {
+		return;
+	}
+	mapFree(mesh->edges);
+	memoryFree(MEMORY_TAG_RENDERING, mesh->vertices);
+	memoryFree(MEMORY_TAG_RENDERING, mesh->indices);
+	memoryFree(MEMORY_TAG_RENDERING, mesh);
+}
+
+void isoMeshExtract(IsoMesh* mesh, const float* samples, int size, double level, Vector origin, double spacing) {
+	const IsoGrid grid = { samples, size, level, origin, spacing };
+	int x, y, z, i, j;
+	if (mesh == NULL || samples == NULL) {
+		return;
+	}
+	mesh->vertexCount = 0;
+	mesh->indexCount = 0;
+	mapRemoveAll(mesh->edges);
+	for (x = 1; x < size - 2; ++x) {
+		for (y = 1; y < size - 2; ++y) {
+			for (z = 1; z < size - 2; ++z) {
+				int points[8][3];
+				float values[8];
+				int inside = 0;
+				for (i = 0; i < 8; ++i) {
+					points[i][0] = x + _corners[i][0];
+					points[i][1] = y + _corners[i][1];
+					points[i][2] = z + _corners[i][2];
+					values[i] = samples[sampleIndex(&grid, points[i][0], points[i][1], points[i][2])];
+					inside |= (values[i] > level) << i;
+				}
+				if (!inside || inside == 0xff) {
+					continue;
+				}
+				for (i = 0; i < 6; ++i) {
+					const int* t = _tetrahedra[i];
+					int in[4], out[4], inCount = 0, outCount = 0;
+					Vector inCenter = vectorZero, outCenter = vectorZero;
+					for (j = 0; j < 4; ++j) {
+						const Vector corner = vectorCreate(_corners[t[j]][0], _corners[t[j]][1], _corners[t[j]][2]);
+						if (values[t[j]] > level) {
+							in[inCount++] = t[j];
+							inCenter = vectorSum(inCenter, corner);
+						} else {
+							out[outCount++] = t[j];
+							outCenter = vectorSum(outCenter, corner);
+						}
+					}
+					if (!inCount || !outCount) {
+						continue;
+					}
+					// the inside and outside corners lie on either side of the surface
+					const Vector outward = vectorSubstract(vectorDivide(outCenter, outCount), vectorDivide(inCenter, inCount));
+					if (inCount == 1 || inCount == 3) {
+						const int apex = inCount == 1 ? in[0] : out[0];
+						const int* base = inCount == 1 ? out : in;
+						addTriangle(mesh,
+							getEdgeVertex(mesh, &grid, points[apex], points[base[0]]),
+							getEdgeVertex(mesh, &grid, points[apex], points[base[1]]),
+							getEdgeVertex(mesh, &grid, points[apex], points[base[2]]),
+							outward);
+					} else if (inCount == 2) {
+						// a quad around the tetrahedron, split along its a-c diagonal
+						const unsigned int a = getEdgeVertex(mesh, &grid, points[in[0]], points[out[0]]);
+						const unsigned int b = getEdgeVertex(mesh, &grid, points[in[0]], points[out[1]]);
+						const unsigned int c = getEdgeVertex(mesh, &grid, points[in[1]], points[out[1]]);
+						const unsigned int d = getEdgeVertex(mesh, &grid, points[in[1]], points[out[0]]);
+						addTriangle(mesh, a, b, c, outward);
+						addTriangle(mesh, a, c, d, outward);
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,276 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/JobSystem.h"
+
+#include "test/tools/MemoryStats.h"
+#include "test/tools/TimeTools.h"
+
+// must be called with the system mutex locked
+static void pushJob(JobSystem* system, Job* job, int front) {
+	job->next = NULL;
+	if (!system->head) {
+		system->head = system->tail = job;
+	} else if (front) {
+		job->next = system->head;
+		system->head = job;
+	} else {
+		system->tail->next = job;
+		system->tail = job;
+	}
+	pthread_cond_signal(&system->wake);
+}
+
+// must be called with the system mutex locked
+static Job* popJob(JobSystem* system) {
+	Job* job = system->head;
+	if (job) {
+		system->head = job->next;
+		if (!system->head) {
+			system->tail = NULL;
+		}
+		++system->activeJobs;
+	}
+	return job;
+}
+
+static inline int isStale(JobSystem* system, const Job* job) {
+	return job->generation != __atomic_load_n(&system->generation, __ATOMIC_ACQUIRE);
+}
+
+// must be called with the system mutex locked, releases the job and its continuations
+static void cancelJob(JobSystem* system, Job* job) {
+	while (job) {
+		Job* continuation = job->continuation;
+		++system->stats.jobsCancelled;
+		system->stats.workCancelled += job->pendingWork;
+		pthread_mutex_unlock(&system->mutex);
+		if (job->release) {
+			job->release(job, 1);
+		}
+		pthread_mutex_lock(&system->mutex);
+		job = continuation;
+	}
+}
+
+// must be called with the system mutex locked, returns with it locked
+static void finishJob(JobSystem* system) {
+	if (--system->activeJobs == 0 && !system->head) {
+		pthread_cond_broadcast(&system->idle);
+	}
+}
+
+// must be called with the system mutex locked, returns with it locked;
+// runs the job until it is done, cancelled or the deadline passes, returns 0 only in the last case
+static int runJob(JobSystem* system, Job* job, double deadline) {
+	while (job->pendingWork) {
+		if (system->cancelStale && isStale(system, job)) {
+			cancelJob(system, job);
+			finishJob(system);
+			return 1;
+		}
+		if (deadline > 0 && getTimeDetailed() >= deadline) {
+			pushJob(system, job, 1);
+			finishJob(system);
+			return 0;
+		}
+		pthread_mutex_unlock(&system->mutex);
+		size_t done = job->step(job);
+		pthread_mutex_lock(&system->mutex);
+		if (done > job->pendingWork) {
+			done = job->pendingWork;
+		}
+		job->pendingWork -= done;
+		system->stats.workDone += done;
+		if (isStale(system, job)) {
+			system->stats.workStale += done;
+		}
+	}
+
+	// the continuation goes first so a chain finishes before other jobs start
+	Job* continuation = job->continuation;
+	const unsigned long generation = job->generation;
+	++system->stats.jobsDone;
+	if (continuation) {
+		continuation->generation = generation;
+		pushJob(system, continuation, 1);
+	}
+	pthread_mutex_unlock(&system->mutex);
+	if (job->release) {
+		job->release(job, 0);
+	}
+	pthread_mutex_lock(&system->mutex);
+	finishJob(system);
+	return 1;
+}
+
+static void* onWorker(void* arg) {
+	JobSystem* system = (JobSystem*) arg;
+	pthread_mutex_lock(&system->mutex);
+	while (system->running) {
+		Job* job = popJob(system);
+		if (!job) {
+			pthread_cond_wait(&system->wake, &system->mutex);
+			continue;
+		}
+		runJob(system, job, 0);
+	}
+	pthread_mutex_unlock(&system->mutex);
+	return NULL;
+}
+
+JobSystem* jobSystemNew(size_t threadCount) {
+	JobSystem* system = (JobSystem*) memoryCalloc(MEMORY_TAG_COLLECTIONS, 1, sizeof(JobSystem));
+	if (system == NULL) {
+		return NULL;
+	}
+	system->threads = threadCount ? (pthread_t*) memoryAlloc(MEMORY_TAG_COLLECTIONS, sizeof(pthread_t) * threadCount) : NULL;
+	system->threadCount = threadCount;
+	system->cancelStale = 1;
+	system->running = 1;
+	pthread_mutex_init(&system->mutex, NULL);
+	pthread_cond_init(&system->wake, NULL);
+	pthread_cond_init(&system->idle, NULL);
+	size_t i;
+	for (i = 0; i < threadCount; ++i) {
+		pthread_create(system->threads + i, NULL, onWorker, system);
+	}
+	return system;
+}
+
+void jobSystemFree(JobSystem* system) {
+	if (system == NULL) {
+		return;
+	}
+	size_t i;
+	pthread_mutex_lock(&system->mutex);
+	system->running = 0;
+	pthread_cond_broadcast(&system->wake);
+	pthread_mutex_unlock(&system->mutex);
+	for (i = 0; i < system->threadCount; ++i) {
+		pthread_join(system->threads[i], NULL);
+	}
+
+	// whatever is still queued never runs
+	pthread_mutex_lock(&system->mutex);
+	while (system->head) {
+		Job* job = popJob(system);
+		cancelJob(system, job);
+		--system->activeJobs;
+	}
+	pthread_mutex_unlock(&system->mutex);
+	pthread_cond_destroy(&system->idle);
+	pthread_cond_destroy(&system->wake);
+	pthread_mutex_destroy(&system->mutex);
+	memoryFree(MEMORY_TAG_COLLECTIONS, system->threads);
+	memoryFree(MEMORY_TAG_COLLECTIONS, system);
+}
+
+void jobSystemSubmit(JobSystem* system, Job* job) {
+	if (system == NULL || job == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&system->mutex);
+	job->generation = __atomic_load_n(&system->generation, __ATOMIC_ACQUIRE);
+	pushJob(system, job, 0);
+	pthread_mutex_unlock(&system->mutex);
+}
+
+unsigned long jobSystemAdvance(JobSystem* system) {
+	if (system == NULL) {
+		return 0;
+	}
+	// no lock, so a thread which publishes a new context never waits for a running chunk
+	return __atomic_add_fetch(&system->generation, 1, __ATOMIC_ACQ_REL);
+}
+
+unsigned long jobSystemGetGeneration(JobSystem* system) {
+	if (system == NULL) {
+		return 0;
+	}
+	return __atomic_load_n(&system->generation, __ATOMIC_ACQUIRE);
+}
+
+void jobSystemSetCancelStale(JobSystem* system, int cancelStale) {
+	if (system == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&system->mutex);
+	system->cancelStale = cancelStale;
+	pthread_mutex_unlock(&system->mutex);
+}
+
+int jobSystemRun(JobSystem* system, double deadline) {
+	if (system == NULL) {
+		return 1;
+	}
+	int finished = 1;
+	pthread_mutex_lock(&system->mutex);
+	while (finished) {
+		Job* job = popJob(system);
+		if (!job) {
+			break;
+		}
+		finished = runJob(system, job, deadline);
+	}
+	pthread_mutex_unlock(&system->mutex);
+	return finished;
+}
+
+void jobSystemWait(JobSystem* system) {
+	if (system == NULL) {
+		return;
+	}
+	if (!system->threadCount) {
+		jobSystemRun(system, 0);
+		return;
+	}
+	pthread_mutex_lock(&system->mutex);
+	while (system->head || system->activeJobs) {
+		pthread_cond_wait(&system->idle, &system->mutex);
+	}
+	pthread_mutex_unlock(&system->mutex);
+}
+
+size_t jobSystemGetPendingWork(JobSystem* system) {
+	if (system == NULL) {
+		return 0;
+	}
+	size_t result = 0;
+	Job* job;
+	pthread_mutex_lock(&system->mutex);
+	for (job = system->head; job; job = job->next) {
+		result += job->pendingWork;
+	}
+	pthread_mutex_unlock(&system->mutex);
+	return result;
+}
+
+JobSystemStats jobSystemGetStats(JobSystem* system) {
+	JobSystemStats result = { 0, 0, 0, 0, 0 };
+	if (system == NULL) {
+		return result;
+	}
+	pthread_mutex_lock(&system->mutex);
+	result = system->stats;
+	pthread_mutex_unlock(&system->mutex);
+	return result;
+}
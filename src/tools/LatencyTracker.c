@@ -0,0 +1,244 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/LatencyTracker.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "test/tools/MemoryStats.h"
+
+#define RING_SIZE 1024 // a power of two, about 16 seconds of frames at 60 FPS between two reads
+#define RUN_BUCKETS 400
+#define RUN_MIN 1.0e-6
+#define RUN_RATIO 1.05 // bucket width, so run percentiles are within 5%
+
+struct LatencyTracker {
+	char name[32];
+	double budget;
+	// writer side
+	double ring[RING_SIZE];
+	uint64_t head;
+	// reader side, the window is kept both in arrival order, to know what leaves it, and sorted, to read percentiles
+	uint64_t tail;
+	double drained[RING_SIZE];
+	double window[LATENCY_WINDOW];
+	double sorted[LATENCY_WINDOW];
+	size_t windowStart;
+	size_t windowCount;
+	double windowSum;
+	unsigned long count;
+	unsigned long overBudget;
+	unsigned long dropped;
+	uint64_t runBuckets[RUN_BUCKETS];
+	double runMax;
+};
+
+static size_t lowerBound(const double* values, size_t count, double value) {
+	size_t from = 0, to = count;
+	while (from < to) {
+		const size_t middle = from + (to - from) / 2;
+		if (values[middle] < value) {
+			from = middle + 1;
+		} else {
+			to = middle;
+		}
+	}
+	return from;
+}
+
+static inline int getRunBucket(double seconds) {
+	if (!(seconds > RUN_MIN)) {
+		return 0;
+	}
+	const int bucket = 1 + (int) (log(seconds / RUN_MIN) / log(RUN_RATIO));
+	return bucket < RUN_BUCKETS ? bucket : RUN_BUCKETS - 1;
+}
+
+static void addSample(LatencyTracker* tracker, double sample) {
+	size_t index;
+	if (tracker->windowCount == LATENCY_WINDOW) {
+		const double evicted = tracker->window[tracker->windowStart];
+		tracker->window[tracker->windowStart] = sample;
+		tracker->windowStart = (tracker->windowStart + 1) % LATENCY_WINDOW;
+		tracker->windowSum -= evicted;
+		index = lowerBound(tracker->sorted, LATENCY_WINDOW, evicted);
+		memmove(tracker->sorted + index, tracker->sorted + index + 1, sizeof(double) * (LATENCY_WINDOW - index - 1));
+		--tracker->windowCount;
+	} else {
+		tracker->window[(tracker->windowStart + tracker->windowCount) % LATENCY_WINDOW] = sample;
+	}
+	index = lowerBound(tracker->sorted, tracker->windowCount, sample);
+	memmove(tracker->sorted + index + 1, tracker->sorted + index, sizeof(double) * (tracker->windowCount - index));
+	tracker->sorted[index] = sample;
+	++tracker->windowCount;
+	tracker->windowSum += sample;
+
+	++tracker->count;
+	if (tracker->budget > 0 && sample > tracker->budget) {
+		++tracker->overBudget;
+	}
+	++tracker->runBuckets[getRunBucket(sample)];
+	if (sample > tracker->runMax) {
+		tracker->runMax = sample;
+	}
+}
+
+static void drain(LatencyTracker* tracker) {
+	uint64_t head = __atomic_load_n(&tracker->head, __ATOMIC_ACQUIRE);
+	uint64_t position;
+	if (head - tracker->tail > RING_SIZE) {
+		tracker->dropped += (unsigned long) (head - RING_SIZE - tracker->tail);
+		tracker->tail = head - RING_SIZE;
+	}
+	for (position = tracker->tail; position < head; ++position) {
+		__atomic_load(&tracker->ring[position & (RING_SIZE - 1)], &tracker->drained[position - tracker->tail], __ATOMIC_RELAXED);
+	}
+	// the writer may have lapped the copy meanwhile, whatever it could have overwritten is dropped; it stores into the
+	// slot of lapped before publishing lapped + 1, so that slot counts as overwritten too
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	const uint64_t lapped = __atomic_load_n(&tracker->head, __ATOMIC_RELAXED);
+	for (position = tracker->tail; position < head; ++position) {
+		if (lapped - position >= RING_SIZE) {
+			++tracker->dropped;
+		} else {
+			addSample(tracker, tracker->drained[position - tracker->tail]);
+		}
+	}
+	tracker->tail = head;
+}
+
+static double getWindowPercentile(const LatencyTracker* tracker, double percentile) {
+	if (!tracker->windowCount) {
+		return 0;
+	}
+	const size_t rank = (size_t) ceil(percentile * tracker->windowCount);
+	return tracker->sorted[rank ? rank - 1 : 0];
+}
+
+static double getRunPercentile(const LatencyTracker* tracker, double percentile) {
+	const uint64_t rank = (uint64_t) ceil(percentile * tracker->count);
+	uint64_t seen = 0;
+	int bucket;
+	for (bucket = 0; bucket < RUN_BUCKETS; ++bucket) {
+		seen += tracker->runBuckets[bucket];
+		if (seen && seen >= rank) {
+			// geometric middle of the bucket, never more than what was actually seen
+			const double value = bucket ? RUN_MIN * pow(RUN_RATIO, bucket - 0.5) : RUN_MIN;
+			return value < tracker->runMax ? value : tracker->runMax;
+		}
+	}
+	return tracker->runMax;
+}
+
+LatencyTracker* latencyTrackerNew(const char* name, double budget) {
+	LatencyTracker* tracker = (LatencyTracker*) memoryCalloc(MEMORY_TAG_COLLECTIONS, 1, sizeof(LatencyTracker));
+	if (!tracker) {
+		return NULL;
+	}
+	snprintf(tracker->name, sizeof(tracker->name), "%s", name ? name : "");
+	tracker->budget = budget;
+	return tracker;
+}
+
+void latencyTrackerFree(LatencyTracker* tracker) {
+	memoryFree(MEMORY_TAG_COLLECTIONS, tracker);
+}
+
+void latencyTrackerSetBudget(LatencyTracker* tracker, double budget) {
+	if (!tracker) {
+		return;
+	}
+	tracker->budget = budget;
+}
+
+void latencyTrackerRecord(LatencyTracker* tracker, double seconds) {
+	if (!tracker) {
+		return;
+	}
+	const uint64_t head = __atomic_load_n(&tracker->head, __ATOMIC_RELAXED);
+	__atomic_store(&tracker->ring[head & (RING_SIZE - 1)], &seconds, __ATOMIC_RELAXED);
+	__atomic_store_n(&tracker->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void latencyTrackerGetStats(LatencyTracker* tracker, LatencyStats* stats) {
+	if (!tracker || !stats) {
+		return;
+	}
+	drain(tracker);
+	stats->count = tracker->count;
+	stats->overBudget = tracker->overBudget;
+	stats->dropped = tracker->dropped;
+	stats->budget = tracker->budget;
+	stats->mean = tracker->windowCount ? tracker->windowSum / tracker->windowCount : 0;
+	stats->p50 = getWindowPercentile(tracker, 0.50);
+	stats->p95 = getWindowPercentile(tracker, 0.95);
+	stats->p99 = getWindowPercentile(tracker, 0.99);
+	stats->max = tracker->windowCount ? tracker->sorted[tracker->windowCount - 1] : 0;
+	stats->runP50 = getRunPercentile(tracker, 0.50);
+	stats->runP95 = getRunPercentile(tracker, 0.95);
+	stats->runP99 = getRunPercentile(tracker, 0.99);
+	stats->runMax = tracker->runMax;
+}
+
+size_t latencyTrackerGetHistory(LatencyTracker* tracker, double* samples, size_t count) {
+	size_t i;
+	if (!tracker || !samples) {
+		return 0;
+	}
+	drain(tracker);
+	if (count > tracker->windowCount) {
+		count = tracker->windowCount;
+	}
+	const size_t first = tracker->windowStart + tracker->windowCount - count;
+	for (i = 0; i < count; ++i) {
+		samples[i] = tracker->window[(first + i) % LATENCY_WINDOW];
+	}
+	return count;
+}
+
+void latencyTrackerDump(LatencyTracker* tracker, FILE* file) {
+	LatencyStats stats;
+	if (!tracker || !file) {
+		return;
+	}
+	latencyTrackerGetStats(tracker, &stats);
+	fprintf(file, "{\"name\": \"%s\", \"count\": %lu, \"overBudget\": %lu, \"dropped\": %lu, \"budgetMs\": %.3f, "
+			"\"window\": {\"meanMs\": %.3f, \"p50Ms\": %.3f, \"p95Ms\": %.3f, \"p99Ms\": %.3f, \"maxMs\": %.3f}, "
+			"\"run\": {\"p50Ms\": %.3f, \"p95Ms\": %.3f, \"p99Ms\": %.3f, \"maxMs\": %.3f}}\n",
+		tracker->name,
+		stats.count,
+		stats.overBudget,
+		stats.dropped,
+		stats.budget * 1000,
+		stats.mean * 1000,
+		stats.p50 * 1000,
+		stats.p95 * 1000,
+		stats.p99 * 1000,
+		stats.max * 1000,
+		stats.runP50 * 1000,
+		stats.runP95 * 1000,
+		stats.runP99 * 1000,
+		stats.runMax * 1000
+	);
+	fflush(file);
+}
@@ -0,0 +1,154 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/MemoryStats.h"
+
+#include <pthread.h>
+#include <malloc.h>
+
+#include "test/tools/TimeTools.h"
+
+// every thread only writes its own allocation counters, readers sum all of them, so allocating never takes a lock
+typedef struct MemoryCounters {
+	uint64_t allocations[MEMORY_TAG_COUNT];
+	struct MemoryCounters* next;
+} MemoryCounters;
+
+static const char* _tagNames[MEMORY_TAG_COUNT] = { "fieldPoints", "sources", "collections", "rendering", "mapped" };
+
+static MemoryCounters* _allCounters = NULL;
+static pthread_mutex_t _countersMutex = PTHREAD_MUTEX_INITIALIZER;
+// the bytes are shared so every allocation can raise the peak, a short spike between two reads included
+static int64_t _currentBytes[MEMORY_TAG_COUNT];
+static int64_t _peakBytes[MEMORY_TAG_COUNT];
+
+#ifdef ENABLE_MEMORY_STATS
+
+static __thread MemoryCounters* _counters = NULL;
+
+static MemoryCounters* getCounters() {
+	if (_counters) {
+		return _counters;
+	}
+	// kept after the thread exits, its frees and allocations still add up in the totals
+	_counters = (MemoryCounters*) calloc(1, sizeof(MemoryCounters));
+	pthread_mutex_lock(&_countersMutex);
+	_counters->next = _allCounters;
+	_allCounters = _counters;
+	pthread_mutex_unlock(&_countersMutex);
+	return _counters;
+}
+
+static inline void account(MemoryTag tag, int64_t bytes, uint64_t allocations) {
+	MemoryCounters* counters = getCounters();
+	__atomic_store_n(&counters->allocations[tag], counters->allocations[tag] + allocations, __ATOMIC_RELAXED);
+	const int64_t current = __atomic_add_fetch(&_currentBytes[tag], bytes, __ATOMIC_RELAXED);
+	int64_t peak = __atomic_load_n(&_peakBytes[tag], __ATOMIC_RELAXED);
+	while (current > peak && !__atomic_compare_exchange_n(&_peakBytes[tag], &peak, current, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+void* memoryAlloc(MemoryTag tag, size_t size) {
+	void* result = malloc(size);
+	if (result) {
+		account(tag, (int64_t) malloc_usable_size(result), 1);
+	}
+	return result;
+}
+
+void* memoryCalloc(MemoryTag tag, size_t count, size_t size) {
+	void* result = calloc(count, size);
+	if (result) {
+		account(tag, (int64_t) malloc_usable_size(result), 1);
+	}
+	return result;
+}
+
+void* memoryRealloc(MemoryTag tag, void* pointer, size_t size) {
+	const int64_t oldSize = pointer ? (int64_t) malloc_usable_size(pointer) : 0;
+	void* result = realloc(pointer, size);
+	if (result) {
+		account(tag, (int64_t) malloc_usable_size(result) - oldSize, 1);
+	}
+	return result;
+}
+
+void memoryFree(MemoryTag tag, void* pointer) {
+	if (pointer) {
+		account(tag, -(int64_t) malloc_usable_size(pointer), 0);
+		free(pointer);
+	}
+}
+
+void memoryTrack(MemoryTag tag, int64_t bytes) {
+	account(tag, bytes, bytes > 0);
+}
+
+#endif
+
+const char* memoryGetTagName(MemoryTag tag) {
+	return tag < MEMORY_TAG_COUNT ? _tagNames[tag] : NULL;
+}
+
+void memoryGetStats(MemoryStats* stats) {
+	MemoryCounters* counters;
+	int tag;
+	const double now = getTimeDetailed();
+	const double elapsed = stats->time > 0 ? now - stats->time : 0;
+#ifdef ENABLE_MEMORY_STATS
+	stats->enabled = 1;
+#else
+	stats->enabled = 0;
+#endif
+	pthread_mutex_lock(&_countersMutex);
+	for (tag = 0; tag < MEMORY_TAG_COUNT; ++tag) {
+		MemoryTagStats* tagStats = stats->tags + tag;
+		const uint64_t previousAllocations = tagStats->allocations;
+		tagStats->allocations = 0;
+		for (counters = _allCounters; counters; counters = counters->next) {
+			tagStats->allocations += __atomic_load_n(&counters->allocations[tag], __ATOMIC_RELAXED);
+		}
+		tagStats->currentBytes = __atomic_load_n(&_currentBytes[tag], __ATOMIC_RELAXED);
+		tagStats->peakBytes = __atomic_load_n(&_peakBytes[tag], __ATOMIC_RELAXED);
+		tagStats->allocationRate = elapsed > 0 ? (tagStats->allocations - previousAllocations) / elapsed : 0;
+	}
+	pthread_mutex_unlock(&_countersMutex);
+	stats->time = now;
+}
+
+void memoryDumpStats(FILE* file) {
+	static MemoryStats stats;
+	int tag;
+	memoryGetStats(&stats);
+	fprintf(file, "{\"enabled\": %s, \"time\": %.3f, \"tags\": {", stats.enabled ? "true" : "false", stats.time);
+	for (tag = 0; tag < MEMORY_TAG_COUNT; ++tag) {
+		const MemoryTagStats* tagStats = stats.tags + tag;
+		fprintf(file, "%s\"%s\": {\"currentBytes\": %lld, \"peakBytes\": %lld, \"allocations\": %llu, \"allocationsPerSecond\": %.1f}",
+			tag ? ", " : "",
+			_tagNames[tag],
+			(long long) tagStats->currentBytes,
+			(long long) tagStats->peakBytes,
+			(unsigned long long) tagStats->allocations,
+			tagStats->allocationRate
+		);
+	}
+	fprintf(file, "}}\n");
+	fflush(file);
+}
@@ -0,0 +1,294 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/SharedField.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "test/tools/TimeTools.h"
+#include "test/tools/MemoryStats.h"
+
+#define SHARED_FIELD_VERSION 3
+#define SHARED_FIELD_PROBES 8
+#define SHARED_FIELD_TIMEOUT 2.0
+#define SHARED_FIELD_READ_ATTEMPTS 4096
+
+static const char _magic[4] = { 'M', 'T', 'S', 'F' };
+
+static inline size_t getRegionSize() {
+	return sizeof(SharedFieldHeader) + sizeof(SharedFieldRequest) * SHARED_FIELD_RING_SIZE + sizeof(SharedFieldChunk) * SHARED_FIELD_CHUNKS;
+}
+
+static inline size_t getChunkSlot(uint64_t chunkKey) {
+	chunkKey ^= chunkKey >> 33;
+	chunkKey *= 0xff51afd7ed558ccdULL;
+	chunkKey ^= chunkKey >> 33;
+	return (size_t) chunkKey;
+}
+
+static SharedField* mapRegion(int fd, const char* name, int owner) {
+	const size_t size = getRegionSize();
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+	memoryTrack(MEMORY_TAG_MAPPED, (int64_t) size);
+	SharedField* result = (SharedField*) calloc(1, sizeof(SharedField));
+	result->owner = owner;
+	result->size = size;
+	snprintf(result->name, sizeof(result->name), "%s", name);
+	result->header = (SharedFieldHeader*) data;
+	result->ring = (SharedFieldRequest*) ((char*) data + sizeof(SharedFieldHeader));
+	result->chunks = (SharedFieldChunk*) (result->ring + SHARED_FIELD_RING_SIZE);
+	return result;
+}
+
+// a segment is stale when it was fully created and the daemon that created it is gone
+static int isStaleRegion(const char* name) {
+	const int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		return errno == ENOENT;
+	}
+	struct stat info;
+	if (fstat(fd, &info) || (size_t) info.st_size < sizeof(SharedFieldHeader)) {
+		close(fd);
+		return 0;
+	}
+	void* data = mmap(NULL, sizeof(SharedFieldHeader), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return 0;
+	}
+	const SharedFieldHeader* header = (const SharedFieldHeader*) data;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	int stale = 0;
+	if (!memcmp(header->magic, _magic, sizeof(_magic)) && header->version == SHARED_FIELD_VERSION && header->ownerPid > 0) {
+		stale = kill((pid_t) header->ownerPid, 0) && errno == ESRCH;
+	}
+	munmap(data, sizeof(SharedFieldHeader));
+	return stale;
+}
+
+SharedField* sharedFieldCreate(uint64_t sceneHash) {
+	char name[64];
+	snprintf(name, sizeof(name), "/magnetictest-%016llx", (unsigned long long) sceneHash);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0 && errno == EEXIST) {
+		// never take a region over from a daemon which is still serving it
+		if (!isStaleRegion(name)) {
+			fprintf(stderr, "error: %s is in use by another daemon or was not fully created\n", name);
+			return NULL;
+		}
+		shm_unlink(name);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	}
+	if (fd < 0) {
+		return NULL;
+	}
+	if (ftruncate(fd, (off_t) getRegionSize())) {
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+	SharedField* result = mapRegion(fd, name, 1);
+	if (!result) {
+		shm_unlink(name);
+		return NULL;
+	}
+
+	// the magic goes last so viewers never see a half-initialized region
+	size_t i;
+	for (i = 0; i < SHARED_FIELD_RING_SIZE; ++i) {
+		result->ring[i].sequence = i;
+	}
+	result->header->version = SHARED_FIELD_VERSION;
+	result->header->sceneHash = sceneHash;
+	result->header->ownerPid = (int32_t) getpid();
+	sharedFieldHeartbeat(result);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(result->header->magic, _magic, sizeof(_magic));
+	return result;
+}
+
+SharedField* sharedFieldAttach(uint64_t sceneHash) {
+	char name[64];
+	snprintf(name, sizeof(name), "/magnetictest-%016llx", (unsigned long long) sceneHash);
+	const int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) {
+		return NULL;
+	}
+	SharedField* result = mapRegion(fd, name, 0);
+	if (!result) {
+		return NULL;
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (memcmp(result->header->magic, _magic, sizeof(_magic)) || result->header->version != SHARED_FIELD_VERSION ||
+		result->header->sceneHash != sceneHash) {
+		sharedFieldClose(result);
+		return NULL;
+	}
+	return result;
+}
+
+void sharedFieldClose(SharedField* field) {
+	if (!field) {
+		return;
+	}
+	munmap(field->header, field->size);
+	memoryTrack(MEMORY_TAG_MAPPED, -(int64_t) field->size);
+	if (field->owner) {
+		shm_unlink(field->name);
+	}
+	free(field);
+}
+
+void sharedFieldHeartbeat(SharedField* field) {
+	__atomic_store_n(&field->header->heartbeat, (uint64_t) (getTimeMonotonic() * 1000), __ATOMIC_RELEASE);
+}
+
+int sharedFieldIsAlive(const SharedField* field) {
+	if (!field) {
+		return 0;
+	}
+	const uint64_t heartbeat = __atomic_load_n(&field->header->heartbeat, __ATOMIC_ACQUIRE);
+	return getTimeMonotonic() * 1000 - heartbeat < SHARED_FIELD_TIMEOUT * 1000;
+}
+
+// bounded MPMC queue with a sequence number per slot, see Vyukov's algorithm
+int sharedFieldRequest(SharedField* field, uint64_t chunkKey) {
+	uint64_t position = __atomic_load_n(&field->header->enqueuePosition, __ATOMIC_RELAXED);
+	while (1) {
+		SharedFieldRequest* request = field->ring + (position & (SHARED_FIELD_RING_SIZE - 1));
+		const int64_t diff = (int64_t) (__atomic_load_n(&request->sequence, __ATOMIC_ACQUIRE) - position);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&field->header->enqueuePosition, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				request->chunkKey = chunkKey;
+				__atomic_store_n(&request->sequence, position + 1, __ATOMIC_RELEASE);
+				return 1;
+			}
+		} else if (diff < 0) {
+			return 0;
+		} else {
+			position = __atomic_load_n(&field->header->enqueuePosition, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+int sharedFieldNextRequest(SharedField* field, uint64_t* chunkKey) {
+	uint64_t position = __atomic_load_n(&field->header->dequeuePosition, __ATOMIC_RELAXED);
+	while (1) {
+		SharedFieldRequest* request = field->ring + (position & (SHARED_FIELD_RING_SIZE - 1));
+		const int64_t diff = (int64_t) (__atomic_load_n(&request->sequence, __ATOMIC_ACQUIRE) - (position + 1));
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&field->header->dequeuePosition, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				*chunkKey = request->chunkKey;
+				__atomic_store_n(&request->sequence, position + SHARED_FIELD_RING_SIZE, __ATOMIC_RELEASE);
+				return 1;
+			}
+		} else if (diff < 0) {
+			return 0;
+		} else {
+			position = __atomic_load_n(&field->header->dequeuePosition, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+// copies a consistent snapshot of the chunk key and optionally one sample
+static uint64_t readChunk(const SharedFieldChunk* chunk, unsigned int index, Vector* sample) {
+	int attempt;
+	for (attempt = 0; attempt < SHARED_FIELD_READ_ATTEMPTS; ++attempt) {
+		const uint64_t sequence = __atomic_load_n(&chunk->sequence, __ATOMIC_ACQUIRE);
+		if (sequence & 1) {
+			continue;
+		}
+		const uint64_t chunkKey = chunk->chunkKey;
+		if (sample) {
+			*sample = chunk->samples[index];
+		}
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&chunk->sequence, __ATOMIC_RELAXED) == sequence) {
+			return sequence ? chunkKey + 1 : 0;
+		}
+	}
+
+	// the writer died in the middle of an update
+	return 0;
+}
+
+int sharedFieldContains(SharedField* field, uint64_t chunkKey) {
+	const size_t slot = getChunkSlot(chunkKey);
+	size_t i;
+	for (i = 0; i < SHARED_FIELD_PROBES; ++i) {
+		if (readChunk(field->chunks + (slot + i) % SHARED_FIELD_CHUNKS, 0, NULL) == chunkKey + 1) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int sharedFieldRead(SharedField* field, int cellX, int cellY, int cellZ, Vector* result) {
+	unsigned int index;
+	const uint64_t chunkKey = fieldChunkLocate(cellX, cellY, cellZ, &index);
+	const size_t slot = getChunkSlot(chunkKey);
+	size_t i;
+	for (i = 0; i < SHARED_FIELD_PROBES; ++i) {
+		Vector sample;
+		if (readChunk(field->chunks + (slot + i) % SHARED_FIELD_CHUNKS, index, &sample) == chunkKey + 1) {
+			*result = sample;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void sharedFieldPublish(SharedField* field, uint64_t chunkKey, const Vector* samples) {
+	// only the daemon writes, so the slot choice needs no synchronization
+	const size_t slot = getChunkSlot(chunkKey);
+	SharedFieldChunk* victim = NULL;
+	size_t i;
+	for (i = 0; i < SHARED_FIELD_PROBES; ++i) {
+		SharedFieldChunk* chunk = field->chunks + (slot + i) % SHARED_FIELD_CHUNKS;
+		if (chunk->sequence && chunk->chunkKey == chunkKey) {
+			victim = chunk;
+			break;
+		}
+		if (!victim || (victim->sequence && (!chunk->sequence || chunk->stamp < victim->stamp))) {
+			victim = chunk;
+		}
+	}
+
+	const uint64_t sequence = victim->sequence;
+	__atomic_store_n(&victim->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	victim->chunkKey = chunkKey;
+	victim->stamp = ++field->header->computedChunks;
+	memcpy(victim->samples, samples, sizeof(victim->samples));
+	__atomic_store_n(&victim->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,131 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/ThreadPool.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+// must be called with the pool mutex locked, returns with it locked
+static void runTasks(ThreadPool* pool) {
+	while (pool->next < pool->count) {
+		const size_t index = pool->next++;
+		const ThreadPoolTask task = pool->task;
+		void* arg = pool->arg;
+		pthread_mutex_unlock(&pool->mutex);
+		task(arg, index);
+		pthread_mutex_lock(&pool->mutex);
+		if (++pool->finished == pool->count) {
+			pthread_cond_broadcast(&pool->done);
+		}
+	}
+}
+
+static void* onWorker(void* arg) {
+	ThreadPool* pool = (ThreadPool*) arg;
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->running) {
+		runTasks(pool);
+		pthread_cond_wait(&pool->wake, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+size_t threadPoolGetDefaultThreadCount() {
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 1 ? (size_t) count : 1;
+}
+
+ThreadPool* threadPoolNew(size_t threadCount) {
+	ThreadPool* result = (ThreadPool*) calloc(1, sizeof(ThreadPool));
+	if (!threadCount) {
+		threadCount = threadPoolGetDefaultThreadCount();
+	}
+
+	// the caller is one of the threads
+	result->threadCount = threadCount - 1;
+	result->threads = (pthread_t*) malloc(sizeof(pthread_t) * (result->threadCount + 1));
+	result->running = 1;
+	pthread_mutex_init(&result->callMutex, NULL);
+	pthread_mutex_init(&result->mutex, NULL);
+	pthread_cond_init(&result->wake, NULL);
+	pthread_cond_init(&result->done, NULL);
+	size_t i;
+	for (i = 0; i < result->threadCount; ++i) {
+		pthread_create(result->threads + i, NULL, onWorker, result);
+	}
+	return result;
+}
+
+void threadPoolFree(ThreadPool* pool) {
+	if (!pool) {
+		return;
+	}
+	pthread_mutex_lock(&pool->mutex);
+	pool->running = 0;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+	size_t i;
+	for (i = 0; i < pool->threadCount; ++i) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_mutex_destroy(&pool->callMutex);
+	free(pool->threads);
+	free(pool);
+}
+
+size_t threadPoolGetThreadCount(const ThreadPool* pool) {
+	if (!pool) {
+		return 0;
+	}
+	return pool->threadCount + 1;
+}
+
+void threadPoolParallelFor(ThreadPool* pool, size_t count, ThreadPoolTask task, void* arg) {
+	if (!count) {
+		return;
+	}
+	size_t i;
+	if (!pool) {
+		for (i = 0; i < count; ++i) {
+			task(arg, i);
+		}
+		return;
+	}
+	pthread_mutex_lock(&pool->callMutex);
+	pthread_mutex_lock(&pool->mutex);
+	pool->task = task;
+	pool->arg = arg;
+	pool->next = 0;
+	pool->count = count;
+	pool->finished = 0;
+	pthread_cond_broadcast(&pool->wake);
+	runTasks(pool);
+	while (pool->finished < pool->count) {
+		pthread_cond_wait(&pool->done, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	pthread_mutex_unlock(&pool->callMutex);
+}
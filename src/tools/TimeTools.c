@@ -30,6 +30,12 @@ double getTimeDetailed() {
 	return spec.tv_sec + spec.tv_nsec / 1.0e9;
 }
 
+double getTimeMonotonic() {
+	struct timespec spec;
+	clock_gettime(CLOCK_MONOTONIC, &spec);
+	return spec.tv_sec + spec.tv_nsec / 1.0e9;
+}
+
 unsigned long getTime() {
 	return (unsigned long) time(NULL);
 }
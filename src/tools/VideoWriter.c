@@ -0,0 +1,139 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test/tools/VideoWriter.h"
+
+#include <string.h>
+
+#include "test/tools/MemoryStats.h"
+
+// BT.601 full range in 16 bit fixed point
+#define LUMA(r, g, b) ((19595 * (r) + 38470 * (g) + 7471 * (b) + 32768) >> 16)
+#define CHROMA_B(r, g, b) ((-11059 * (r) - 21709 * (g) + 32768 * (b) + 8421375) >> 16)
+#define CHROMA_R(r, g, b) ((32768 * (r) - 27439 * (g) - 5329 * (b) + 8421375) >> 16)
+
+static inline const unsigned char* getRow(const VideoWriter* writer, const unsigned char* rgba, int bottomUp, int y) {
+	return rgba + (size_t) (bottomUp ? writer->height - 1 - y : y) * writer->width * 4;
+}
+
+static void convertRgb(const VideoWriter* writer, const unsigned char* rgba, int bottomUp) {
+	unsigned char* out = writer->buffer;
+	int x, y;
+	for (y = 0; y < writer->height; ++y) {
+		const unsigned char* in = getRow(writer, rgba, bottomUp, y);
+		for (x = 0; x < writer->width; ++x, in += 4) {
+			*out++ = in[0];
+			*out++ = in[1];
+			*out++ = in[2];
+		}
+	}
+}
+
+// chroma is averaged over 2x2 blocks, odd sizes repeat the last row or column
+static void convertYuv420(const VideoWriter* writer, const unsigned char* rgba, int bottomUp) {
+	const int chromaWidth = (writer->width + 1) / 2;
+	const int chromaHeight = (writer->height + 1) / 2;
+	unsigned char* lumaOut = writer->buffer;
+	unsigned char* blueOut = lumaOut + (size_t) writer->width * writer->height;
+	unsigned char* redOut = blueOut + (size_t) chromaWidth * chromaHeight;
+	int x, y;
+	for (y = 0; y < writer->height; ++y) {
+		const unsigned char* in = getRow(writer, rgba, bottomUp, y);
+		for (x = 0; x < writer->width; ++x, in += 4) {
+			*lumaOut++ = (unsigned char) LUMA(in[0], in[1], in[2]);
+		}
+	}
+	for (y = 0; y < chromaHeight; ++y) {
+		const unsigned char* top = getRow(writer, rgba, bottomUp, 2 * y);
+		const unsigned char* bottom = getRow(writer, rgba, bottomUp, 2 * y + 1 < writer->height ? 2 * y + 1 : 2 * y);
+		for (x = 0; x < chromaWidth; ++x) {
+			const int left = 8 * x;
+			const int right = 2 * x + 1 < writer->width ? left + 4 : left;
+			const int r = (top[left] + top[right] + bottom[left] + bottom[right] + 2) >> 2;
+			const int g = (top[left + 1] + top[right + 1] + bottom[left + 1] + bottom[right + 1] + 2) >> 2;
+			const int b = (top[left + 2] + top[right + 2] + bottom[left + 2] + bottom[right + 2] + 2) >> 2;
+			*blueOut++ = (unsigned char) CHROMA_B(r, g, b);
+			*redOut++ = (unsigned char) CHROMA_R(r, g, b);
+		}
+	}
+}
+
+static size_t getFrameSize(const VideoWriter* writer) {
+	if (writer->format == VIDEO_FORMAT_Y4M) {
+		return (size_t) writer->width * writer->height + 2 * (size_t) ((writer->width + 1) / 2) * ((writer->height + 1) / 2);
+	}
+	return (size_t) writer->width * writer->height * 3;
+}
+
+VideoWriter* videoWriterOpen(const char* path, int width, int height, int fps) {
+	if (!path || width <= 0 || height <= 0 || fps <= 0) {
+		return NULL;
+	}
+	VideoWriter* writer = (VideoWriter*) memoryCalloc(MEMORY_TAG_RENDERING, 1, sizeof(VideoWriter));
+	if (!writer) {
+		return NULL;
+	}
+	const size_t length = strlen(path);
+	writer->format = length > 4 && !strcmp(path + length - 4, ".y4m") ? VIDEO_FORMAT_Y4M : VIDEO_FORMAT_RAW;
+	writer->width = width;
+	writer->height = height;
+	writer->buffer = (unsigned char*) memoryAlloc(MEMORY_TAG_RENDERING, getFrameSize(writer));
+	writer->file = fopen(path, "wb");
+	if (!writer->buffer || !writer->file) {
+		videoWriterClose(writer);
+		return NULL;
+	}
+	if (writer->format == VIDEO_FORMAT_Y4M) {
+		fprintf(writer->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+	}
+	return writer;
+}
+
+int videoWriterWriteRgba(VideoWriter* writer, const unsigned char* rgba, int bottomUp) {
+	if (!writer || !rgba) {
+		return 0;
+	}
+	const size_t size = getFrameSize(writer);
+	if (writer->format == VIDEO_FORMAT_Y4M) {
+		convertYuv420(writer, rgba, bottomUp);
+		if (fputs("FRAME\n", writer->file) == EOF) {
+			return 0;
+		}
+	} else {
+		convertRgb(writer, rgba, bottomUp);
+	}
+	if (fwrite(writer->buffer, 1, size, writer->file) != size) {
+		return 0;
+	}
+	++writer->frames;
+	return 1;
+}
+
+void videoWriterClose(VideoWriter* writer) {
+	if (!writer) {
+		return;
+	}
+	if (writer->file) {
+		fclose(writer->file);
+	}
+	memoryFree(MEMORY_TAG_RENDERING, writer->buffer);
+	memoryFree(MEMORY_TAG_RENDERING, writer);
+}
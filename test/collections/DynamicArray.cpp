@@ -0,0 +1,52 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/collections/DynamicArray.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tDynamicArray)
+
+BOOST_AUTO_TEST_CASE(tarrayInsertRemove) {
+	DynamicArray* array = arrayNew(2);
+	static int values[6];
+	for (int i = 1; i < 5; ++i) {
+		arrayAppend(array, values + i);
+	}
+	arrayPrepend(array, values);
+	arrayInsert(array, values + 5, 5);
+	BOOST_REQUIRE_EQUAL(arrayGetLength(array), 6);
+	for (int i = 0; i < 6; ++i) {
+		BOOST_CHECK(arrayGetAt(array, i) == values + i);
+	}
+
+	arrayRemove(array, 0);
+	arrayRemoveSome(array, 1, 2);
+	BOOST_REQUIRE_EQUAL(arrayGetLength(array), 3);
+	BOOST_CHECK(arrayGetAt(array, 0) == values + 1);
+	BOOST_CHECK(arrayGetAt(array, 1) == values + 4);
+	BOOST_CHECK(arrayGetAt(array, 2) == values + 5);
+	arrayFree(array);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,64 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/collections/HashMap.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tHashMap)
+
+BOOST_AUTO_TEST_CASE(tmapPutGet) {
+	HashMap* map = mapNew(4);
+	int a = 1, b = 2;
+	mapPut(map, 10, &a);
+	mapPut(map, 20, &b);
+	BOOST_CHECK_EQUAL(mapGetLength(map), 2);
+	BOOST_CHECK(mapGet(map, 10) == &a);
+	BOOST_CHECK(mapGet(map, 20) == &b);
+	BOOST_CHECK(mapGet(map, 30) == NULL);
+	mapPut(map, 10, &b);
+	BOOST_CHECK_EQUAL(mapGetLength(map), 1 + 1);
+	BOOST_CHECK(mapGet(map, 10) == &b);
+	mapFree(map);
+}
+
+BOOST_AUTO_TEST_CASE(tmapRemove) {
+	HashMap* map = mapNew(1);
+	static int values[1000];
+	for (int i = 0; i < 1000; ++i) {
+		mapPut(map, (uint64_t) i * 7919, values + i);
+	}
+	for (int i = 0; i < 1000; i += 2) {
+		BOOST_CHECK(mapRemove(map, (uint64_t) i * 7919) == values + i);
+	}
+	BOOST_CHECK_EQUAL(mapGetLength(map), 500);
+	for (int i = 0; i < 1000; ++i) {
+		BOOST_CHECK_EQUAL(mapContains(map, (uint64_t) i * 7919), i % 2);
+	}
+	mapRemoveAll(map);
+	BOOST_CHECK_EQUAL(mapGetLength(map), 0);
+	BOOST_CHECK(!mapContains(map, 7919));
+	mapFree(map);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
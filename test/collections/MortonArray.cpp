@@ -0,0 +1,126 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <stdlib.h>
+
+extern "C" {
+#include <test/collections/MortonArray.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tMortonArray)
+
+static size_t countInBox(MortonArray* array, int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+	const uint64_t minCode = mortonEncode(minX, minY, minZ);
+	const uint64_t maxCode = mortonEncode(maxX, maxY, maxZ);
+	const size_t length = mortonArrayGetLength(array);
+	size_t i, result = 0;
+	for (i = mortonArrayNextInBox(array, 0, minCode, maxCode); i < length; i = mortonArrayNextInBox(array, i + 1, minCode, maxCode)) {
+		const int* cell = (const int*) mortonArrayGetAt(array, i);
+		BOOST_CHECK(cell[0] >= minX && cell[0] <= maxX && cell[1] >= minY && cell[1] <= maxY && cell[2] >= minZ && cell[2] <= maxZ);
+		++result;
+	}
+	return result;
+}
+
+static size_t countInBoxSlowly(MortonArray* array, int minX, int minY, int minZ, int maxX, int maxY, int maxZ) {
+	size_t i, result = 0;
+	for (i = 0; i < mortonArrayGetLength(array); ++i) {
+		const int* cell = (const int*) mortonArrayGetAt(array, i);
+		result += cell[0] >= minX && cell[0] <= maxX && cell[1] >= minY && cell[1] <= maxY && cell[2] >= minZ && cell[2] <= maxZ;
+	}
+	return result;
+}
+
+BOOST_AUTO_TEST_CASE(tEncodeDecode) {
+	const int cells[][3] = { { 0, 0, 0 }, { 1, 2, 3 }, { -1, -2, -3 }, { 1048575, -1048576, 12345 } };
+	for (size_t i = 0; i < sizeof(cells) / sizeof(cells[0]); ++i) {
+		int x, y, z;
+		mortonDecode(mortonEncode(cells[i][0], cells[i][1], cells[i][2]), &x, &y, &z);
+		BOOST_CHECK_EQUAL(x, cells[i][0]);
+		BOOST_CHECK_EQUAL(y, cells[i][1]);
+		BOOST_CHECK_EQUAL(z, cells[i][2]);
+	}
+	BOOST_CHECK(mortonEncode(-1, 0, 0) < mortonEncode(0, 0, 0));
+	BOOST_CHECK(mortonContains(mortonEncode(1, -1, 2), mortonEncode(0, -2, 0), mortonEncode(2, 0, 2)));
+	BOOST_CHECK(!mortonContains(mortonEncode(3, -1, 2), mortonEncode(0, -2, 0), mortonEncode(2, 0, 2)));
+}
+
+BOOST_AUTO_TEST_CASE(tBoxQueries) {
+	MortonArray* array = mortonArrayNew(MEMORY_TAG_COLLECTIONS, sizeof(int) * 3, 4);
+	srand(7);
+	for (int i = 0; i < 4000; ++i) {
+		int* cell = (int*) mortonArrayAppend(array, rand() % 40 - 20, rand() % 40 - 20, rand() % 40 - 20);
+		mortonDecode(mortonArrayGetCode(array, i), cell, cell + 1, cell + 2);
+		// half of them stay in the unsorted tail
+		if (i == 1999) {
+			BOOST_CHECK(mortonArrayNeedsSort(array));
+			mortonArraySort(array);
+			BOOST_CHECK(!mortonArrayNeedsSort(array));
+		}
+	}
+	for (int i = 0; i < 2; ++i) {
+		for (int j = 0; j < 50; ++j) {
+			const int minX = rand() % 40 - 20, minY = rand() % 40 - 20, minZ = rand() % 40 - 20;
+			const int maxX = minX + rand() % 16, maxY = minY + rand() % 16, maxZ = minZ + rand() % 16;
+			BOOST_CHECK_EQUAL(countInBox(array, minX, minY, minZ, maxX, maxY, maxZ), countInBoxSlowly(array, minX, minY, minZ, maxX, maxY, maxZ));
+		}
+		BOOST_CHECK_EQUAL(countInBox(array, -20, -20, -20, 19, 19, 19), 4000);
+		BOOST_CHECK_EQUAL(countInBox(array, 0, 0, 0, 0, 0, 0), countInBoxSlowly(array, 0, 0, 0, 0, 0, 0));
+		mortonArraySort(array);
+	}
+	for (size_t i = 1; i < mortonArrayGetLength(array); ++i) {
+		BOOST_CHECK(mortonArrayGetCode(array, i - 1) <= mortonArrayGetCode(array, i));
+	}
+
+	// two overlapping boxes, every item is kept once
+	const size_t inside = countInBoxSlowly(array, -10, -10, -10, 9, 9, 9);
+	const size_t insideBoth = countInBoxSlowly(array, 0, 0, 0, 9, 9, 9);
+	const size_t insideSecond = countInBoxSlowly(array, 0, 0, 0, 14, 14, 14);
+	const uint64_t minCodes[] = { mortonEncode(-10, -10, -10), mortonEncode(0, 0, 0) };
+	const uint64_t maxCodes[] = { mortonEncode(9, 9, 9), mortonEncode(14, 14, 14) };
+	BOOST_CHECK_EQUAL(mortonArrayRetain(array, minCodes, maxCodes, 2), 4000 - inside - insideSecond + insideBoth);
+	BOOST_CHECK_EQUAL(mortonArrayGetLength(array), inside + insideSecond - insideBoth);
+	BOOST_CHECK_EQUAL(countInBox(array, -10, -10, -10, 9, 9, 9), inside);
+	BOOST_CHECK_EQUAL(countInBox(array, 0, 0, 0, 14, 14, 14), insideSecond);
+	mortonArrayFree(array);
+}
+
+BOOST_AUTO_TEST_CASE(tFind) {
+	MortonArray* array = mortonArrayNew(MEMORY_TAG_COLLECTIONS, sizeof(int), 4);
+	for (int i = 0; i < 100; ++i) {
+		*(int*) mortonArrayAppend(array, i % 5 - 2, i / 5 % 5 - 2, i / 25) = i;
+		// the first half is found in the ordered part, the rest in the tail
+		if (i == 49) {
+			mortonArraySort(array);
+		}
+	}
+	for (int i = 0; i < 100; ++i) {
+		const size_t index = mortonArrayFind(array, i % 5 - 2, i / 5 % 5 - 2, i / 25);
+		BOOST_REQUIRE(index < mortonArrayGetLength(array));
+		BOOST_CHECK_EQUAL(*(const int*) mortonArrayGetAt(array, index), i);
+	}
+	BOOST_CHECK_EQUAL(mortonArrayFind(array, 3, 0, 0), mortonArrayGetLength(array));
+	BOOST_CHECK_EQUAL(mortonArrayFind(array, 0, 0, -1), mortonArrayGetLength(array));
+	mortonArrayFree(array);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,45 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/collections/PriorityQueue.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tPriorityQueue)
+
+BOOST_AUTO_TEST_CASE(tqueuePop) {
+	PriorityQueue* queue = queueNew(1);
+	static int values[] = { 5, 1, 4, 2, 3, 0 };
+	for (int i = 0; i < 6; ++i) {
+		queuePush(queue, values + i, values[i]);
+	}
+	BOOST_CHECK_EQUAL(queueGetLength(queue), 6);
+	BOOST_CHECK_EQUAL(queuePeekPriority(queue), 0);
+	for (int i = 0; i < 6; ++i) {
+		BOOST_CHECK_EQUAL(*(int*) queuePop(queue), i);
+	}
+	BOOST_CHECK(queuePop(queue) == NULL);
+	queueFree(queue);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,43 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+extern "C" {
+#include <test/math/Elliptic.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tElliptic)
+
+BOOST_AUTO_TEST_CASE(tellipticIntegralsKE) {
+	const double m[] = { 0, 0.5, 0.99 };
+	double K[3], E[3];
+	ellipticIntegralsKE(m, K, E, 3);
+	BOOST_CHECK_CLOSE(K[0], M_PI_2, 1.0e-12);
+	BOOST_CHECK_CLOSE(E[0], M_PI_2, 1.0e-12);
+	BOOST_CHECK_CLOSE(K[1], 1.8540746773013719, 1.0e-12);
+	BOOST_CHECK_CLOSE(E[1], 1.3506438810476755, 1.0e-12);
+	BOOST_CHECK_CLOSE(K[2], 3.6956373629898747, 1.0e-12);
+	BOOST_CHECK_CLOSE(E[2], 1.0159935450252240, 1.0e-12);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+extern "C" {
+#include <test/math/Fft.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tFft)
+
+BOOST_AUTO_TEST_CASE(tMatchesDft) {
+	const size_t n = 16;
+	FftPlan* plan = fftPlanNew(n);
+	BOOST_REQUIRE(plan);
+	double data[2 * n], input[2 * n];
+	for (size_t i = 0; i < 2 * n; ++i) {
+		input[i] = data[i] = std::sin(i * 1.7) + 0.25 * (i % 3);
+	}
+	fftTransform(plan, data, 1, 1, 0);
+	for (size_t k = 0; k < n; ++k) {
+		double re = 0, im = 0;
+		for (size_t j = 0; j < n; ++j) {
+			const double angle = -2 * M_PI * j * k / n;
+			re += input[2 * j] * std::cos(angle) - input[2 * j + 1] * std::sin(angle);
+			im += input[2 * j] * std::sin(angle) + input[2 * j + 1] * std::cos(angle);
+		}
+		BOOST_CHECK_SMALL(data[2 * k] - re, 1.0e-12);
+		BOOST_CHECK_SMALL(data[2 * k + 1] - im, 1.0e-12);
+	}
+	fftPlanFree(plan);
+
+	BOOST_CHECK(!fftPlanNew(12));
+	BOOST_CHECK_EQUAL(fftGetPaddedLength(17), 32u);
+	BOOST_CHECK_EQUAL(fftGetPaddedLength(16), 16u);
+}
+
+BOOST_AUTO_TEST_CASE(tStridedRoundTrip) {
+	// 8 sequences of length 32 side by side, transformed together and back
+	const size_t n = 32, count = 8;
+	FftPlan* plan = fftPlanNew(n);
+	BOOST_REQUIRE(plan);
+	double data[2 * n * count], input[2 * n * count];
+	for (size_t i = 0; i < 2 * n * count; ++i) {
+		input[i] = data[i] = std::cos(i * 0.37) * (i % 5);
+	}
+	fftTransform(plan, data, count, count, 0);
+	fftTransform(plan, data, count, count, 1);
+	for (size_t i = 0; i < 2 * n * count; ++i) {
+		BOOST_CHECK_SMALL(data[i] / n - input[i], 1.0e-12);
+	}
+	fftPlanFree(plan);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
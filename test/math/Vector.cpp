@@ -21,7 +21,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+extern "C" {
 #include <test/math/Vector.h>
+}
 
 BOOST_AUTO_TEST_SUITE(tVector)
 
@@ -92,4 +94,11 @@ BOOST_AUTO_TEST_CASE(tvectorNormalize) {
 	BOOST_CHECK_EQUAL(vectorGetLength(vectorNormalize(a)), 1);
 }
 
+BOOST_AUTO_TEST_CASE(tvectorLerp) {
+	Vector a = { 1, 2, 3 };
+	Vector b = { 5, -2, 7 };
+	Vector r = { 2, 1, 4 };
+	BOOST_CHECK(vectorIsEqual(vectorLerp(a, b, 0.25), r));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,122 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <stdio.h>
+#include <pthread.h>
+
+extern "C" {
+#include <test/physics/FieldScene.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tFieldScene)
+
+struct SceneJob {
+	double current;
+	double result;
+};
+
+static void* evaluateOwnScene(void* arg) {
+	SceneJob* job = (SceneJob*) arg;
+	FieldScene* scene = fieldSceneNew();
+	FieldSource source = {};
+	source.type = FIELD_SOURCE_SEGMENT;
+	source.segment = (FieldSegment) { { 0, 0, -1.0e5 }, { 0, 0, 1.0e5 }, job->current, 0.25 };
+	fieldSceneAddSource(scene, &source);
+	const Vector position = { 2, 0, 0 };
+	for (int i = 0; i < 1000; ++i) {
+		Vector result = { 0, 0, 0 };
+		fieldSceneEvaluate(scene, &position, &result, 1);
+		job->result = result.y;
+	}
+	fieldSceneFree(scene);
+	return NULL;
+}
+
+BOOST_AUTO_TEST_CASE(tScenesAreIndependent) {
+	pthread_t threads[4];
+	SceneJob jobs[4];
+	for (int i = 0; i < 4; ++i) {
+		jobs[i] = (SceneJob) { 100.0 * (i + 1), 0 };
+		pthread_create(threads + i, NULL, evaluateOwnScene, jobs + i);
+	}
+	for (int i = 0; i < 4; ++i) {
+		pthread_join(threads[i], NULL);
+		BOOST_CHECK_CLOSE(jobs[i].result, 0.25 * jobs[i].current / (2 * M_PI * 2), 1.0e-4);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(tfieldSceneUpdateSource) {
+	FieldScene* scene = fieldSceneNew();
+	FieldSource source = {}, previous;
+	source.type = FIELD_SOURCE_DIPOLE;
+	source.dipole = (FieldDipole) { { 0, 0, 0 }, { 0, 0, 1 }, 0.25 };
+	BOOST_CHECK_EQUAL(fieldSceneAddSource(scene, &source), 0);
+	const uint64_t hash = fieldSceneGetHash(scene, 0);
+	source.dipole.moment.z = 2;
+	BOOST_CHECK(fieldSceneUpdateSource(scene, 0, &source, &previous));
+	BOOST_CHECK_EQUAL(previous.dipole.moment.z, 1);
+	BOOST_CHECK(fieldSceneGetHash(scene, 0) != hash);
+	BOOST_CHECK(!fieldSceneUpdateSource(scene, 1, &source, NULL));
+	BOOST_CHECK(fieldSceneRemoveSource(scene, FIELD_SOURCE_DIPOLE, 0, NULL));
+	BOOST_CHECK_EQUAL(fieldSceneGetSourceCount(scene, FIELD_SOURCE_TYPE_COUNT), 0);
+	BOOST_CHECK_EQUAL(fieldSceneGetGeneration(scene), 3);
+	fieldSceneFree(scene);
+}
+
+BOOST_AUTO_TEST_CASE(tLoad) {
+	FILE* file = tmpfile();
+	fputs("# comment\nsegment 0 0 -1 0 0 1 100 0.25\n\ndipole 1 2 3 0 0 5 1\n", file);
+	rewind(file);
+	FieldScene* scene = fieldSceneNew();
+	BOOST_CHECK_EQUAL(fieldSceneLoad(scene, file, "test"), 2);
+	BOOST_CHECK_EQUAL(fieldSceneGetSourceCount(scene, FIELD_SOURCE_SEGMENT), 1);
+	BOOST_CHECK_EQUAL(fieldSceneGetSourceCount(scene, FIELD_SOURCE_DIPOLE), 1);
+	FieldSource source;
+	fieldSceneGetSource(scene, FIELD_SOURCE_DIPOLE, 0, &source);
+	BOOST_CHECK_EQUAL(source.dipole.moment.z, 5);
+
+	rewind(file);
+	fputs("segment 0 0\n", file);
+	rewind(file);
+	BOOST_CHECK_EQUAL(fieldSceneLoad(scene, file, "test"), -1);
+	fclose(file);
+	fieldSceneFree(scene);
+}
+
+BOOST_AUTO_TEST_CASE(tLoadKeepsSceneOnError) {
+	FieldScene* scene = fieldSceneNew();
+	const unsigned long generation = fieldSceneGetGeneration(scene);
+	const char* files[] = { "dipole 1 2 3 0 0 5 1\nsegment 0 0\n", "dipole 1 2 3 0 0 5 1\ncoil 1 2 3\n" };
+	for (int i = 0; i < 2; ++i) {
+		FILE* file = tmpfile();
+		fputs(files[i], file);
+		rewind(file);
+		BOOST_CHECK_EQUAL(fieldSceneLoad(scene, file, "test"), -1);
+		fclose(file);
+	}
+	BOOST_CHECK_EQUAL(fieldSceneGetSourceCount(scene, FIELD_SOURCE_TYPE_COUNT), 0);
+	BOOST_CHECK_EQUAL(fieldSceneGetGeneration(scene), generation);
+	fieldSceneFree(scene);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
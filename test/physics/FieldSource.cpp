@@ -0,0 +1,128 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/physics/FieldSource.h>
+#include <test/physics/electromagnetism.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tFieldSource)
+
+BOOST_AUTO_TEST_CASE(tSegmentLongWire) {
+	// far from its ends a long segment is an infinite wire, B = mu I / (2 pi d)
+	FieldSource source = {};
+	source.type = FIELD_SOURCE_SEGMENT;
+	source.segment = (FieldSegment) { { 0, 0, -1.0e5 }, { 0, 0, 1.0e5 }, 100, 0.25 };
+	const Vector position = { 2, 0, 0 };
+	Vector result = { 0, 0, 0 };
+	fieldSourceEvaluate(&source, 1, &position, &result, 1);
+	BOOST_CHECK_CLOSE(result.y, 0.25 * 100 / (2 * M_PI * 2), 1.0e-4);
+	BOOST_CHECK_SMALL(result.x, 1.0e-12);
+	BOOST_CHECK_SMALL(result.z, 1.0e-12);
+}
+
+BOOST_AUTO_TEST_CASE(tLoopFarFieldIsDipole) {
+	FieldSource loop = {};
+	loop.type = FIELD_SOURCE_LOOP;
+	loop.loop = (FieldLoop) { { 1, 2, 3 }, { 0, 0, 1 }, 0.5, 40, 0.25 };
+	FieldSource dipole = {};
+	dipole.type = FIELD_SOURCE_DIPOLE;
+	dipole.dipole = (FieldDipole) { { 1, 2, 3 }, { 0, 0, 40 * M_PI * 0.25 }, 0.25 };
+	const Vector positions[] = { { 1, 2, 60 }, { 50, 2, 3 }, { 31, 32, 33 } };
+	Vector fromLoop[3] = {}, fromDipole[3] = {};
+	fieldSourceEvaluate(&loop, 1, positions, fromLoop, 3);
+	fieldSourceEvaluate(&dipole, 1, positions, fromDipole, 3);
+	for (int i = 0; i < 3; ++i) {
+		BOOST_CHECK_SMALL(vectorGetLength(vectorSubstract(fromLoop[i], fromDipole[i])), vectorGetLength(fromDipole[i]) * 0.01);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(tLoopMatchesDenseSegments) {
+	const int segmentCount = 4096;
+	const Vector center = { 2, -1, 3 };
+	const Vector normal = vectorNormalize(vectorCreate(1, 2, 2));
+	const Vector u = vectorNormalize(vectorCrossProduct(normal, vectorCreate(1, 0, 0)));
+	const Vector v = vectorCrossProduct(normal, u);
+	FieldSource loop = {};
+	loop.type = FIELD_SOURCE_LOOP;
+	loop.loop = (FieldLoop) { center, normal, 3, 500, 0.25 };
+	FieldSourceSet* segments = fieldSourceSetNew();
+	for (int i = 0; i < segmentCount; ++i) {
+		const double from = 2 * M_PI * i / segmentCount, to = 2 * M_PI * (i + 1) / segmentCount;
+		FieldSource segment = {};
+		segment.type = FIELD_SOURCE_SEGMENT;
+		segment.segment = (FieldSegment) {
+			vectorSum(center, vectorSum(vectorMultiply(u, 3 * cos(from)), vectorMultiply(v, 3 * sin(from)))),
+			vectorSum(center, vectorSum(vectorMultiply(u, 3 * cos(to)), vectorMultiply(v, 3 * sin(to)))),
+			500, 0.25
+		};
+		fieldSourceSetAdd(segments, &segment);
+	}
+	const Vector positions[] = { center, vectorSum(center, vectorMultiply(normal, 4)), { 0, 0, 0 }, { 7, 5, -2 }, { -20, 14, 9 } };
+	Vector exact[5] = {}, dense[5] = {};
+	fieldSourceEvaluate(&loop, 1, positions, exact, 5);
+	fieldSourceSetEvaluate(segments, positions, dense, 5);
+	for (int i = 0; i < 5; ++i) {
+		BOOST_CHECK_SMALL(vectorGetLength(vectorSubstract(exact[i], dense[i])), vectorGetLength(exact[i]) * 1.0e-5);
+	}
+	// on the axis B = mu I a^2 / (2 (a^2 + z^2)^(3/2))
+	BOOST_CHECK_CLOSE(vectorDotProduct(exact[1], normal), 0.25 * 500 * 9 / (2 * pow(9 + 16, 1.5)), 1.0e-9);
+	fieldSourceSetFree(segments);
+}
+
+BOOST_AUTO_TEST_CASE(tSetEvaluateMixed) {
+	FieldSource sources[4] = {};
+	sources[0].type = FIELD_SOURCE_ELEMENT;
+	sources[1].type = FIELD_SOURCE_CHARGE;
+	sources[2].type = FIELD_SOURCE_ELEMENT;
+	sources[3].type = FIELD_SOURCE_SEGMENT;
+	sources[0].element = (Conductor) { { 12, -12, -12 }, 6000, 0.25, { 4, 0.6, 0.6 } };
+	sources[1].charge = (FieldCharge) { { 0, 5, 0 }, { 1, 0, 0 }, 300, 0.25 };
+	sources[2].element = (Conductor) { { 12, 12, 12 }, 9000, 0.25, { 4, 0.9, 0.9 } };
+	sources[3].segment = (FieldSegment) { { -4, 0, 0 }, { -4, 8, 0 }, 500, 0.25 };
+	const Vector positions[] = { { 0, 0, 0 }, { 8, -16, 24 } };
+	Vector expected[2] = {}, results[2] = {};
+
+	FieldSourceSet* set = fieldSourceSetNew();
+	for (int i = 0; i < 4; ++i) {
+		fieldSourceSetAdd(set, sources + i);
+		fieldSourceEvaluate(sources + i, 1, positions, expected, 2);
+	}
+	BOOST_CHECK_EQUAL(fieldSourceSetGetCount(set, FIELD_SOURCE_ELEMENT), 2);
+	BOOST_CHECK_EQUAL(fieldSourceSetGetTotalCount(set), 4);
+	fieldSourceSetEvaluate(set, positions, results, 2);
+	for (int i = 0; i < 2; ++i) {
+		BOOST_CHECK_CLOSE(results[i].x, expected[i].x, 1.0e-9);
+		BOOST_CHECK_CLOSE(results[i].y, expected[i].y, 1.0e-9);
+		BOOST_CHECK_CLOSE(results[i].z, expected[i].z, 1.0e-9);
+	}
+
+	FieldSource found;
+	BOOST_CHECK(fieldSourceSetRemove(set, FIELD_SOURCE_ELEMENT, 0));
+	BOOST_CHECK(fieldSourceSetGet(set, FIELD_SOURCE_ELEMENT, 0, &found));
+	BOOST_CHECK_EQUAL(found.element.I, 9000);
+	BOOST_CHECK(!fieldSourceSetGet(set, FIELD_SOURCE_ELEMENT, 1, &found));
+	fieldSourceSetFree(set);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
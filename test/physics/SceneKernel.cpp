@@ -0,0 +1,72 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <math.h>
+
+extern "C" {
+#include <test/physics/SceneKernel.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tSceneKernel)
+
+BOOST_AUTO_TEST_CASE(tSpecializationMatchesGeneric) {
+	const FieldSceneSpecialization* specialization = sceneKernelGetSpecialization();
+	if (!specialization) {
+		return; // built without FIELD_SCENE_FILE
+	}
+	FieldScene* generic = fieldSceneNew();
+	FieldScene* specialized = fieldSceneNew();
+	fieldSceneAddDefaultSources(generic);
+	fieldSceneAddDefaultSources(specialized);
+	fieldSceneSetSpecialization(specialized, specialization);
+	BOOST_REQUIRE(fieldSceneGetSpecialization(specialized) != NULL);
+	BOOST_CHECK(fieldSceneGetSpecialization(generic) == NULL);
+
+	Vector positions[64];
+	Vector expected[64] = {};
+	Vector results[64] = {};
+	for (int i = 0; i < 64; ++i) {
+		positions[i] = (Vector) { (i % 4) * 9.0 - 13.5, (i / 4 % 4) * 9.0 - 13.5, (i / 16) * 9.0 - 13.5 };
+	}
+	fieldSceneEvaluate(generic, positions, expected, 64);
+	fieldSceneEvaluate(specialized, positions, results, 64);
+	for (int i = 0; i < 64; ++i) {
+		const double scale = 1e-12 * (1 + sqrt(expected[i].x * expected[i].x + expected[i].y * expected[i].y + expected[i].z * expected[i].z));
+		BOOST_CHECK_SMALL(results[i].x - expected[i].x, scale);
+		BOOST_CHECK_SMALL(results[i].y - expected[i].y, scale);
+		BOOST_CHECK_SMALL(results[i].z - expected[i].z, scale);
+	}
+
+	// any edit falls back to the generic kernels until the scene is back to the generated one
+	FieldSource source = {};
+	source.type = FIELD_SOURCE_CHARGE;
+	source.charge = (FieldCharge) { { 1, 1, 1 }, { 0, 0, 1 }, 1, 1 };
+	fieldSceneAddSource(specialized, &source);
+	BOOST_CHECK(fieldSceneGetSpecialization(specialized) == NULL);
+	fieldSceneRemoveSource(specialized, FIELD_SOURCE_CHARGE, 0, NULL);
+	BOOST_CHECK(fieldSceneGetSpecialization(specialized) != NULL);
+
+	fieldSceneFree(generic);
+	fieldSceneFree(specialized);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,55 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/physics/electromagnetism.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tElectromagnetism)
+
+BOOST_AUTO_TEST_CASE(tcalculateMagneticFieldPoints) {
+	const Vector l = { 4, 0.6, 0.6 };
+	const Vector origin = { 12, -12, -12 };
+	const Vector positions[] = { { 0, 0, 0 }, { 8, -16, 24 }, { -40, 8, 16 } };
+	Vector results[] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+	calculateMagneticFieldPoints(6000, 0.25, l, origin, positions, results, 3);
+	for (int i = 0; i < 3; ++i) {
+		const Vector expected = calculateMagneticFieldPoint(6000, 0.25, l, vectorSubstract(positions[i], origin));
+		BOOST_CHECK_CLOSE(results[i].x, expected.x, 1.0e-9);
+		BOOST_CHECK_CLOSE(results[i].y, expected.y, 1.0e-9);
+		BOOST_CHECK_CLOSE(results[i].z, expected.z, 1.0e-9);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(tcalculateMagneticFieldPointsDelta) {
+	const Vector l = { 4, 0.3, 0.3 };
+	const Vector positions[] = { { 0, 0, 0 }, { 8, 8, 8 } };
+	Vector results[] = { { 1, 2, 3 }, { 4, 5, 6 } };
+	calculateMagneticFieldPoints(1000, 0.25, l, vectorCreate(12, -12, 12), positions, results, 2);
+	calculateMagneticFieldPoints(-1000, 0.25, l, vectorCreate(12, -12, 12), positions, results, 2);
+	BOOST_CHECK_CLOSE(results[0].x, 1, 1.0e-9);
+	BOOST_CHECK_CLOSE(results[0].z, 3, 1.0e-9);
+	BOOST_CHECK_CLOSE(results[1].y, 5, 1.0e-9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
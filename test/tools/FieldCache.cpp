@@ -0,0 +1,73 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+
+extern "C" {
+#include <test/tools/FieldCache.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tFieldCache)
+
+BOOST_AUTO_TEST_CASE(tfieldCachePersist) {
+	const char* path = "FieldCacheTest.cache";
+	remove(path);
+	FieldCache* cache = fieldCacheOpen(path, 1 << 20);
+	BOOST_REQUIRE(cache != NULL);
+	fieldCacheStore(cache, 42, -3, 5, 7, vectorCreate(1, 2, 3));
+	fieldCacheClose(cache);
+
+	Vector result = vectorZero;
+	cache = fieldCacheOpen(path, 1 << 20);
+	BOOST_REQUIRE(cache != NULL);
+	BOOST_CHECK(fieldCacheLookup(cache, 42, -3, 5, 7, &result));
+	// samples are kept packed
+	BOOST_CHECK_SMALL(vectorGetLength(vectorSubstract(result, vectorCreate(1, 2, 3))), vectorGetLength(vectorCreate(1, 2, 3)) * (FIELD_SAMPLE_MAX_ANGLE_ERROR + FIELD_SAMPLE_MAX_MAGNITUDE_ERROR));
+	BOOST_CHECK(!fieldCacheLookup(cache, 43, -3, 5, 7, &result));
+	BOOST_CHECK(!fieldCacheLookup(cache, 42, -3, 5, 6, &result));
+	fieldCacheClose(cache);
+	remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(tfieldCacheCorrupted) {
+	const char* path = "FieldCacheTest.cache";
+	remove(path);
+	FieldCache* cache = fieldCacheOpen(path, 1 << 20);
+	BOOST_REQUIRE(cache != NULL);
+	fieldCacheStore(cache, 42, 0, 0, 0, vectorCreate(1, 2, 3));
+	fieldCacheSync(cache);
+	size_t i;
+	for (i = 0; i < cache->header->recordCount; ++i) {
+		cache->records[i].samples[0] ^= 1;
+	}
+	fieldCacheClose(cache);
+
+	Vector result;
+	cache = fieldCacheOpen(path, 1 << 20);
+	BOOST_REQUIRE(cache != NULL);
+	BOOST_CHECK(!fieldCacheLookup(cache, 42, 0, 0, 0, &result));
+	fieldCacheClose(cache);
+	remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
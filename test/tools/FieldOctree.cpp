@@ -0,0 +1,65 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/tools/FieldOctree.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tFieldOctree)
+
+BOOST_AUTO_TEST_CASE(tRefinesNearSources) {
+	FieldSourceSet* sources = fieldSourceSetNew();
+	FieldSource source = {};
+	source.type = FIELD_SOURCE_SEGMENT;
+	source.segment = (FieldSegment) { { 0, 0, -1.0e3 }, { 0, 0, 1.0e3 }, 100, 0.25 };
+	fieldSourceSetAdd(sources, &source);
+	const Vector center = { 0.5, 0.5, 0.5 };
+	FieldOctree* tree = fieldOctreeBuild(sources, center, 32, 0.02, 2, 7);
+	BOOST_REQUIRE(tree);
+	BOOST_CHECK_LT(tree->sampleCount * 10, fieldOctreeGetUniformSampleCount(tree));
+
+	// finest cells hug the wire, coarse ones stay far from it
+	const Vector nearWire = { 0.75, 0.75, 4 }, farFromWire = { 28, 28, 4 };
+	const FieldOctreeNode* nearLeaf = fieldOctreeFindLeaf(tree, nearWire);
+	const FieldOctreeNode* farLeaf = fieldOctreeFindLeaf(tree, farFromWire);
+	BOOST_REQUIRE(nearLeaf && farLeaf);
+	BOOST_CHECK_GT(nearLeaf->depth, farLeaf->depth);
+
+	const Vector positions[] = { { 10, -7, 3 }, { -20, 15, -9 }, { 5, 25, 20 } };
+	Vector exact[3] = {};
+	fieldSourceSetEvaluate(sources, positions, exact, 3);
+	for (int i = 0; i < 3; ++i) {
+		Vector sampled;
+		BOOST_REQUIRE(fieldOctreeSample(tree, positions[i], &sampled));
+		BOOST_CHECK_SMALL(vectorGetLength(vectorSubstract(sampled, exact[i])), vectorGetLength(exact[i]) * 0.05);
+	}
+
+	Vector outside;
+	const Vector outsidePosition = { 100, 0, 0 };
+	BOOST_CHECK(!fieldOctreeSample(tree, outsidePosition, &outside));
+	BOOST_CHECK(!fieldOctreeFindLeaf(tree, outsidePosition));
+	fieldOctreeFree(tree);
+	fieldSourceSetFree(sources);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
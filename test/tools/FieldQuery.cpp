@@ -0,0 +1,74 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <stdio.h>
+
+extern "C" {
+#include <test/tools/FieldQuery.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tFieldQuery)
+
+BOOST_AUTO_TEST_CASE(tfieldQueryRun) {
+	FieldScene* scene = fieldSceneNew();
+	fieldSceneAddDefaultSources(scene);
+	FILE* input = tmpfile();
+	FILE* output = tmpfile();
+	const int pointCount = 1000;
+	for (int i = 0; i < pointCount; ++i) {
+		fprintf(input, i % 2 ? "%d, %d, %d\n" : "%d %d %d # comment\n\n", i % 37 - 18, i % 23 - 11, i % 41 - 20);
+	}
+	rewind(input);
+
+	// small batches so every stage handles several of them
+	FieldQueryOptions options = { input, output, 0, 1, 64, 2 };
+	FieldQueryStats stats;
+	BOOST_REQUIRE(fieldQueryRun(scene, &options, &stats));
+	BOOST_CHECK_EQUAL(stats.points, pointCount);
+	BOOST_CHECK_EQUAL(stats.batches, (pointCount + 63) / 64);
+
+	rewind(output);
+	for (int i = 0; i < pointCount; ++i) {
+		const Vector position = { (double) (i % 37 - 18), (double) (i % 23 - 11), (double) (i % 41 - 20) };
+		Vector expected = { 0, 0, 0 }, result;
+		fieldSceneEvaluate(scene, &position, &expected, 1);
+		BOOST_REQUIRE_EQUAL(fread(&result, sizeof(Vector), 1, output), 1);
+		BOOST_CHECK_EQUAL(result.x, expected.x);
+		BOOST_CHECK_EQUAL(result.y, expected.y);
+		BOOST_CHECK_EQUAL(result.z, expected.z);
+	}
+	fclose(output);
+
+	FILE* garbage = tmpfile();
+	fprintf(garbage, "1 2 3\n1 2\n");
+	rewind(garbage);
+	output = tmpfile();
+	options.input = garbage;
+	options.output = output;
+	BOOST_CHECK(!fieldQueryRun(scene, &options, &stats));
+	fclose(garbage);
+	fclose(output);
+	fclose(input);
+	fieldSceneFree(scene);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
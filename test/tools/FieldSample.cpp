@@ -0,0 +1,49 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+extern "C" {
+#include <test/tools/FieldSample.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tFieldSample)
+
+BOOST_AUTO_TEST_CASE(tWithinBounds) {
+	// directions over the whole sphere, the axes and the folds of the octahedron among them, at magnitudes over the range
+	for (int i = 0; i <= 24; ++i) {
+		for (int j = 0; j < 48; ++j) {
+			const double polar = M_PI * i / 24, azimuth = 2 * M_PI * j / 48;
+			const double magnitude = std::pow(2.0, (i * 48 + j) % 61 - 30);
+			const Vector value = vectorMultiply(vectorCreate(sin(polar) * cos(azimuth), sin(polar) * sin(azimuth), cos(polar)), magnitude);
+			const Vector unpacked = fieldSampleUnpack(fieldSamplePack(value));
+			const double cosAngle = vectorDotProduct(value, unpacked) / (vectorGetLength(value) * vectorGetLength(unpacked));
+			BOOST_CHECK_SMALL(std::acos(std::min(cosAngle, 1.0)), FIELD_SAMPLE_MAX_ANGLE_ERROR);
+			BOOST_CHECK_SMALL(vectorGetLength(unpacked) / magnitude - 1, FIELD_SAMPLE_MAX_MAGNITUDE_ERROR);
+		}
+	}
+	BOOST_CHECK_EQUAL(fieldSamplePack(vectorZero), 0u);
+	BOOST_CHECK(vectorIsEqual(fieldSampleUnpack(0), vectorZero));
+	BOOST_CHECK_EQUAL(fieldSamplePack(vectorCreate(0, 1.0e-12, 0)), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
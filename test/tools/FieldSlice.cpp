@@ -0,0 +1,91 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+extern "C" {
+#include <test/tools/FieldSlice.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tFieldSlice)
+
+static float getDirectLevel(const FieldSourceSet* sources, const FieldSlice* slice, size_t x, size_t y) {
+	const Vector position = vectorCreate((slice->pixelX + (int) x + 0.5) * slice->step, (slice->pixelY + (int) y + 0.5) * slice->step, 0);
+	Vector field = vectorZero;
+	fieldSourceSetEvaluate(sources, &position, &field, 1);
+	return log10f((float) vectorGetLength(field));
+}
+
+BOOST_AUTO_TEST_CASE(tReusesTiles) {
+	FieldSourceSet* sources = fieldSourceSetNew();
+	FieldSource loop = {};
+	loop.type = FIELD_SOURCE_LOOP;
+	loop.loop = (FieldLoop) { { 0.5, 0.5, 2 }, { 0, 0.3, 1 }, 3, 100, 0.25 };
+	fieldSourceSetAdd(sources, &loop);
+
+	// 128 pixels of 0.1 in the z = 0 plane, the image starts at a tile boundary
+	ThreadPool* pool = threadPoolNew(2);
+	FieldSlice* slice = fieldSliceNew(128, pool);
+	BOOST_REQUIRE(slice);
+	FieldSlicePlane plane = { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 }, 12.8 };
+	BOOST_CHECK_EQUAL(fieldSliceUpdate(slice, sources, 1, plane, 0), 0);
+	BOOST_CHECK_EQUAL(slice->stats.tiles, 16u);
+	BOOST_CHECK_EQUAL(slice->stats.sampledTiles, 16u);
+	BOOST_CHECK_CLOSE(fieldSliceGetLevel(slice, 10, 20), getDirectLevel(sources, slice, 10, 20), 1.0e-3);
+	BOOST_CHECK_CLOSE(fieldSliceGetCorner(slice, 2).x, 6.4, 1.0e-6);
+
+	// nothing moved
+	BOOST_CHECK_EQUAL(fieldSliceUpdate(slice, sources, 1, plane, 0), 0);
+	BOOST_CHECK_EQUAL(slice->stats.sampledTiles, 0u);
+	BOOST_CHECK_EQUAL(slice->stats.licTiles, 0u);
+
+	// panned by 10 pixels, only the column of tiles coming into view is sampled
+	plane.center.x = 1;
+	BOOST_CHECK_EQUAL(fieldSliceUpdate(slice, sources, 1, plane, 0), 0);
+	BOOST_CHECK_EQUAL(slice->stats.tiles, 20u);
+	BOOST_CHECK_EQUAL(slice->stats.sampledTiles, 4u);
+	BOOST_CHECK_CLOSE(fieldSliceGetLevel(slice, 120, 64), getDirectLevel(sources, slice, 120, 64), 1.0e-3);
+	BOOST_CHECK_CLOSE(fieldSliceGetLevel(slice, 10, 20), getDirectLevel(sources, slice, 10, 20), 1.0e-3);
+
+	// a shift by less than the tolerance keeps the samples, moving the plane off itself doesn't
+	plane.center.z = 0.01;
+	BOOST_CHECK_EQUAL(fieldSliceUpdate(slice, sources, 1, plane, 0), 0);
+	BOOST_CHECK_EQUAL(slice->stats.sampledTiles, 0u);
+	plane.center.z = 0.1;
+	BOOST_CHECK_EQUAL(fieldSliceUpdate(slice, sources, 1, plane, 0), 0);
+	BOOST_CHECK_EQUAL(slice->stats.sampledTiles, 20u);
+	plane.center.z = 0;
+
+	// another scene, with a deadline long gone every update still gets one batch done
+	threadPoolFree(pool);
+	slice->pool = NULL;
+	BOOST_CHECK_EQUAL(fieldSliceUpdate(slice, sources, 2, plane, 1), 19);
+	BOOST_CHECK_EQUAL(slice->stats.sampledTiles, 1u);
+	BOOST_CHECK_EQUAL(slice->stats.pendingTiles, 19u);
+	BOOST_CHECK_EQUAL(fieldSliceUpdate(slice, sources, 2, plane, 0), 0);
+	BOOST_CHECK_EQUAL(slice->stats.sampledTiles, 19u);
+
+	fieldSliceFree(slice);
+	fieldSourceSetFree(sources);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,76 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/tools/GridSolver.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tGridSolver)
+
+BOOST_AUTO_TEST_CASE(tMatchesDirect) {
+	FieldSourceSet* sources = fieldSourceSetNew();
+	FieldSource loop = {};
+	loop.type = FIELD_SOURCE_LOOP;
+	loop.loop = (FieldLoop) { { 12, 12, 12 }, { 0.2, 0, 1 }, 4, 100, 0.25 };
+	FieldSource segment = {};
+	segment.type = FIELD_SOURCE_SEGMENT;
+	segment.segment = (FieldSegment) { { 5, 6, 4 }, { 18, 17, 8 }, 60, 0.25 };
+	FieldSource dipole = {};
+	dipole.type = FIELD_SOURCE_DIPOLE;
+	dipole.dipole = (FieldDipole) { { 3, 3, 3 }, { 0, 0, 1 }, 0.25 };
+	fieldSourceSetAdd(sources, &loop);
+	fieldSourceSetAdd(sources, &segment);
+	fieldSourceSetAdd(sources, &dipole);
+
+	ThreadPool* pool = threadPoolNew(2);
+	GridSolver* solver = gridSolverNew(vectorZero, 1, 24, 24, 24, pool);
+	BOOST_REQUIRE(solver);
+	BOOST_CHECK_EQUAL(solver->padded[0], 64u);
+	BOOST_CHECK_EQUAL(gridSolverDepositSources(solver, sources), 2u); // the dipole isn't a current
+	BOOST_REQUIRE(gridSolverSolve(solver));
+	fieldSourceSetRemove(sources, FIELD_SOURCE_DIPOLE, 0);
+
+	// nodes a few cells away from every wire, some of them at the far ends of the grid where a wrapped kernel would
+	// pull in images of the sources
+	const Vector positions[] = { { 12, 12, 20 }, { 2, 20, 14 }, { 21, 2, 21 }, { 0, 0, 23 }, { 23, 23, 0 }, { 12, 12, 12 } };
+	const size_t count = sizeof(positions) / sizeof(positions[0]);
+	Vector exact[count] = {};
+	fieldSourceSetEvaluate(sources, positions, exact, count);
+	for (size_t i = 0; i < count; ++i) {
+		const Vector solved = gridSolverGetField(solver, (size_t) positions[i].x, (size_t) positions[i].y, (size_t) positions[i].z);
+		BOOST_CHECK_SMALL(vectorGetLength(vectorSubstract(solved, exact[i])), vectorGetLength(exact[i]) * 0.01);
+	}
+	Vector sampled;
+	BOOST_CHECK(gridSolverSample(solver, vectorCreate(12, 12, 19.5), &sampled));
+	BOOST_CHECK(!gridSolverSample(solver, vectorCreate(12, 12, 24), &sampled));
+
+	// deposits are used up by a solve
+	BOOST_REQUIRE(gridSolverSolve(solver));
+	BOOST_CHECK_EQUAL(vectorGetLength(gridSolverGetField(solver, 12, 12, 20)), 0);
+
+	gridSolverFree(solver);
+	threadPoolFree(pool);
+	fieldSourceSetFree(sources);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
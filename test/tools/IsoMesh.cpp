@@ -0,0 +1,126 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <test/tools/IsoMesh.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tIsoMesh)
+
+static const int SIZE = 20;
+static const Vector CENTER = { 9.3, 9.6, 9.45 };
+
+static Vector getPosition(const IsoMesh* mesh, unsigned int index) {
+	const IsoMeshVertex* vertex = mesh->vertices + index;
+	return vectorCreate(vertex->x, vertex->y, vertex->z);
+}
+
+// |B| of a point pole falls off as 1 / r^2, the surfaces are spheres around it
+static std::vector<float> getPoleSamples() {
+	std::vector<float> samples(SIZE * SIZE * SIZE);
+	for (int x = 0; x < SIZE; ++x) {
+		for (int y = 0; y < SIZE; ++y) {
+			for (int z = 0; z < SIZE; ++z) {
+				const Vector offset = vectorSubstract(vectorCreate(x, y, z), CENTER);
+				samples[(x * SIZE + y) * SIZE + z] = (float) (1 / vectorGetLengthSq(offset));
+			}
+		}
+	}
+	return samples;
+}
+
+BOOST_AUTO_TEST_CASE(tSphereIsClosed) {
+	const std::vector<float> samples = getPoleSamples();
+	IsoMesh* mesh = isoMeshNew();
+	BOOST_REQUIRE(mesh);
+	isoMeshExtract(mesh, samples.data(), SIZE, 1 / 25.0, vectorZero, 1);
+	BOOST_REQUIRE(mesh->indexCount > 0);
+	BOOST_CHECK_EQUAL(mesh->indexCount % 3, 0u);
+
+	// every edge is shared by exactly two triangles which run along it in opposite directions
+	std::map<std::pair<unsigned int, unsigned int>, int> edges;
+	for (size_t i = 0; i < mesh->indexCount; i += 3) {
+		for (int j = 0; j < 3; ++j) {
+			++edges[std::make_pair(mesh->indices[i + j], mesh->indices[i + (j + 1) % 3])];
+		}
+	}
+	size_t unmatched = 0;
+	for (const auto& edge : edges) {
+		const auto reverse = edges.find(std::make_pair(edge.first.second, edge.first.first));
+		if (edge.second != 1 || reverse == edges.end() || reverse->second != 1) {
+			++unmatched;
+		}
+	}
+	BOOST_CHECK_EQUAL(unmatched, 0u);
+
+	// the surface is a sphere of radius 5 facing away from the pole, where |B| decreases
+	size_t inward = 0;
+	for (size_t i = 0; i < mesh->indexCount; i += 3) {
+		const Vector a = getPosition(mesh, mesh->indices[i]);
+		const Vector b = getPosition(mesh, mesh->indices[i + 1]);
+		const Vector c = getPosition(mesh, mesh->indices[i + 2]);
+		const Vector facing = vectorCrossProduct(vectorSubstract(b, a), vectorSubstract(c, a));
+		const Vector center = vectorDivide(vectorSum(vectorSum(a, b), c), 3);
+		if (vectorDotProduct(facing, vectorSubstract(center, CENTER)) <= 0) {
+			++inward;
+		}
+	}
+	BOOST_CHECK_EQUAL(inward, 0u);
+	for (size_t i = 0; i < mesh->vertexCount; ++i) {
+		const Vector offset = vectorSubstract(getPosition(mesh, (unsigned int) i), CENTER);
+		const IsoMeshVertex* vertex = mesh->vertices + i;
+		BOOST_CHECK_CLOSE(vectorGetLength(offset), 5, 5);
+		BOOST_CHECK_GT(vectorDotProduct(vectorCreate(vertex->nx, vertex->ny, vertex->nz), offset), 0);
+	}
+	isoMeshFree(mesh);
+}
+
+BOOST_AUTO_TEST_CASE(tReusesBuffers) {
+	const std::vector<float> samples = getPoleSamples();
+	IsoMesh* mesh = isoMeshNew();
+	isoMeshExtract(mesh, samples.data(), SIZE, 1 / 25.0, vectorCreate(10, 0, 0), 0.5);
+	const size_t indexCount = mesh->indexCount;
+	const size_t vertexCount = mesh->vertexCount;
+	BOOST_REQUIRE(vertexCount > 0);
+
+	// the grid is moved and scaled into place, the sphere shrinks to a radius of 2.5
+	const Vector center = vectorSum(vectorCreate(10, 0, 0), vectorMultiply(CENTER, 0.5));
+	for (size_t i = 0; i < vertexCount; ++i) {
+		BOOST_CHECK_CLOSE(vectorGetLength(vectorSubstract(getPosition(mesh, (unsigned int) i), center)), 2.5, 5);
+	}
+
+	// the same samples give the same mesh again, a level above every sample gives none
+	isoMeshExtract(mesh, samples.data(), SIZE, 1 / 25.0, vectorCreate(10, 0, 0), 0.5);
+	BOOST_CHECK_EQUAL(mesh->indexCount, indexCount);
+	BOOST_CHECK_EQUAL(mesh->vertexCount, vertexCount);
+	isoMeshExtract(mesh, samples.data(), SIZE, 1000, vectorZero, 1);
+	BOOST_CHECK_EQUAL(mesh->indexCount, 0u);
+	BOOST_CHECK_EQUAL(mesh->vertexCount, 0u);
+	isoMeshFree(mesh);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/tools/JobSystem.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tJobSystem)
+
+struct StepLog {
+	JobSystem* system;
+	int steps;
+	int advanceAt;
+	int released;
+	int cancelled;
+	int order;
+};
+
+static size_t countStep(Job* job) {
+	StepLog* log = (StepLog*) job->arg;
+	if (++log->steps == log->advanceAt) {
+		jobSystemAdvance(log->system);
+	}
+	return 10;
+}
+
+static void releaseLog(Job* job, int cancelled) {
+	StepLog* log = (StepLog*) job->arg;
+	log->released = ++log->order;
+	log->cancelled = cancelled;
+}
+
+BOOST_AUTO_TEST_CASE(tjobSystemContinuation) {
+	JobSystem* system = jobSystemNew(0);
+	StepLog first = { system, 0, -1, 0, 0, 0 }, second = { system, 0, -1, 0, 0, 0 };
+	Job continuation = { countStep, releaseLog, &second, 5, 0, NULL, NULL };
+	Job job = { countStep, releaseLog, &first, 25, 0, &continuation, NULL };
+	jobSystemSubmit(system, &job);
+	BOOST_CHECK(jobSystemRun(system, 0));
+	BOOST_CHECK_EQUAL(first.steps, 3);
+	BOOST_CHECK_EQUAL(second.steps, 1);
+	BOOST_CHECK(first.released && !first.cancelled && second.released && !second.cancelled);
+	const JobSystemStats stats = jobSystemGetStats(system);
+	BOOST_CHECK_EQUAL(stats.jobsDone, 2);
+	BOOST_CHECK_EQUAL(stats.workDone, 30);
+	BOOST_CHECK_EQUAL(stats.workCancelled, 0);
+	jobSystemFree(system);
+}
+
+BOOST_AUTO_TEST_CASE(tjobSystemCancelsStaleJobs) {
+	JobSystem* system = jobSystemNew(1);
+	StepLog first = { system, 0, 2, 0, 0, 0 }, second = { system, 0, -1, 0, 0, 0 };
+	Job continuation = { countStep, releaseLog, &second, 50, 0, NULL, NULL };
+	Job job = { countStep, releaseLog, &first, 100, 0, &continuation, NULL };
+	jobSystemSubmit(system, &job);
+	jobSystemWait(system);
+
+	// the chunk which saw the new generation finishes, the rest of the job and its continuation don't run
+	BOOST_CHECK_EQUAL(first.steps, 2);
+	BOOST_CHECK_EQUAL(second.steps, 0);
+	BOOST_CHECK(first.cancelled && second.cancelled);
+	const JobSystemStats stats = jobSystemGetStats(system);
+	BOOST_CHECK_EQUAL(stats.jobsCancelled, 2);
+	BOOST_CHECK_EQUAL(stats.workDone, 20);
+	BOOST_CHECK_EQUAL(stats.workStale, 10);
+	BOOST_CHECK_EQUAL(stats.workCancelled, 80 + 50);
+	jobSystemFree(system);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,86 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <pthread.h>
+
+extern "C" {
+#include <test/tools/LatencyTracker.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tLatencyTracker)
+
+BOOST_AUTO_TEST_CASE(tPercentiles) {
+	LatencyTracker* tracker = latencyTrackerNew("test", 0.090);
+	for (int i = 100; i >= 1; --i) {
+		latencyTrackerRecord(tracker, i / 1000.0);
+	}
+	LatencyStats stats;
+	latencyTrackerGetStats(tracker, &stats);
+	BOOST_CHECK_EQUAL(stats.count, 100);
+	BOOST_CHECK_EQUAL(stats.overBudget, 10);
+	BOOST_CHECK_CLOSE(stats.p50, 0.050, 1e-9);
+	BOOST_CHECK_CLOSE(stats.p95, 0.095, 1e-9);
+	BOOST_CHECK_CLOSE(stats.p99, 0.099, 1e-9);
+	BOOST_CHECK_CLOSE(stats.max, 0.100, 1e-9);
+	BOOST_CHECK_CLOSE(stats.runP50, 0.050, 5);
+	BOOST_CHECK_CLOSE(stats.runP99, 0.099, 5);
+
+	// a window full of fast samples forgets the slow ones, the run keeps them
+	for (int i = 0; i < LATENCY_WINDOW; ++i) {
+		latencyTrackerRecord(tracker, 0.001);
+	}
+	latencyTrackerGetStats(tracker, &stats);
+	BOOST_CHECK_CLOSE(stats.max, 0.001, 1e-9);
+	BOOST_CHECK_CLOSE(stats.mean, 0.001, 1e-9);
+	BOOST_CHECK_CLOSE(stats.runMax, 0.100, 1e-9);
+
+	double history[8];
+	BOOST_CHECK_EQUAL(latencyTrackerGetHistory(tracker, history, 8), 8);
+	BOOST_CHECK_CLOSE(history[7], 0.001, 1e-9);
+	latencyTrackerFree(tracker);
+}
+
+static void* recordSamples(void* arg) {
+	for (int i = 0; i < 100000; ++i) {
+		latencyTrackerRecord((LatencyTracker*) arg, 0.001 * (i % 10 + 1));
+	}
+	return NULL;
+}
+
+BOOST_AUTO_TEST_CASE(tConcurrentReader) {
+	LatencyTracker* tracker = latencyTrackerNew("test", 0);
+	pthread_t thread;
+	LatencyStats stats;
+	pthread_create(&thread, NULL, recordSamples, tracker);
+	for (int i = 0; i < 1000; ++i) {
+		latencyTrackerGetStats(tracker, &stats);
+	}
+	pthread_join(thread, NULL);
+	latencyTrackerGetStats(tracker, &stats);
+	// every sample is either seen or counted as dropped, and nothing torn gets in
+	BOOST_CHECK_EQUAL(stats.count + stats.dropped, 100000);
+	BOOST_CHECK(stats.runMax <= 0.010);
+	BOOST_CHECK_EQUAL(stats.overBudget, 0);
+	latencyTrackerFree(tracker);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,65 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+extern "C" {
+#include <test/tools/MemoryStats.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tMemoryStats)
+
+#ifdef ENABLE_MEMORY_STATS
+
+BOOST_AUTO_TEST_CASE(tmemoryGetStats) {
+	MemoryStats before = {}, during = {}, after = {};
+	memoryGetStats(&before);
+	void* pointer = memoryAlloc(MEMORY_TAG_RENDERING, 1000);
+	pointer = memoryRealloc(MEMORY_TAG_RENDERING, pointer, 5000);
+	memoryTrack(MEMORY_TAG_MAPPED, 4096);
+	memoryGetStats(&during);
+	BOOST_CHECK(during.enabled);
+	BOOST_CHECK_GE(during.tags[MEMORY_TAG_RENDERING].currentBytes - before.tags[MEMORY_TAG_RENDERING].currentBytes, 5000);
+	BOOST_CHECK_EQUAL(during.tags[MEMORY_TAG_RENDERING].allocations - before.tags[MEMORY_TAG_RENDERING].allocations, 2);
+	BOOST_CHECK_EQUAL(during.tags[MEMORY_TAG_MAPPED].currentBytes - before.tags[MEMORY_TAG_MAPPED].currentBytes, 4096);
+
+	memoryFree(MEMORY_TAG_RENDERING, pointer);
+	memoryTrack(MEMORY_TAG_MAPPED, -4096);
+	memoryGetStats(&after);
+	BOOST_CHECK_EQUAL(after.tags[MEMORY_TAG_RENDERING].currentBytes, before.tags[MEMORY_TAG_RENDERING].currentBytes);
+	BOOST_CHECK_EQUAL(after.tags[MEMORY_TAG_MAPPED].currentBytes, before.tags[MEMORY_TAG_MAPPED].currentBytes);
+	BOOST_CHECK_GE(after.tags[MEMORY_TAG_RENDERING].peakBytes, during.tags[MEMORY_TAG_RENDERING].currentBytes);
+}
+
+BOOST_AUTO_TEST_CASE(tmemoryPeakBetweenReads) {
+	MemoryStats before = {}, after = {};
+	memoryGetStats(&before);
+	// no read sees the spike, the allocation itself has to record it
+	memoryTrack(MEMORY_TAG_MAPPED, 1 << 30);
+	memoryTrack(MEMORY_TAG_MAPPED, -(1 << 30));
+	memoryGetStats(&after);
+	BOOST_CHECK_EQUAL(after.tags[MEMORY_TAG_MAPPED].currentBytes, before.tags[MEMORY_TAG_MAPPED].currentBytes);
+	BOOST_CHECK_GE(after.tags[MEMORY_TAG_MAPPED].peakBytes, before.tags[MEMORY_TAG_MAPPED].currentBytes + (1 << 30));
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,128 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern "C" {
+#include <test/tools/SharedField.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tSharedField)
+
+// a scene hash of this process only, so parallel runs don't share regions
+static uint64_t getTestHash(uint64_t salt) {
+	return 0x5e00000000000000ULL ^ salt << 32 ^ (uint64_t) getpid();
+}
+
+BOOST_AUTO_TEST_CASE(tsharedFieldAttach) {
+	const uint64_t hash = getTestHash(1);
+	BOOST_CHECK(sharedFieldAttach(hash) == NULL);
+	SharedField* owner = sharedFieldCreate(hash);
+	BOOST_REQUIRE(owner != NULL);
+	BOOST_CHECK(sharedFieldCreate(hash) == NULL);
+	BOOST_CHECK(sharedFieldAttach(hash + 1) == NULL);
+	SharedField* viewer = sharedFieldAttach(hash);
+	BOOST_REQUIRE(viewer != NULL);
+	BOOST_CHECK_EQUAL(viewer->header->sceneHash, hash);
+	BOOST_CHECK(sharedFieldIsAlive(viewer));
+	sharedFieldClose(viewer);
+	sharedFieldClose(owner);
+	BOOST_CHECK(sharedFieldAttach(hash) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(tsharedFieldRequestOrder) {
+	SharedField* owner = sharedFieldCreate(getTestHash(2));
+	BOOST_REQUIRE(owner != NULL);
+	SharedField* viewer = sharedFieldAttach(getTestHash(2));
+	BOOST_REQUIRE(viewer != NULL);
+	uint64_t chunkKey;
+	BOOST_CHECK(!sharedFieldNextRequest(owner, &chunkKey));
+
+	// twice around the ring, filling it each time
+	for (int round = 0; round < 2; ++round) {
+		for (uint64_t i = 0; i < SHARED_FIELD_RING_SIZE; ++i) {
+			BOOST_REQUIRE(sharedFieldRequest(viewer, round * SHARED_FIELD_RING_SIZE + i));
+		}
+		BOOST_CHECK(!sharedFieldRequest(viewer, 0));
+		for (uint64_t i = 0; i < SHARED_FIELD_RING_SIZE; ++i) {
+			BOOST_REQUIRE(sharedFieldNextRequest(owner, &chunkKey));
+			BOOST_CHECK_EQUAL(chunkKey, round * SHARED_FIELD_RING_SIZE + i);
+		}
+		BOOST_CHECK(!sharedFieldNextRequest(owner, &chunkKey));
+	}
+	sharedFieldClose(viewer);
+	sharedFieldClose(owner);
+}
+
+BOOST_AUTO_TEST_CASE(tsharedFieldPublishRead) {
+	SharedField* owner = sharedFieldCreate(getTestHash(3));
+	BOOST_REQUIRE(owner != NULL);
+	SharedField* viewer = sharedFieldAttach(getTestHash(3));
+	BOOST_REQUIRE(viewer != NULL);
+	Vector samples[FIELD_CHUNK_CELLS];
+	for (int i = 0; i < FIELD_CHUNK_CELLS; ++i) {
+		samples[i] = vectorCreate(i, -i, 0.5 * i);
+	}
+	unsigned int index;
+	const uint64_t chunkKey = fieldChunkLocate(-5, 2, 7, &index);
+	Vector result;
+	BOOST_CHECK(!sharedFieldContains(viewer, chunkKey));
+	BOOST_CHECK(!sharedFieldRead(viewer, -5, 2, 7, &result));
+	sharedFieldPublish(owner, chunkKey, samples);
+	BOOST_CHECK(sharedFieldContains(viewer, chunkKey));
+	BOOST_REQUIRE(sharedFieldRead(viewer, -5, 2, 7, &result));
+	BOOST_CHECK(vectorIsEqual(result, samples[index]));
+	BOOST_CHECK(!sharedFieldRead(viewer, -5 + FIELD_CHUNK_SIZE, 2, 7, &result));
+
+	// publishing again replaces the chunk in place
+	samples[index] = vectorCreate(1, 2, 3);
+	sharedFieldPublish(owner, chunkKey, samples);
+	BOOST_REQUIRE(sharedFieldRead(viewer, -5, 2, 7, &result));
+	BOOST_CHECK(vectorIsEqual(result, samples[index]));
+	BOOST_CHECK_EQUAL(owner->header->computedChunks, 2);
+	sharedFieldClose(viewer);
+	sharedFieldClose(owner);
+}
+
+BOOST_AUTO_TEST_CASE(tsharedFieldReplacesStaleOwner) {
+	const uint64_t hash = getTestHash(4);
+	// the child creates the region and exits without closing it, as a crashed daemon would
+	const pid_t child = fork();
+	if (child == 0) {
+		_exit(sharedFieldCreate(hash) ? 0 : 1);
+	}
+	int status;
+	BOOST_REQUIRE(waitpid(child, &status, 0) == child);
+	BOOST_REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	SharedField* stale = sharedFieldAttach(hash);
+	BOOST_REQUIRE(stale != NULL);
+	BOOST_CHECK_EQUAL(stale->header->ownerPid, child);
+	sharedFieldClose(stale);
+
+	SharedField* owner = sharedFieldCreate(hash);
+	BOOST_REQUIRE(owner != NULL);
+	BOOST_CHECK_EQUAL(owner->header->ownerPid, getpid());
+	sharedFieldClose(owner);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
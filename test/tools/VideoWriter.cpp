@@ -0,0 +1,82 @@
+/* Copyright (c) 2015 Oleg Morozenkov
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <stdio.h>
+#include <string.h>
+
+extern "C" {
+#include <test/tools/VideoWriter.h>
+}
+
+BOOST_AUTO_TEST_SUITE(tVideoWriter)
+
+static size_t readFile(const char* path, unsigned char* data, size_t size) {
+	FILE* file = fopen(path, "rb");
+	const size_t result = fread(data, 1, size, file);
+	fclose(file);
+	return result;
+}
+
+BOOST_AUTO_TEST_CASE(tY4m) {
+	const char* path = "tVideoWriter.y4m";
+	// 3x2 bottom up: a white bottom row and a blue top row
+	unsigned char rgba[3 * 2 * 4];
+	for (int i = 0; i < 3; ++i) {
+		memcpy(rgba + i * 4, "\xff\xff\xff\xff", 4);
+		memcpy(rgba + 12 + i * 4, "\x00\x00\xff\xff", 4);
+	}
+	VideoWriter* writer = videoWriterOpen(path, 3, 2, 30);
+	BOOST_REQUIRE(writer != NULL);
+	BOOST_CHECK_EQUAL(writer->format, VIDEO_FORMAT_Y4M);
+	BOOST_CHECK(videoWriterWriteRgba(writer, rgba, 1));
+	BOOST_CHECK(videoWriterWriteRgba(writer, rgba, 1));
+	videoWriterClose(writer);
+
+	unsigned char data[256];
+	const char header[] = "YUV4MPEG2 W3 H2 F30:1 Ip A1:1 C420jpeg\n";
+	const size_t headerLength = sizeof(header) - 1;
+	const size_t frameLength = 6 + 3 * 2 + 2 * 2;
+	BOOST_REQUIRE_EQUAL(readFile(path, data, sizeof(data)), headerLength + 2 * frameLength);
+	BOOST_CHECK(!memcmp(data, header, headerLength));
+	const unsigned char* frame = data + headerLength + 6;
+	BOOST_CHECK_EQUAL(frame[0], 29); // blue on top
+	BOOST_CHECK_EQUAL(frame[3], 255);
+	BOOST_CHECK_EQUAL(frame[6], 191); // chroma averaged over blue and white
+	BOOST_CHECK_EQUAL(frame[8], 118);
+	remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(tRaw) {
+	const char* path = "tVideoWriter.rgb";
+	const unsigned char rgba[] = { 1, 2, 3, 255, 4, 5, 6, 255 };
+	VideoWriter* writer = videoWriterOpen(path, 1, 2, 30);
+	BOOST_REQUIRE(writer != NULL);
+	BOOST_CHECK(videoWriterWriteRgba(writer, rgba, 1));
+	videoWriterClose(writer);
+	unsigned char data[16];
+	BOOST_REQUIRE_EQUAL(readFile(path, data, sizeof(data)), 6);
+	const unsigned char expected[] = { 4, 5, 6, 1, 2, 3 };
+	BOOST_CHECK(!memcmp(data, expected, 6));
+	remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()